@@ -1,25 +1,156 @@
+import gzip
 import os
 import os.path
+import re
+import sys
 
 website_dir = "www/build/"
 fsdata_filename = "lib/httpd/fsdata.c"
 
-print("Building React app")
-os.chdir("www")
-if not os.path.isdir("node_modules"):
-  print("Running npm install")
-  os.system("npm i")
-print("Running npm run build")
-os.system("npm run build")
-os.chdir("..")
-print("Done")
-
-print("Regenerating " + fsdata_filename)
-dirname = os.path.dirname(__file__)
-makefsdata = os.path.join(dirname, 'tools/makefsdata')
-os.system(makefsdata + " " + website_dir + " -f:" + fsdata_filename)
-print("Done")
-
-print("Replace includes")
-os.system('perl -i -p0e "s/#include.*?"lwip\/def.h"/#include ""fsdata.h"/s" ' + fsdata_filename)
-print("Done")
+# Assets are stored gzipped with the complete HTTP header in front, so lwIP can send them straight from flash
+server_header = "Server: GP2040 (lwIP)\r\n"
+immutable_cache = "Cache-Control: public, max-age=31536000, immutable\r\n" # Content hashed filenames under /static
+# httpd never answers If-None-Match, so the entry points carry no validator and are just cached briefly
+entry_cache = "Cache-Control: public, max-age=10\r\n"
+min_gzip_saving = 0.05 # Keep the raw file unless gzip saves at least this fraction
+
+content_types = {
+  ".html": "text/html",
+  ".htm": "text/html",
+  ".css": "text/css",
+  ".js": "application/javascript",
+  ".json": "application/json",
+  ".txt": "text/plain",
+  ".svg": "image/svg+xml",
+  ".ico": "image/x-icon",
+  ".png": "image/png",
+  ".jpg": "image/jpeg",
+  ".jpeg": "image/jpeg",
+  ".gif": "image/gif",
+  ".woff": "font/woff",
+  ".woff2": "font/woff2",
+}
+
+# Formats that are already compressed, gzip only costs time on these
+precompressed_types = { ".png", ".jpg", ".jpeg", ".gif", ".woff", ".woff2" }
+
+def build_react_app():
+  print("Building React app")
+  os.chdir("www")
+  if not os.path.isdir("node_modules"):
+    print("Running npm install")
+    os.system("npm i")
+  print("Running npm run build")
+  if os.system("npm run build") != 0:
+    sys.exit("React build failed")
+  os.chdir("..")
+  print("Done")
+
+def list_files(root):
+  files = []
+  for dirpath, dirnames, filenames in os.walk(root):
+    dirnames.sort()
+    for filename in sorted(filenames):
+      path = os.path.join(dirpath, filename)
+      name = "/" + os.path.relpath(path, root).replace(os.sep, "/")
+      files.append((name, path))
+
+  # index.html must come first, it is served for every SPA route
+  files.sort(key=lambda f: f[0] != "/index.html")
+  return files
+
+def encode_file(name, data):
+  ext = os.path.splitext(name)[1].lower()
+  encoding = None
+  body = data
+
+  if ext not in precompressed_types:
+    compressed = gzip.compress(data, compresslevel=9, mtime=0)
+    if len(compressed) <= len(data) * (1 - min_gzip_saving):
+      encoding = "gzip"
+      body = compressed
+
+  header = "HTTP/1.1 200 OK\r\n" + server_header
+  header += "Content-Length: %d\r\n" % len(body)
+  header += "Content-Type: %s\r\n" % content_types.get(ext, "application/octet-stream")
+  if encoding:
+    header += "Content-Encoding: %s\r\n" % encoding
+    header += "Vary: Accept-Encoding\r\n"
+  header += immutable_cache if name.startswith("/static/") else entry_cache
+  header += "\r\n"
+
+  return header.encode("ascii"), body, encoding
+
+def c_identifier(name):
+  return re.sub(r"[^A-Za-z0-9]", "_", name)
+
+def c_bytes(data):
+  lines = []
+  for i in range(0, len(data), 16):
+    lines.append("".join("0x%02x," % b for b in data[i:i + 16]))
+  return "\n".join(lines)
+
+def write_fsdata(files, filename):
+  print("Regenerating " + filename)
+  out = ['#include "fsdata.h"', ""]
+  report = []
+  previous = "NULL"
+
+  for name, path in files:
+    with open(path, "rb") as f:
+      data = f.read()
+
+    header, body, encoding = encode_file(name, data)
+    ident = c_identifier(name)
+    name_bytes = name.encode("ascii") + b"\0"
+
+    out.append("static const unsigned char data_%s[] = {" % ident)
+    out.append("/* %s (%d chars) */" % (name, len(name_bytes)))
+    out.append(c_bytes(name_bytes))
+    out.append("/* HTTP header */")
+    out.append(c_bytes(header))
+    out.append("/* %s data */" % (encoding or "raw"))
+    out.append(c_bytes(body))
+    out.append("};")
+    out.append("")
+    report.append((name, len(data), len(header) + len(body) + len(name_bytes), encoding))
+
+  # Chain the entries so FS_ROOT is index.html, the same layout makefsdata produces
+  for name, path in reversed(files):
+    ident = c_identifier(name)
+    name_len = len(name.encode("ascii")) + 1
+    out.append("const struct fsdata_file file_%s[] = {{" % ident)
+    out.append("  %s," % ("file_" + previous if previous != "NULL" else "NULL"))
+    out.append("  data_%s," % ident)
+    out.append("  data_%s + %d," % (ident, name_len))
+    out.append("  sizeof(data_%s) - %d," % (ident, name_len))
+    out.append("  FS_FILE_FLAGS_HEADER_INCLUDED | FS_FILE_FLAGS_HEADER_PERSISTENT | FS_FILE_FLAGS_HEADER_HTTPVER_1_1,")
+    out.append("}};")
+    out.append("")
+    previous = ident
+
+  out.append("#define FS_ROOT file_%s" % previous)
+  out.append("#define FS_NUMFILES %d" % len(files))
+  out.append("")
+
+  with open(filename, "w", newline="\n") as f:
+    f.write("\n".join(out))
+
+  print("Done")
+  return report
+
+def print_footprint(report):
+  print("Flash footprint")
+  total_raw = 0
+  total_stored = 0
+  for name, raw, stored, encoding in report:
+    print("  %-48s %8d -> %8d %s" % (name, raw, stored, encoding or ""))
+    total_raw += raw
+    total_stored += stored
+  print("  %-48s %8d -> %8d bytes (%d%%)" % ("total", total_raw, total_stored, total_stored * 100 // max(total_raw, 1)))
+
+if __name__ == "__main__":
+  os.chdir(os.path.dirname(os.path.abspath(__file__)))
+  if "--skip-react" not in sys.argv:
+    build_react_app()
+  print_footprint(write_fsdata(list_files(website_dir), fsdata_filename))
@@ -0,0 +1,38 @@
+import os.path
+import re
+import subprocess
+
+Import("env")
+
+# The recovery sector copies a fixed SWAP_STUB_MAX bytes starting at swapStub (src/firmware_update.cpp).
+# Anything past that window, including the tail of the stub's literal pool, would be missing on the device,
+# so fail the link instead. GCC closes the symbol's size after the pool, so nm -S covers both.
+
+source_filename = "src/firmware_update.cpp"
+flash_sector_size = 4096
+
+def stub_limit(project_dir):
+  with open(os.path.join(project_dir, source_filename)) as f:
+    match = re.search(r"#define\s+SWAP_STUB_OFFSET\s+(0x[0-9A-Fa-f]+|\d+)", f.read())
+  if not match:
+    raise SystemExit("SWAP_STUB_OFFSET not found in " + source_filename)
+  return flash_sector_size - int(match.group(1), 0)
+
+def stub_size(nm, elf):
+  output = subprocess.check_output([nm, "-S", "-C", "--defined-only", elf], universal_newlines=True)
+  for line in output.splitlines():
+    fields = line.split(None, 3)
+    if len(fields) == 4 and fields[3].startswith("swapStub"):
+      return int(fields[1], 16)
+  raise SystemExit("swapStub not found in " + elf)
+
+def check_swap_stub(source, target, env):
+  elf = target[0].get_abspath()
+  nm = env.subst("$OBJCOPY").replace("objcopy", "nm")
+  size = stub_size(nm, elf)
+  limit = stub_limit(env.subst("$PROJECT_DIR"))
+  print("swapStub: %d of %d bytes" % (size, limit))
+  if size > limit:
+    raise SystemExit("swapStub is %d bytes, the recovery sector only holds %d" % (size, limit))
+
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", check_swap_stub)
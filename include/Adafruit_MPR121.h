@@ -99,6 +99,8 @@ public:
       __attribute__((deprecated));
   void setThresholds(uint8_t touch, uint8_t release);
 
+  uint32_t errorCount = 0; // Failed or timed out register reads
+
 private:
   uint8_t _i2caddr = MPR121_I2CADDR_DEFAULT;
   i2c_inst_t *i2c_dev = NULL;
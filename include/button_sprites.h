@@ -0,0 +1,29 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#ifndef BUTTON_SPRITES_H_
+#define BUTTON_SPRITES_H_
+
+#include <stdint.h>
+
+// Circle sprites are rasterised with enough pages to start at any row within a page
+#define BUTTON_SPRITE_MAX_RADIUS 8
+#define BUTTON_SPRITE_MAX_WIDTH  ((BUTTON_SPRITE_MAX_RADIUS * 2) + 1)
+#define BUTTON_SPRITE_PAGES      ((BUTTON_SPRITE_MAX_WIDTH + 7 + 7) / 8)
+
+/* Page-major (8 pixel column) circle sprites for one button radius, one pair per vertical phase within a page.
+Blitting them only needs byte-aligned masks, instead of plotting the circle pixel by pixel on every frame. */
+struct ButtonSprites
+{
+	uint8_t radius;
+	uint8_t width;
+	uint8_t fill[8][BUTTON_SPRITE_PAGES * BUTTON_SPRITE_MAX_WIDTH];
+	uint8_t outline[8][BUTTON_SPRITE_PAGES * BUTTON_SPRITE_MAX_WIDTH];
+};
+
+void rasteriseButtonSprites(ButtonSprites &sprites, int radius);
+void blitButtonSprite(const ButtonSprites &sprites, uint8_t *buffer, int width, int height, int x, int y, bool pressed);
+
+#endif
@@ -0,0 +1,83 @@
+/*
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef CONFIG_PROTOCOL_H_
+#define CONFIG_PROTOCOL_H_
+
+#include <stdint.h>
+#include "gamepad.h"
+#include "config_driver.h"
+
+#define CONFIG_PROTOCOL_VERSION 1
+
+/* Binary protocol on the vendor HID interface, one 64 byte report per request and per response.
+	Request:  command, sequence, payload...
+	Response: command, sequence, status, payload...
+The sequence byte is echoed back so the host can match responses to requests. */
+typedef enum
+{
+	CONFIG_COMMAND_GET_INFO      = 0x01, // -> ConfigInfo
+	CONFIG_COMMAND_GET_OPTIONS   = 0x02, // -> ConfigOptions
+	CONFIG_COMMAND_SET_OPTIONS   = 0x03, // ConfigOptions -> ConfigOptions
+	CONFIG_COMMAND_GET_TELEMETRY = 0x04, // -> ConfigTelemetry
+} ConfigCommand;
+
+typedef enum
+{
+	CONFIG_STATUS_OK              = 0x00,
+	CONFIG_STATUS_UNKNOWN_COMMAND = 0x01,
+	CONFIG_STATUS_INVALID_VALUE   = 0x02,
+} ConfigStatus;
+
+struct __attribute__((packed)) ConfigInfo
+{
+	uint8_t protocolVersion;
+	uint8_t inputMode;
+	uint8_t profileCount;
+	uint8_t activeProfile;
+};
+
+struct __attribute__((packed)) ConfigOptions
+{
+	uint8_t dpadMode;
+	uint8_t socdMode;
+	uint8_t inputMode;     // Takes effect after the next plug in
+	uint8_t activeProfile;
+	uint8_t sliderRange;   // Touch positions for a full stick deflection, the slider's calibration
+};
+
+struct __attribute__((packed)) ConfigTelemetry
+{
+	uint16_t buttons;
+	uint8_t dpad;
+	uint8_t aux;
+	uint32_t touched;
+	int8_t touchL;
+	int8_t touchR;
+	uint16_t lx;
+	uint16_t ly;
+	uint16_t rx;
+	uint16_t ry;
+	uint32_t touchScanUS;
+	uint32_t touchErrors;
+	uint32_t flashMaxStallUS;
+};
+
+/* Handles one request per call from the main loop, after the input report has been sent. Changes are
+applied between two input frames, the gamepad interface keeps running throughout. */
+class ConfigProtocol
+{
+public:
+	void process(Gamepad &gamepad);
+
+private:
+	uint8_t handleRequest(Gamepad &gamepad, const uint8_t *payload, uint8_t *result);
+
+	uint8_t response[CONFIG_REPORT_SIZE] = { };
+	bool responsePending = false;
+};
+
+extern ConfigProtocol configProtocol;
+
+#endif
@@ -11,6 +11,7 @@
 #include "BoardConfig.h"
 #include "gp2040.h"
 #include "gamepad.h"
+#include "display_transport.h"
 
 #ifndef BUTTON_LAYOUT
 #define BUTTON_LAYOUT BUTTON_LAYOUT_ARCADE
@@ -62,6 +63,8 @@ public:
 	void setup();
 	void loop();
 	void process(Gamepad *gamepad);
+
+	DisplayTransport transport; // Exposes frame sent/dropped statistics
 };
 
 #endif
@@ -0,0 +1,66 @@
+/*
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef DISPLAY_TRANSPORT_H_
+#define DISPLAY_TRANSPORT_H_
+
+#include <stdint.h>
+#include "hardware/i2c.h"
+#include "OneBitDisplay.h"
+
+// Largest run of pixel data sent while holding the bus, this bounds how long a touch scan can be held up
+#ifndef DISPLAY_TRANSPORT_CHUNK_BYTES
+#define DISPLAY_TRANSPORT_CHUNK_BYTES 16
+#endif
+
+// Worst case is a full refresh: every byte of a 1 KB frame, plus a position command and data prefix per chunk
+#define DISPLAY_TRANSPORT_MAX_PAGES  16
+#define DISPLAY_TRANSPORT_MAX_CHUNKS ((1024 / DISPLAY_TRANSPORT_CHUNK_BYTES) + DISPLAY_TRANSPORT_MAX_PAGES)
+#define DISPLAY_TRANSPORT_MAX_WORDS  (1024 + (DISPLAY_TRANSPORT_MAX_CHUNKS * 5))
+
+/* Sends frames to an I2C OLED in the background. The changed columns of each page are split into chunks
+and encoded as IC_DATA_CMD words, with a STOP after every command and data run. DMA feeds one chunk at
+a time to the I2C TX FIFO. The I2C interrupt hands the bus back to the arbiter as soon as the chunk's
+last STOP is sent, so a waiting touch scan never depends on when core1 gets around to polling. Core1
+only has to diff the frame and start the next chunk, it never waits on the bus. */
+class DisplayTransport
+{
+public:
+	bool init(OBDISP *obd, uint8_t *frontBuffer, uint32_t speed);
+	void queueFrame(uint8_t *backBuffer);
+	void update();
+	void invalidate();
+	inline bool isEnabled() { return dmaChannel >= 0; }
+	inline bool isBusy() { return pendingFrame != nullptr || nextChunk < chunkCount; }
+	void handleIRQ();
+
+	uint32_t framesSent = 0;    // Frames completely transmitted, including ones with no changes
+	uint32_t framesDropped = 0; // Frames replaced by a newer frame before they could be sent
+	uint32_t transferErrors = 0;
+
+private:
+	void encodeFrame();
+	void encodeChunk(int page, int firstCol, int lastCol);
+	bool startChunk();
+	void chunkFinished();
+
+	OBDISP *obd = nullptr;
+	i2c_inst_t *i2c = nullptr;
+	int dmaChannel = -1;
+	uint8_t *frontBuffer = nullptr; // What the panel currently shows
+	uint8_t *pendingFrame = nullptr;
+	uint32_t byteTimeUS = 0;
+	bool irqEnabled = false;
+	bool chunkStarted = false;      // A chunk was started and update() hasn't accounted for it yet
+	volatile bool sending = false;  // A chunk is on the wire and the bus is held, cleared by the IRQ
+	volatile bool aborted = false;  // The chunk was aborted by the controller
+	bool fullRefresh = true;
+	uint16_t wordCount = 0;
+	uint16_t chunkCount = 0;
+	uint16_t nextChunk = 0;
+	uint16_t words[DISPLAY_TRANSPORT_MAX_WORDS];
+	uint16_t chunkEnds[DISPLAY_TRANSPORT_MAX_CHUNKS];
+};
+
+#endif
@@ -0,0 +1,70 @@
+/*
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef FIRMWARE_UPDATE_H_
+#define FIRMWARE_UPDATE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "FlashPROM.h"
+
+// The new image is staged in the second MB of flash, so the running one has to fit in the first
+#ifndef FIRMWARE_STAGING_OFFSET
+#define FIRMWARE_STAGING_OFFSET (1024 * 1024)
+#endif
+
+#define FIRMWARE_STAGING_START   (XIP_BASE + FIRMWARE_STAGING_OFFSET)
+#define FIRMWARE_SWAP_START      (EEPROM_LOG_START - FLASH_SECTOR_SIZE) // One sector below the saved settings
+#define FIRMWARE_STAGING_SIZE    (FIRMWARE_SWAP_START - FIRMWARE_STAGING_START) // Up to the swap record
+#define FIRMWARE_APPLY_DELAY_MS  500 // Lets the response reach the browser before the USB link goes away
+#define FIRMWARE_SWAP_MAGIC      0x50415753 // "SWAP"
+
+/* Written to FIRMWARE_SWAP_START before the first sector of the running firmware is touched, and erased
+once the copy is complete. The swap stub resumes from it after a power loss. */
+struct FirmwareSwapRecord
+{
+	uint32_t magic;
+	uint32_t sectors; // Sectors of the staged image, copied to the start of flash
+	uint32_t check;   // ~magic ^ sectors, a half programmed record never matches
+};
+
+typedef enum
+{
+	FIRMWARE_IDLE,
+	FIRMWARE_RECEIVING,
+	FIRMWARE_STAGED,
+	FIRMWARE_FAILED,
+} FirmwareState;
+
+/* Takes a UF2 file from the web configurator and programs it into the staging area while it arrives,
+one flash sector at a time. The image is only copied over the running firmware after the caller has
+confirmed the CRC of what was staged. The copy is done by a stub that boots from sector 0 in place of
+the firmware until the last sector is written, so a power loss part way through resumes on the next boot. */
+class FirmwareUpdate
+{
+public:
+	void begin(uint32_t contentLength);
+	void write(const uint8_t *data, size_t length);
+	bool finish();
+	bool apply(uint32_t expectedCRC);
+	void poll();
+
+	FirmwareState state = FIRMWARE_IDLE;
+	const char *error = nullptr;
+	uint32_t size = 0; // From the start of flash to the end of the last block
+	uint32_t crc = 0;
+
+private:
+	void fail(const char *reason);
+	void handleBlock();
+	void flushSector();
+
+	bool hasBootBlock = false;
+	bool applyPending = false;
+	uint32_t applyAtMS = 0;
+};
+
+extern FirmwareUpdate firmwareUpdate;
+
+#endif
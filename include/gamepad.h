@@ -11,6 +11,23 @@
 #define GAMEPAD_FEATURE_REPORT_SIZE 32
 #define NOT_TOUCHED -1
 
+// Touch positions the finger has to travel from where it landed to fully deflect the stick
+#ifndef SLIDER_RANGE
+#define SLIDER_RANGE 3
+#endif
+#define SLIDER_RANGE_MAX 16
+
+// A profile bank decoded into exactly what read() and slideBar() use, so switching is only a copy
+struct GamepadProfile
+{
+	uint8_t pins[PROFILE_PIN_COUNT];
+	uint32_t pinMasks[PROFILE_PIN_COUNT];
+	DpadMode dpadMode;
+	SOCDMode socdMode;
+	int16_t sliderRange;
+	int16_t sliderStep;
+};
+
 struct GamepadButtonMapping
 {
 	GamepadButtonMapping(uint8_t p, uint16_t bm) : pin(p), pinMask((1 << p)), buttonMask(bm) {}
@@ -36,6 +53,10 @@ public:
 	void read();
 	void slideBar();
 	void makeTouchedPosition(uint32_t touched, int8_t &left, int8_t &right);
+	void diagnosticsHotkey();
+	void profileHotkey();
+	void setProfile(uint8_t index);
+	bool setSliderRange(int16_t range);
 
 	void process()
 	{
@@ -53,6 +74,7 @@ public:
 	}
 
 	GamepadState rawState;
+	bool showDiagnostics = false; // Toggled with F1 + L3, the display follows it from the snapshot
 
 	GamepadButtonMapping *mapDpadUp;
 	GamepadButtonMapping *mapDpadDown;
@@ -84,6 +106,17 @@ public:
 	int8_t currTouchedPositionR = -1;
 	int8_t lastTouchedPositionL = -1;
 	int8_t lastTouchedPositionR = -1;
+	uint32_t touchScanUS = 0; // Rolling average of a full touch scan, including the wait for the I2C bus
+	uint32_t touchErrors = 0;
+
+	uint8_t activeProfile = 0;
+	int16_t sliderRange = SLIDER_RANGE;
+	int16_t sliderStep = GAMEPAD_JOYSTICK_MID / SLIDER_RANGE;
+
+private:
+	void setupProfiles();
+	void applyProfile(const GamepadProfile &profile);
+	void storeProfile(uint8_t index);
 };
 
 #endif
@@ -0,0 +1,49 @@
+/*
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef I2C_BUS_H_
+#define I2C_BUS_H_
+
+#include <stdint.h>
+#include "hardware/sync.h"
+
+typedef enum
+{
+	I2C_CLIENT_NONE = -1,
+	I2C_CLIENT_TOUCH,   // MPR121 scans on core0, hard real-time
+	I2C_CLIENT_DISPLAY, // OLED frames on core1, best effort
+	I2C_CLIENT_COUNT,
+} I2CClient;
+
+/* Shares the single I2C block between the touch controllers on core0 and the OLED on core1.
+Touch always wins: once it asks for the bus, no new display chunk is started, so it waits at most
+for the chunk already on the wire. Display chunks are only granted when they fit in the gap before
+the next touch scan is due. */
+class I2CBusArbiter
+{
+public:
+	void init();
+	void acquire(I2CClient client);
+	bool tryAcquire(I2CClient client, uint32_t durationUS);
+	void release(I2CClient client);
+	uint8_t getOccupancy(I2CClient client); // Percentage of time the client held the bus since the last reset
+	void resetStats();
+
+	uint64_t busyUS[I2C_CLIENT_COUNT] = { }; // 64-bit so the window never wraps, read under the lock
+	uint32_t maxTouchWaitUS = 0;
+	uint32_t touchPeriodUS = 0; // Time between the last two touch scans
+
+private:
+	spin_lock_t *lock = nullptr;
+	volatile I2CClient owner = I2C_CLIENT_NONE;
+	volatile bool touchPending = false;
+	uint32_t acquiredUS = 0;
+	uint32_t lastTouchUS = 0;
+	volatile uint32_t touchReleasedUS = 0;
+	uint64_t statsStartUS = 0;
+};
+
+extern I2CBusArbiter i2cBus;
+
+#endif
@@ -0,0 +1,46 @@
+/*
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef INPUT_MONITOR_H_
+#define INPUT_MONITOR_H_
+
+#include <stdint.h>
+#include "gamepad.h"
+
+// Separate port, the httpd closes or reuses a connection once a response is complete
+#ifndef INPUT_MONITOR_PORT
+#define INPUT_MONITOR_PORT 8081
+#endif
+
+#ifndef INPUT_MONITOR_INTERVAL_MS
+#define INPUT_MONITOR_INTERVAL_MS 10
+#endif
+
+#ifndef INPUT_MONITOR_MAX_CLIENTS
+#define INPUT_MONITOR_MAX_CLIENTS 2
+#endif
+
+#define INPUT_MONITOR_RECORD_SIZE    96
+#define INPUT_MONITOR_HEARTBEAT_MS   1000 // A comment line that lets dead connections be found
+#define INPUT_MONITOR_MAX_IN_FLIGHT  (4 * INPUT_MONITOR_RECORD_SIZE)
+
+/* Streams the live input state to the web configurator as Server-Sent Events. Each event is one line of
+comma separated fields, sent only when something changed:
+	buttons,dpad,aux,touched,touchL,touchR,lx,ly,rx,ry,lt,rt
+The finger positions are signed decimal (-1 when not touched), everything else is hex. A client with
+too much unacknowledged data skips states, so a slow link only lowers the rate and never builds up a
+backlog. */
+class InputMonitor
+{
+public:
+	void start();
+	void update(Gamepad &gamepad);
+
+private:
+	uint32_t lastUpdateMS = 0;
+};
+
+extern InputMonitor inputMonitor;
+
+#endif
@@ -0,0 +1,43 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#ifndef LED_LAYOUTS_H_
+#define LED_LAYOUTS_H_
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "Pixel.hpp"
+#include "enums.h"
+
+// Kept free of Pico SDK headers, the host tools build the layouts too
+
+const std::string BUTTON_LABEL_UP = "Up";
+const std::string BUTTON_LABEL_DOWN = "Down";
+const std::string BUTTON_LABEL_LEFT = "Left";
+const std::string BUTTON_LABEL_RIGHT = "Right";
+const std::string BUTTON_LABEL_B1 = "B1";
+const std::string BUTTON_LABEL_B2 = "B2";
+const std::string BUTTON_LABEL_B3 = "B3";
+const std::string BUTTON_LABEL_B4 = "B4";
+const std::string BUTTON_LABEL_L1 = "L1";
+const std::string BUTTON_LABEL_R1 = "R1";
+const std::string BUTTON_LABEL_L2 = "L2";
+const std::string BUTTON_LABEL_R2 = "R2";
+const std::string BUTTON_LABEL_S1 = "S1";
+const std::string BUTTON_LABEL_S2 = "S2";
+const std::string BUTTON_LABEL_L3 = "L3";
+const std::string BUTTON_LABEL_R3 = "R3";
+const std::string BUTTON_LABEL_A1 = "A1";
+const std::string BUTTON_LABEL_A2 = "A2";
+
+// LED button index for each label, -1 if the button has no LEDs
+extern std::map<std::string, int> buttonPositions;
+
+std::vector<std::vector<Pixel>> createLedButtonLayout(ButtonLayout layout, std::vector<std::vector<uint16_t>> *positions);
+std::vector<std::vector<Pixel>> createLedButtonLayout(ButtonLayout layout, uint8_t ledsPerPixel, uint8_t ledButtonCount);
+
+#endif
@@ -30,6 +30,35 @@
 #define LEDS_PER_PIXEL 1
 #endif
 
+#ifndef LED_COUNT
+#define LED_COUNT 0 // Size the chain from the button layout
+#endif
+
+// Extra chains continue the logical LED numbering after the primary chain, in order
+#ifndef LED_CHAIN1_PIN
+#define LED_CHAIN1_PIN -1
+#endif
+
+#ifndef LED_CHAIN1_LENGTH
+#define LED_CHAIN1_LENGTH 0
+#endif
+
+#ifndef LED_CHAIN2_PIN
+#define LED_CHAIN2_PIN -1
+#endif
+
+#ifndef LED_CHAIN2_LENGTH
+#define LED_CHAIN2_LENGTH 0
+#endif
+
+#ifndef LED_CHAIN3_PIN
+#define LED_CHAIN3_PIN -1
+#endif
+
+#ifndef LED_CHAIN3_LENGTH
+#define LED_CHAIN3_LENGTH 0
+#endif
+
 #ifndef LEDS_BRIGHTNESS
 #define LEDS_BRIGHTNESS 75
 #endif
@@ -141,8 +170,13 @@
 void configureAnimations(AnimationStation *as);
 AnimationHotkey animationHotkeys(Gamepad *gamepad);
 void configureLEDs(LEDOptions ledOptions);
-PixelMatrix createLedButtonLayout(ButtonLayout layout, int ledsPerPixel);
-PixelMatrix createLedButtonLayout(ButtonLayout layout, std::vector<uint8_t> *positions);
+
+// The animation of a profile bank, handed from core1 to core0 to be stored
+struct ProfileAnimationSave
+{
+	uint8_t index;
+	AnimationOptions options;
+};
 
 class LEDModule : public GPModule {
 public:
@@ -151,8 +185,27 @@ public:
 	void process(Gamepad *gamepad);
 	void trySave();
 	void configureLEDs();
-	uint32_t frame[100];
+	void setupProfiles();
+	void setProfile(uint8_t index);
+	void saveProfiles();
+
+	// Whether ledCount LEDs fit the LED arena, the wire and logical frames kept here included
+	static bool fitsArena(uint32_t ledCount)
+	{
+		return ledCount <= UINT16_MAX
+			&& (2 * ((ledCount * sizeof(uint32_t)) + alignof(uint32_t) - 1)) + AnimationStation::ArenaSize(ledCount) <= LED_ARENA_SIZE;
+	}
+
+	uint32_t *frame = nullptr;
+	uint16_t ledCount = 0;
+	NeoPico *chains[LED_CHAIN_MAX] = { };
+	uint16_t chainOffsets[LED_CHAIN_MAX] = { };
+	uint8_t chainCount = 0;
+	uint32_t framesShown = 0;
+	uint32_t framesSkipped = 0;
 	LEDOptions ledOptions;
+	uint8_t activeProfile = 0;
+	AnimationOptions profileAnimations[PROFILE_COUNT]; // Owned by core1 once the modules are running
 };
 
 extern LEDModule ledModule;
@@ -32,7 +32,6 @@
 
 #define PLED_MASK_ALL ((1U << PLED1_PIN) | (1U << PLED2_PIN) | (1U << PLED3_PIN) | (1U << PLED4_PIN))
 
-extern NeoPico *neopico;
 extern AnimationStation as;
 
 class PWMPlayerLEDs : public PlayerLEDs
@@ -8,12 +8,23 @@
 
 #include <stdint.h>
 #include "NeoPico.hpp"
+#include "AnimationStation.hpp"
 #include "enums.h"
 
 #define GAMEPAD_STORAGE_INDEX      0 // 1024 bytes for gamepad options
 #define BOARD_STORAGE_INDEX     1024 //  512 bytes for hardware options
 #define LED_STORAGE_INDEX       1536 //  512 bytes for LED configuration
 #define ANIMATION_STORAGE_INDEX 2048 // ???? bytes for LED animations
+#define PROFILE_STORAGE_INDEX   2560 //  256 bytes for profile banks
+#define PROFILE_LED_STORAGE_INDEX 2816 // 256 bytes for the LED animation of each profile bank
+
+#ifndef PROFILE_COUNT
+#define PROFILE_COUNT 4
+#endif
+
+#define PROFILE_PIN_COUNT 18 // One per digital input, in the same order as Gamepad::gamepadMappings
+
+#define LED_CHAIN_MAX 4 // Primary chain on dataPin plus up to 3 extra chains
 
 struct BoardOptions
 {
@@ -80,6 +91,20 @@ struct LEDOptions
 	int indexR3;
 	int indexA1;
 	int indexA2;
+	uint16_t ledCount; // LEDs on the primary chain, 0 to size it from the button layout
+	int chainPins[LED_CHAIN_MAX - 1];         // Data pins for the extra chains
+	uint16_t chainLengths[LED_CHAIN_MAX - 1]; // LEDs on each extra chain, 0 if unused
+};
+
+/* A profile bank holds what changes from game to game. The active profile is also mirrored in the
+board, gamepad and animation options, so the web configurator and the existing hotkeys edit it. */
+struct ProfileOptions
+{
+	uint8_t pins[PROFILE_PIN_COUNT];
+	uint8_t dpadMode;
+	uint8_t socdMode;
+	uint8_t sliderRange; // Touch positions from the start point to full stick deflection
+	uint32_t checksum;
 };
 
 BoardOptions getBoardOptions();
@@ -88,4 +113,11 @@ void setBoardOptions(BoardOptions options);
 LEDOptions getLEDOptions();
 void setLEDOptions(LEDOptions options);
 
+uint8_t getActiveProfile();
+void setActiveProfile(uint8_t index);
+bool getProfileOptions(uint8_t index, ProfileOptions &options);
+void setProfileOptions(uint8_t index, ProfileOptions options);
+bool getProfileAnimationOptions(uint8_t index, AnimationOptions &options);
+void setProfileAnimationOptions(uint8_t index, AnimationOptions options);
+
 #endif
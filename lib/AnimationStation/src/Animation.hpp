@@ -2,6 +2,7 @@
 #define _ANIMATION_H_
 
 #include "Pixel.hpp"
+#include "LEDArena.hpp"
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -9,7 +10,7 @@
 #include "NeoPico.hpp"
 
 struct RGB {
-  RGB() : r(0), g(0), b(0) {}
+  RGB() : r(0), g(0), b(0), w(0) {}
 
   RGB(uint8_t r, uint8_t g, uint8_t b) : r(r), g(g), b(b), w(0) {}
 
@@ -21,6 +22,12 @@ struct RGB {
   uint8_t b;
   uint8_t w;
 
+  inline bool operator==(const RGB &rhs) const {
+    return r == rhs.r && g == rhs.g && b == rhs.b && w == rhs.w;
+  }
+
+  inline bool operator!=(const RGB &rhs) const { return !(*this == rhs); }
+
   inline static RGB wheel(uint8_t pos) {
     pos = 255 - pos;
     if (pos < 85) {
@@ -86,6 +93,43 @@ static const RGB ColorPurple(128, 0, 255);
 static const RGB ColorPink(255, 0, 255);
 static const RGB ColorMagenta(255, 0, 128);
 
+typedef enum
+{
+  BLEND_REPLACE,
+  BLEND_ADD,
+  BLEND_MAX,
+  BLEND_MULTIPLY,
+} BlendMode;
+
+class Animation;
+
+/* A single entry in the AnimationStation layer stack. Effects draw into the layer's own frame,
+flagging which LEDs they cover and which ones changed, and AnimationStation composites the stack. */
+struct AnimationLayer {
+  AnimationLayer(BlendMode blendMode = BLEND_REPLACE, uint8_t alpha = 255)
+    : blendMode(blendMode), alpha(alpha) { }
+
+  /* Sizes the layer buffers from the LED arena, returns false if the arena is exhausted. */
+  bool Allocate(uint16_t count) {
+    ledCount = 0;
+    frame = LEDArena::Allocate<RGB>(count);
+    if (frame == nullptr || !coverage.Allocate(count) || !dirty.Allocate(count))
+      return false;
+
+    ledCount = count;
+    return true;
+  }
+
+  Animation *animation = nullptr;
+  BlendMode blendMode;
+  uint8_t alpha;
+  bool enabled = true;
+  uint16_t ledCount = 0;
+  RGB *frame = nullptr;
+  LEDMask coverage; // LEDs drawn by this layer, all others show the layers below
+  LEDMask dirty;    // LEDs changed since the last composite
+};
+
 static const std::vector<RGB> colors = {
     ColorBlack,     ColorWhite,  ColorRed,     ColorOrange, ColorYellow,
     ColorLimeGreen, ColorGreen,  ColorSeafoam, ColorAqua,   ColorSkyBlue,
@@ -101,11 +145,35 @@ public:
   static LEDFormat format;
 
   bool notInFilter(Pixel pixel);
-  virtual void Animate(RGB (&frame)[100]) = 0;
+
+  /* Effects are computed from the current time rather than stepped per call, so their speed does not
+  depend on how often we get scheduled. Returns true if the effect changed at least one LED in the layer. */
+  virtual bool Animate(AnimationLayer &layer, uint32_t nowMS) = 0;
   virtual void ParameterUp() = 0;
   virtual void ParameterDown() = 0;
 
 protected:
+  /* Writes a color to the layer, flagging the LED as dirty only if its value actually changed. */
+  inline bool WritePixel(AnimationLayer &layer, uint16_t pos, const RGB &color) {
+    if (pos >= layer.ledCount || (layer.coverage.test(pos) && layer.frame[pos] == color))
+      return false;
+
+    layer.frame[pos] = color;
+    layer.coverage.set(pos);
+    layer.dirty.set(pos);
+    return true;
+  }
+
+  /* Removes an LED from the layer so the layers below show through. */
+  inline bool ErasePixel(AnimationLayer &layer, uint16_t pos) {
+    if (pos >= layer.ledCount || !layer.coverage.test(pos))
+      return false;
+
+    layer.coverage.reset(pos);
+    layer.dirty.set(pos);
+    return true;
+  }
+
 /* We track both the full matrix as well as individual pixels here to support
 button press changes. Rather than adjusting the matrix to represent a subset of pixels,
 we provide a subset of pixels to use as a filter. */
@@ -7,24 +7,92 @@
 
 #include "AnimationStation.hpp"
 
+#if !PICO_NO_HARDWARE
+#include "pico/time.h"
+
+static uint32_t systemClock() { return to_ms_since_boot(get_absolute_time()); }
+#else
+static uint32_t systemClock() { return 0; } // No timer off-device, install one with SetClock()
+#endif
+
 uint8_t AnimationStation::brightnessMax = 100;
 uint8_t AnimationStation::brightnessSteps = 5;
 float AnimationStation::brightnessX = 0;
-absolute_time_t AnimationStation::nextChange = 0;
+uint32_t AnimationStation::nextChange = 0;
+AnimationClock AnimationStation::clock = systemClock;
 AnimationOptions AnimationStation::options = {};
+LEDMask AnimationStation::dirty;
 
+static inline uint8_t blendChannel(uint8_t dst, uint8_t src, BlendMode blendMode, uint8_t alpha) {
+  int value;
+  switch (blendMode) {
+  case BLEND_ADD:
+    value = std::min(dst + src, 255);
+    break;
+  case BLEND_MAX:
+    value = std::max(dst, src);
+    break;
+  case BLEND_MULTIPLY:
+    value = (dst * src) / 255;
+    break;
+  default:
+    value = src;
+    break;
+  }
 
-AnimationStation::AnimationStation() {
+  if (alpha == 255)
+    return value;
+
+  return dst + ((value - dst) * alpha) / 255;
+}
+
+static inline RGB blend(const RGB &dst, const RGB &src, BlendMode blendMode, uint8_t alpha) {
+  return RGB(
+    blendChannel(dst.r, src.r, blendMode, alpha),
+    blendChannel(dst.g, src.g, blendMode, alpha),
+    blendChannel(dst.b, src.b, blendMode, alpha),
+    blendChannel(dst.w, src.w, blendMode, alpha)
+  );
+}
+
+
+AnimationStation::AnimationStation() : layers(TOTAL_LAYERS) {
   AnimationStation::SetBrightness(1);
 }
 
+/* Sizes every per-LED buffer for the chain from the LED arena. The arena must be reset beforehand,
+returns false if the chain doesn't fit. */
+bool AnimationStation::Configure(uint16_t ledCount) {
+  this->ledCount = 0;
+  this->frame = LEDArena::Allocate<RGB>(ledCount);
+  if (this->frame == nullptr || !AnimationStation::dirty.Allocate(ledCount) || !this->changed.Allocate(ledCount))
+    return false;
+
+  for (auto &layer : this->layers) {
+    if (!layer.Allocate(ledCount))
+      return false;
+  }
+
+  this->ledCount = ledCount;
+  AnimationStation::dirty.set();
+  return true;
+}
+
+/* Arena bytes Configure() takes at most for the default layer stack: a frame for the station and each layer,
+and two masks for each of them, every allocation padded to its alignment. */
+size_t AnimationStation::ArenaSize(uint16_t ledCount) {
+  size_t frame = (ledCount * sizeof(RGB)) + alignof(RGB) - 1;
+  size_t mask = (((ledCount + 31) / 32) * sizeof(uint32_t)) + alignof(uint32_t) - 1;
+  return (TOTAL_LAYERS + 1) * (frame + (2 * mask));
+}
+
 void AnimationStation::ConfigureBrightness(uint8_t max, uint8_t steps) {
   brightnessMax = max;
   brightnessSteps = steps;
 }
 
 void AnimationStation::HandleEvent(AnimationHotkey action) {
-  if (action == HOTKEY_LEDS_NONE || !time_reached(AnimationStation::nextChange)) {
+  if (action == HOTKEY_LEDS_NONE || (int32_t)(AnimationStation::Now() - AnimationStation::nextChange) < 0) {
     return;
   }
 
@@ -44,23 +112,26 @@ void AnimationStation::HandleEvent(AnimationHotkey action) {
     ChangeAnimation(-1);
   }
 
-  if (action == HOTKEY_LEDS_PARAMETER_UP) {
-    this->baseAnimation->ParameterUp();
+  Animation *baseAnimation = this->layers[LAYER_BASE].animation;
+  Animation *buttonAnimation = this->layers[LAYER_PRESSED].animation;
+
+  if (action == HOTKEY_LEDS_PARAMETER_UP && baseAnimation != nullptr) {
+    baseAnimation->ParameterUp();
   }
 
-  if (action == HOTKEY_LEDS_PARAMETER_DOWN) {
-    this->baseAnimation->ParameterDown();
+  if (action == HOTKEY_LEDS_PARAMETER_DOWN && baseAnimation != nullptr) {
+    baseAnimation->ParameterDown();
   }
 
-  if (action == HOTKEY_LEDS_PRESS_PARAMETER_UP) {
-    this->buttonAnimation->ParameterUp();
+  if (action == HOTKEY_LEDS_PRESS_PARAMETER_UP && buttonAnimation != nullptr) {
+    buttonAnimation->ParameterUp();
   }
 
-  if (action == HOTKEY_LEDS_PRESS_PARAMETER_DOWN) {
-    this->buttonAnimation->ParameterDown();
+  if (action == HOTKEY_LEDS_PRESS_PARAMETER_DOWN && buttonAnimation != nullptr) {
+    buttonAnimation->ParameterDown();
   }
 
-  AnimationStation::nextChange = make_timeout_time_ms(250);
+  AnimationStation::nextChange = AnimationStation::Now() + 250;
 }
 
 void AnimationStation::ChangeAnimation(int changeSize) {
@@ -84,34 +155,124 @@ uint16_t AnimationStation::AdjustIndex(int changeSize) {
 void AnimationStation::HandlePressed(std::vector<Pixel> pressed) {
   if (pressed != this->lastPressed) {
     this->lastPressed = pressed;
-    if (this->buttonAnimation == nullptr)
-      this->buttonAnimation = new StaticColor(matrix, pressed);
+    if (this->layers[LAYER_PRESSED].animation == nullptr)
+      this->SetLayerAnimation(LAYER_PRESSED, new StaticColor(matrix, pressed));
 
-    this->buttonAnimation->UpdatePixels(pressed);
+    this->layers[LAYER_PRESSED].animation->UpdatePixels(pressed);
   }
 }
 
 void AnimationStation::ClearPressed() {
-  if (this->buttonAnimation != nullptr) {
-    this->buttonAnimation->ClearPixels();
+  if (this->layers[LAYER_PRESSED].animation != nullptr) {
+    this->layers[LAYER_PRESSED].animation->ClearPixels();
   }
   this->lastPressed.clear();
 }
 
-void AnimationStation::Animate() {
-  if (baseAnimation == nullptr) {
-    this->Clear();
-    return;
+/* Returns true if any LED needs to be converted and sent since the last call to ApplyBrightness(). */
+bool AnimationStation::Animate() {
+  return this->Animate(AnimationStation::Now());
+}
+
+bool AnimationStation::Animate(uint32_t nowMS) {
+  for (auto &layer : this->layers) {
+    if (layer.enabled && layer.animation != nullptr)
+      layer.animation->Animate(layer, nowMS);
+  }
+
+  this->Composite();
+
+  return AnimationStation::dirty.any();
+}
+
+/* Blends the layer stack into the output frame. Only LEDs that changed in at least one layer are
+recomposited, so an idle stack costs a handful of bitset checks. */
+bool AnimationStation::Composite() {
+  this->changed.reset();
+  for (auto &layer : this->layers)
+    this->changed |= layer.dirty;
+
+  if (this->changed.none())
+    return false;
+
+  for (uint16_t i = 0; i < this->ledCount; i++) {
+    if (!this->changed.words[i >> 5]) {
+      i |= 31; // Skip the rest of an untouched word
+      continue;
+    }
+
+    if (!this->changed.test(i))
+      continue;
+
+    RGB color = ColorBlack;
+    for (auto &layer : this->layers) {
+      if (layer.enabled && layer.coverage.test(i))
+        color = blend(color, layer.frame[i], layer.blendMode, layer.alpha);
+    }
+
+    if (this->frame[i] != color) {
+      this->frame[i] = color;
+      AnimationStation::dirty.set(i);
+    }
   }
 
-  baseAnimation->Animate(this->frame);
+  for (auto &layer : this->layers)
+    layer.dirty.reset();
 
-  if (buttonAnimation != nullptr) {
-    buttonAnimation->Animate(this->frame);
+  return true;
+}
+
+void AnimationStation::Clear() {
+  for (auto &layer : this->layers) {
+    layer.dirty |= layer.coverage;
+    layer.coverage.reset();
   }
+
+  this->Composite();
+}
+
+void AnimationStation::Invalidate() { AnimationStation::dirty.set(); }
+
+int AnimationStation::AddLayer(BlendMode blendMode, uint8_t alpha) {
+  AnimationLayer layer(blendMode, alpha);
+  if (this->ledCount > 0 && !layer.Allocate(this->ledCount))
+    return -1;
+
+  this->layers.push_back(layer);
+  return this->layers.size() - 1;
 }
 
-void AnimationStation::Clear() { memset(frame, 0, sizeof(frame)); }
+void AnimationStation::SetLayerAnimation(int index, Animation *animation) {
+  AnimationLayer &layer = this->layers[index];
+
+  if (layer.animation != nullptr) {
+    delete layer.animation;
+  }
+
+  // Drop whatever the old effect drew, the new one starts from a transparent layer
+  layer.animation = animation;
+  layer.dirty |= layer.coverage;
+  layer.coverage.reset();
+}
+
+void AnimationStation::SetLayerBlend(int index, BlendMode blendMode, uint8_t alpha) {
+  AnimationLayer &layer = this->layers[index];
+  if (layer.blendMode == blendMode && layer.alpha == alpha)
+    return;
+
+  layer.blendMode = blendMode;
+  layer.alpha = alpha;
+  layer.dirty |= layer.coverage;
+}
+
+void AnimationStation::SetLayerEnabled(int index, bool enabled) {
+  AnimationLayer &layer = this->layers[index];
+  if (layer.enabled == enabled)
+    return;
+
+  layer.enabled = enabled;
+  layer.dirty |= layer.coverage;
+}
 
 float AnimationStation::GetBrightnessX() {
   return AnimationStation::brightnessX;
@@ -128,22 +289,18 @@ void AnimationStation::SetMode(uint8_t mode) {
   AnimationEffects newEffect =
       static_cast<AnimationEffects>(this->options.baseAnimationIndex);
 
-  if (this->baseAnimation != nullptr) {
-    delete this->baseAnimation;
-  }
-
   switch (newEffect) {
   case AnimationEffects::EFFECT_RAINBOW:
-    this->baseAnimation = new Rainbow(matrix);
+    this->SetLayerAnimation(LAYER_BASE, new Rainbow(matrix));
     break;
   case AnimationEffects::EFFECT_CHASE:
-    this->baseAnimation = new Chase(matrix);
+    this->SetLayerAnimation(LAYER_BASE, new Chase(matrix));
     break;
   case AnimationEffects::EFFECT_STATIC_THEME:
-    this->baseAnimation = new StaticTheme(matrix);
+    this->SetLayerAnimation(LAYER_BASE, new StaticTheme(matrix));
     break;
   default:
-    this->baseAnimation = new StaticColor(matrix);
+    this->SetLayerAnimation(LAYER_BASE, new StaticColor(matrix));
     break;
   }
 }
@@ -152,14 +309,28 @@ void AnimationStation::SetMatrix(PixelMatrix matrix) {
   this->matrix = matrix;
 }
 
+void AnimationStation::SetClock(AnimationClock clock) {
+  AnimationStation::clock = (clock != nullptr) ? clock : systemClock;
+}
+
+uint32_t AnimationStation::Now() {
+  return AnimationStation::clock();
+}
+
 void AnimationStation::SetOptions(AnimationOptions options) {
   AnimationStation::options = options;
   AnimationStation::SetBrightness(options.brightness);
 }
 
 void AnimationStation::ApplyBrightness(uint32_t *frameValue) {
-  for (int i = 0; i < 100; i++)
-    frameValue[i] = this->frame[i].value(Animation::format, brightnessX);
+  if (AnimationStation::dirty.none())
+    return;
+
+  for (uint16_t i = 0; i < this->ledCount; i++)
+    if (AnimationStation::dirty.test(i))
+      frameValue[i] = this->frame[i].value(Animation::format, brightnessX);
+
+  AnimationStation::dirty.reset();
 }
 
 void AnimationStation::SetBrightness(uint8_t brightness) {
@@ -172,6 +343,9 @@ void AnimationStation::SetBrightness(uint8_t brightness) {
     AnimationStation::brightnessX = 1;
   else if (AnimationStation::brightnessX < 0)
     AnimationStation::brightnessX = 0;
+
+  // Every LED has to be reconverted at the new brightness
+  AnimationStation::dirty.set();
 }
 
 void AnimationStation::DecreaseBrightness() {
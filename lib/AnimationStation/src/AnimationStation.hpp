@@ -6,7 +6,6 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <vector>
-#include "hardware/clocks.h"
 
 #include "NeoPico.hpp"
 #include "Animation.hpp"
@@ -26,6 +25,15 @@ typedef enum
 // We can't programmatically determine how many elements are in an enum. Yes, that's dumb.
 const int TOTAL_EFFECTS = 4;
 
+/* Default layer stack, bottom to top. Additional layers can be appended with AddLayer(). */
+typedef enum
+{
+  LAYER_BASE,
+  LAYER_PRESSED,
+} AnimationLayers;
+
+const int TOTAL_LAYERS = 2;
+
 typedef enum
 {
   HOTKEY_LEDS_NONE,
@@ -51,14 +59,22 @@ struct __attribute__ ((__packed__)) AnimationOptions
   uint8_t themeIndex;
 };
 
+/* Returns the current time in milliseconds. Every bit of timing in AnimationStation goes through this,
+so effects can be driven by a fake clock when rendering them off-device. */
+typedef uint32_t (*AnimationClock)();
+
 class AnimationStation
 {
 public:
   AnimationStation();
 
-  void Animate();
+  bool Configure(uint16_t ledCount);
+  static size_t ArenaSize(uint16_t ledCount);
+  bool Animate();
+  bool Animate(uint32_t nowMS);
   void HandleEvent(AnimationHotkey action);
   void Clear();
+  void Invalidate();
   void ChangeAnimation(int changeSize);
   void ApplyBrightness(uint32_t *frameValue);
   uint16_t AdjustIndex(int changeSize);
@@ -68,6 +84,10 @@ public:
   uint8_t GetMode();
   void SetMode(uint8_t mode);
   void SetMatrix(PixelMatrix matrix);
+  int AddLayer(BlendMode blendMode = BLEND_REPLACE, uint8_t alpha = 255);
+  void SetLayerAnimation(int index, Animation *animation);
+  void SetLayerBlend(int index, BlendMode blendMode, uint8_t alpha = 255);
+  void SetLayerEnabled(int index, bool enabled);
   static void ConfigureBrightness(uint8_t max, uint8_t steps);
   static float GetBrightnessX();
   static uint8_t GetBrightness();
@@ -75,19 +95,25 @@ public:
   static void DecreaseBrightness();
   static void IncreaseBrightness();
   static void SetOptions(AnimationOptions options);
+  static void SetClock(AnimationClock clock);
+  static uint32_t Now();
 
-  Animation* baseAnimation;
-  Animation* buttonAnimation;
+  std::vector<AnimationLayer> layers;
   std::vector<Pixel> lastPressed;
   static AnimationOptions options;
-  static absolute_time_t nextChange;
-  RGB frame[100];
+  static uint32_t nextChange;
+  static LEDMask dirty;
+  uint16_t ledCount = 0;
+  RGB *frame = nullptr;
 
 protected:
+  bool Composite();
+  LEDMask changed;
   inline static uint8_t getBrightnessStepSize() { return (brightnessMax / brightnessSteps); }
   static uint8_t brightnessMax;
   static uint8_t brightnessSteps;
   static float brightnessX;
+  static AnimationClock clock;
   PixelMatrix matrix;
 };
 
@@ -6,7 +6,7 @@
 class AnimationStorage
 {
   public:
-    void save();
+    void save(AnimationOptions options); // Stores and commits the options if they changed, core0 only
 
     AnimationOptions getAnimationOptions();
     void setAnimationOptions(AnimationOptions options);
@@ -3,11 +3,28 @@
 Chase::Chase(PixelMatrix &matrix) : Animation(matrix) {
 }
 
-void Chase::Animate(RGB (&frame)[100]) {
-  if (!time_reached(this->nextRunTime)) {
-    return;
+bool Chase::Animate(AnimationLayer &layer, uint32_t nowMS) {
+  // A layout without pixels has nothing to chase
+  if (matrix->getPixelCount() == 0) {
+    return false;
   }
 
+  uint32_t cycleTime = (AnimationStation::options.chaseCycleTime > 0) ? AnimationStation::options.chaseCycleTime : 1;
+  uint32_t step = nowMS / cycleTime;
+  if (step == this->lastStep) {
+    return false;
+  }
+
+  // The chase advances one pixel per step while the color sweeps back and forth across the wheel
+  this->lastStep = step;
+  this->currentPixel = step % matrix->getPixelCount();
+  this->currentFrame = step % 510;
+  this->reverse = this->currentFrame > 255;
+  if (this->reverse) {
+    this->currentFrame = 510 - this->currentFrame;
+  }
+
+  bool changed = false;
   for (auto &col : matrix->pixels) {
     for (auto &pixel : col) {
       if (pixel.index == NO_PIXEL.index)
@@ -16,38 +33,16 @@ void Chase::Animate(RGB (&frame)[100]) {
       if (this->IsChasePixel(pixel.index)) {
         RGB color = RGB::wheel(this->WheelFrame(pixel.index));
         for (auto &pos : pixel.positions)
-          frame[pos] = color;
+          changed |= this->WritePixel(layer, pos, color);
       }
       else {
         for (auto &pos : pixel.positions)
-          frame[pos] = ColorBlack;
+          changed |= this->WritePixel(layer, pos, ColorBlack);
       }
     }
   }
 
-  currentPixel++;
-
-  if (currentPixel > matrix->getPixelCount() - 1) {
-    currentPixel = 0;
-  }
-
-  if (reverse) {
-    currentFrame--;
-
-    if (currentFrame < 0) {
-      currentFrame = 1;
-      reverse = false;
-    }
-  } else {
-    currentFrame++;
-
-    if (currentFrame > 255) {
-      currentFrame = 254;
-      reverse = true;
-    }
-  }
-
-  this->nextRunTime = make_timeout_time_ms(AnimationStation::options.chaseCycleTime);
+  return changed;
 }
 
 bool Chase::IsChasePixel(int i) {
@@ -94,4 +89,3 @@ void Chase::ParameterDown() {
     AnimationStation::options.chaseCycleTime = AnimationStation::options.chaseCycleTime - 10;
   }
 }
-
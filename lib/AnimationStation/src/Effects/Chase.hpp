@@ -2,7 +2,6 @@
 #define _CHASE_H_
 
 #include "../Animation.hpp"
-#include "hardware/clocks.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <vector>
@@ -13,7 +12,7 @@ public:
   Chase(PixelMatrix &matrix);
   ~Chase() {};
 
-  void Animate(RGB (&frame)[100]);
+  bool Animate(AnimationLayer &layer, uint32_t nowMS);
   void ParameterUp();
   void ParameterDown();
 
@@ -23,7 +22,7 @@ protected:
   int currentFrame = 0;
   int currentPixel = 0;
   bool reverse = false;
-  absolute_time_t nextRunTime = 0;
+  uint32_t lastStep = UINT32_MAX;
 };
 
 #endif
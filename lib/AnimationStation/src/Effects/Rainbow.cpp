@@ -3,39 +3,33 @@
 Rainbow::Rainbow(PixelMatrix &matrix) : Animation(matrix) {
 }
 
-void Rainbow::Animate(RGB (&frame)[100]) {
-  if (!time_reached(this->nextRunTime)) {
-    return;
+bool Rainbow::Animate(AnimationLayer &layer, uint32_t nowMS) {
+  uint32_t cycleTime = (AnimationStation::options.rainbowCycleTime > 0) ? AnimationStation::options.rainbowCycleTime : 1;
+  uint32_t step = nowMS / cycleTime;
+  if (step == this->lastStep) {
+    return false;
   }
 
+  // Sweep forward through the wheel and back again, one position per step
+  this->lastStep = step;
+  this->currentFrame = step % 510;
+  if (this->currentFrame > 255) {
+    this->currentFrame = 510 - this->currentFrame;
+  }
+
+  bool changed = false;
+  RGB color = RGB::wheel(this->currentFrame);
   for (auto &col : matrix->pixels) {
     for (auto &pixel : col) {
       if (pixel.index == NO_PIXEL.index)
         continue;
 
-      RGB color = RGB::wheel(this->currentFrame);
       for (auto &pos : pixel.positions)
-        frame[pos] = color;
-    }
-  }
-
-  if (reverse) {
-    currentFrame--;
-
-    if (currentFrame < 0) {
-      currentFrame = 1;
-      reverse = false;
-    }
-  } else {
-    currentFrame++;
-
-    if (currentFrame > 255) {
-      currentFrame = 254;
-      reverse = true;
+        changed |= this->WritePixel(layer, pos, color);
     }
   }
 
-  this->nextRunTime = make_timeout_time_ms(AnimationStation::options.rainbowCycleTime);
+  return changed;
 }
 
 void Rainbow::ParameterUp() {
@@ -2,7 +2,6 @@
 #define _RAINBOW_H_
 
 #include "../Animation.hpp"
-#include "hardware/clocks.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <vector>
@@ -13,14 +12,14 @@ public:
   Rainbow(PixelMatrix &matrix);
   ~Rainbow() {};
 
-  void Animate(RGB (&frame)[100]);
+  bool Animate(AnimationLayer &layer, uint32_t nowMS);
   void ParameterUp();
   void ParameterDown();
 
 protected:
   int currentFrame = 0;
   bool reverse = false;
-  absolute_time_t nextRunTime = 0;
+  uint32_t lastStep = UINT32_MAX;
 };
 
 #endif
@@ -7,17 +7,25 @@ StaticColor::StaticColor(PixelMatrix &matrix, std::vector<Pixel> &pixels) : Anim
   this->filtered = true;
 }
 
-void StaticColor::Animate(RGB (&frame)[100]) {
+bool StaticColor::Animate(AnimationLayer &layer, uint32_t nowMS) {
+  bool changed = false;
   for (size_t r = 0; r != matrix->pixels.size(); r++) {
     for (size_t c = 0; c != matrix->pixels[r].size(); c++) {
-      if (matrix->pixels[r][c].index == NO_PIXEL.index || this->notInFilter(matrix->pixels[r][c]))
+      if (matrix->pixels[r][c].index == NO_PIXEL.index)
         continue;
 
+      // Filtered pixels that aren't selected are left transparent so the layers below show through
+      bool skip = this->notInFilter(matrix->pixels[r][c]);
       for (size_t p = 0; p != matrix->pixels[r][c].positions.size(); p++) {
-        frame[matrix->pixels[r][c].positions[p]] = colors[this->GetColor()];
+        if (skip)
+          changed |= this->ErasePixel(layer, matrix->pixels[r][c].positions[p]);
+        else
+          changed |= this->WritePixel(layer, matrix->pixels[r][c].positions[p], colors[this->GetColor()]);
       }
     }
   }
+
+  return changed;
 }
 
 uint8_t StaticColor::GetColor() {
@@ -13,7 +13,7 @@ public:
   StaticColor(PixelMatrix &matrix, std::vector<Pixel> &pixels);
   ~StaticColor() {};
 
-  void Animate(RGB (&frame)[100]);
+  bool Animate(AnimationLayer &layer, uint32_t nowMS);
   void SaveIndexOptions(uint8_t colorIndex);
   uint8_t GetColor();
   void ParameterUp();
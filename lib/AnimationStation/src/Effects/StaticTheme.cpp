@@ -8,7 +8,8 @@ StaticTheme::StaticTheme(PixelMatrix &matrix) : Animation(matrix) {
   }
 }
 
-void StaticTheme::Animate(RGB (&frame)[100]) {
+bool StaticTheme::Animate(AnimationLayer &layer, uint32_t nowMS) {
+  bool changed = false;
   if (StaticTheme::themes.size() > 0) {
     for (size_t r = 0; r != matrix->pixels.size(); r++) {
       for (size_t c = 0; c != matrix->pixels[r].size(); c++) {
@@ -20,16 +21,18 @@ void StaticTheme::Animate(RGB (&frame)[100]) {
         auto itr = theme.find(matrix->pixels[r][c].mask);
         if (itr != theme.end()) {
           for (size_t p = 0; p != matrix->pixels[r][c].positions.size(); p++) {
-            frame[matrix->pixels[r][c].positions[p]] = itr->second;
+            changed |= this->WritePixel(layer, matrix->pixels[r][c].positions[p], itr->second);
           }
         } else {
           for (size_t p = 0; p != matrix->pixels[r][c].positions.size(); p++) {
-            frame[matrix->pixels[r][c].positions[p]] = defaultColor;
+            changed |= this->WritePixel(layer, matrix->pixels[r][c].positions[p], defaultColor);
           }
         }
       }
     }
   }
+
+  return changed;
 }
 
 void StaticTheme::AddTheme(std::map<uint32_t, RGB> theme) {
@@ -17,7 +17,7 @@ public:
 
   static void AddTheme(std::map<uint32_t, RGB> theme);
   static void ClearThemes();
-  void Animate(RGB (&frame)[100]);
+  bool Animate(AnimationLayer &layer, uint32_t nowMS);
   void ParameterUp();
   void ParameterDown();
 protected:
@@ -0,0 +1,4 @@
+#include "LEDArena.hpp"
+
+alignas(8) uint8_t LEDArena::buffer[LED_ARENA_SIZE];
+size_t LEDArena::used = 0;
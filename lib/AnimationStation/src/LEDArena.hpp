@@ -0,0 +1,92 @@
+#ifndef _LED_ARENA_H_
+#define _LED_ARENA_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifndef LED_ARENA_SIZE
+#define LED_ARENA_SIZE 16384 // Enough for ~900 LEDs with the default layer stack
+#endif
+
+/* Fixed block of RAM for every per-LED buffer. It is carved up once when the LEDs are configured and
+reset wholesale on reconfiguration, so the chain length is only limited by this size and the frame
+loop never touches the heap. */
+class LEDArena
+{
+public:
+  static void Reset() { used = 0; }
+  static size_t GetUsed() { return used; }
+
+  /* Returns zeroed storage for count items, or nullptr if the arena is exhausted. */
+  template<typename T>
+  static T *Allocate(size_t count) {
+    size_t offset = (used + alignof(T) - 1) & ~(alignof(T) - 1);
+    size_t size = count * sizeof(T);
+    if (offset + size > LED_ARENA_SIZE)
+      return nullptr;
+
+    used = offset + size;
+    memset(&buffer[offset], 0, size);
+    return reinterpret_cast<T *>(&buffer[offset]);
+  }
+
+private:
+  alignas(8) static uint8_t buffer[LED_ARENA_SIZE];
+  static size_t used;
+};
+
+/* One bit per LED, backed by the arena. Mirrors the parts of std::bitset we use so it can be sized
+to the real chain length at runtime. */
+struct LEDMask
+{
+  uint32_t *words = nullptr;
+  uint16_t wordCount = 0;
+  uint16_t ledCount = 0;
+
+  bool Allocate(uint16_t count) {
+    wordCount = (count + 31) / 32;
+    words = LEDArena::Allocate<uint32_t>(wordCount);
+    ledCount = (words != nullptr) ? count : 0;
+    if (words == nullptr)
+      wordCount = 0;
+
+    return words != nullptr;
+  }
+
+  inline bool test(uint16_t i) const { return words[i >> 5] & (1UL << (i & 31)); }
+  inline void set(uint16_t i) { words[i >> 5] |= (1UL << (i & 31)); }
+  inline void reset(uint16_t i) { words[i >> 5] &= ~(1UL << (i & 31)); }
+
+  inline void set() {
+    for (uint16_t w = 0; w < wordCount; w++)
+      words[w] = 0xFFFFFFFF;
+
+    if (ledCount & 31)
+      words[wordCount - 1] = (1UL << (ledCount & 31)) - 1;
+  }
+
+  inline void reset() {
+    for (uint16_t w = 0; w < wordCount; w++)
+      words[w] = 0;
+  }
+
+  inline bool any() const {
+    for (uint16_t w = 0; w < wordCount; w++)
+      if (words[w])
+        return true;
+
+    return false;
+  }
+
+  inline bool none() const { return !any(); }
+
+  inline LEDMask &operator|=(const LEDMask &rhs) {
+    for (uint16_t w = 0; w < wordCount && w < rhs.wordCount; w++)
+      words[w] |= rhs.words[w];
+
+    return *this;
+  }
+};
+
+#endif
@@ -8,12 +8,12 @@
 
 struct Pixel {
   Pixel(int index, uint32_t mask = 0) : index(index), mask(mask) { }
-  Pixel(int index, std::vector<uint8_t> positions) : index(index), positions(positions) { }
-  Pixel(int index, uint32_t mask, std::vector<uint8_t> positions) : index(index), mask(mask), positions(positions) { }
+  Pixel(int index, std::vector<uint16_t> positions) : index(index), positions(positions) { }
+  Pixel(int index, uint32_t mask, std::vector<uint16_t> positions) : index(index), mask(mask), positions(positions) { }
 
   int index;                      // The pixel index
   uint32_t mask;                  // Used to detect per-pixel lighting
-  std::vector<uint8_t> positions; // The actual LED indexes on the chain
+  std::vector<uint16_t> positions; // The actual LED indexes on the chain
 };
 
 const Pixel NO_PIXEL(-1);
@@ -6,6 +6,11 @@
 
 #include "CRC32.h"
 
+#if !PICO_NO_HARDWARE
+#include "hardware/claim.h"
+#include "hardware/dma.h"
+#endif
+
 static const uint32_t crc32_table[] = {
 	0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac,
 	0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
@@ -35,3 +40,123 @@ uint32_t CRC32::finalize() const
 {
 	return ~_state;
 }
+
+#if PICO_NO_HARDWARE
+
+static uint32_t slice_table[8][256];
+static bool slice_table_ready = false;
+
+static void build_slice_table() {
+	for (uint32_t i = 0; i < 256; i++) {
+		uint32_t value = i;
+		for (int bit = 0; bit < 8; bit++)
+			value = (value >> 1) ^ ((value & 1) ? 0xedb88320 : 0);
+
+		slice_table[0][i] = value;
+	}
+
+	for (uint32_t i = 0; i < 256; i++) {
+		for (int slice = 1; slice < 8; slice++)
+			slice_table[slice][i] = (slice_table[slice - 1][i] >> 8) ^ slice_table[0][slice_table[slice - 1][i] & 0xff];
+	}
+
+	slice_table_ready = true;
+}
+
+uint32_t CRC32::checksum(const void *data, uint32_t size, uint32_t crc) {
+	const uint8_t *pData = (const uint8_t *)data;
+	uint32_t state = ~crc;
+
+	if (!slice_table_ready)
+		build_slice_table();
+
+	for (; size >= 8; size -= 8, pData += 8) {
+		uint32_t lo = state ^ (pData[0] | (pData[1] << 8) | (pData[2] << 16) | ((uint32_t)pData[3] << 24));
+		uint32_t hi = pData[4] | (pData[5] << 8) | (pData[6] << 16) | ((uint32_t)pData[7] << 24);
+
+		state = slice_table[7][lo & 0xff] ^ slice_table[6][(lo >> 8) & 0xff]
+			^ slice_table[5][(lo >> 16) & 0xff] ^ slice_table[4][lo >> 24]
+			^ slice_table[3][hi & 0xff] ^ slice_table[2][(hi >> 8) & 0xff]
+			^ slice_table[1][(hi >> 16) & 0xff] ^ slice_table[0][hi >> 24];
+	}
+
+	for (; size > 0; size--, pData++)
+		state = slice_table[0][(state ^ *pData) & 0xff] ^ (state >> 8);
+
+	return ~state;
+}
+
+#else
+
+static int sniff_channel = -1;
+static volatile bool sniff_busy = false;
+static uint32_t sniff_sink;
+
+static uint32_t reverse_bits(uint32_t value) {
+	uint32_t result = 0;
+	for (int bit = 0; bit < 32; bit++, value >>= 1)
+		result = (result << 1) | (value & 1);
+
+	return result;
+}
+
+// There is only one sniffer, if the other core is using it the byte table is used instead
+static bool acquire_sniffer() {
+	if (sniff_channel < 0) {
+		int channel = dma_claim_unused_channel(false);
+		if (channel < 0)
+			return false;
+
+		uint32_t save = hw_claim_lock();
+		bool first = (sniff_channel < 0);
+		if (first)
+			sniff_channel = channel;
+		hw_claim_unlock(save);
+
+		if (!first)
+			dma_channel_unclaim(channel);
+	}
+
+	uint32_t save = hw_claim_lock();
+	bool acquired = !sniff_busy;
+	sniff_busy = true;
+	hw_claim_unlock(save);
+
+	return acquired;
+}
+
+uint32_t CRC32::checksum(const void *data, uint32_t size, uint32_t crc) {
+	if (size == 0)
+		return crc;
+
+	if (!acquire_sniffer()) {
+		CRC32 fallback;
+		fallback._state = ~crc;
+		for (uint32_t i = 0; i < size; i++)
+			fallback.update(((const uint8_t *)data)[i]);
+
+		return fallback.finalize();
+	}
+
+	dma_channel_config config = dma_channel_get_default_config(sniff_channel);
+	channel_config_set_transfer_data_size(&config, DMA_SIZE_8);
+	channel_config_set_read_increment(&config, true);
+	channel_config_set_write_increment(&config, false);
+	channel_config_set_sniff_enable(&config, true);
+
+	// CRC32R shifts each byte in LSB first, the reversed and inverted output is then the usual reflected CRC-32
+	dma_hw->sniff_data = reverse_bits(~crc);
+	dma_sniffer_enable(sniff_channel, DMA_SNIFF_CTRL_CALC_VALUE_CRC32R, false);
+	hw_set_bits(&dma_hw->sniff_ctrl, DMA_SNIFF_CTRL_OUT_REV_BITS | DMA_SNIFF_CTRL_OUT_INV_BITS);
+
+	dma_channel_configure(sniff_channel, &config, &sniff_sink, data, size, true);
+	dma_channel_wait_for_finish_blocking(sniff_channel);
+	crc = dma_hw->sniff_data;
+
+	dma_sniffer_disable();
+	sniff_busy = false;
+
+	return crc;
+}
+
+#endif
@@ -60,6 +60,15 @@ public:
 		return crc.finalize();
 	}
 
+	/// \brief Calculate the checksum of a block of memory without going through the byte table.
+	/// \details On the RP2040 the DMA sniffer computes the CRC while a DMA channel reads the block,
+	/// off-device a slice-by-8 table is used. The result is always the same as calculate().
+	/// \param data A pointer to the data to checksum.
+	/// \param size The size of the data in bytes.
+	/// \param crc The checksum of the data before this block, to continue a calculation.
+	/// \returns the calculated checksum.
+	static uint32_t checksum(const void *data, uint32_t size, uint32_t crc = 0);
+
 private:
 	/// \brief The internal checksum state.
 	uint32_t _state = ~0L;
@@ -12,11 +12,44 @@
 #include <pico/multicore.h>
 #include <hardware/flash.h>
 #include <hardware/timer.h>
+#include <pico/time.h>
 
 #define EEPROM_SIZE_BYTES    4096           // Reserve 4k of flash memory (ensure this value is divisible by 256)
-#define EEPROM_ADDRESS_START _u(0x101FF000) // The arduino-pico EEPROM lib starts here, so we'll do the same
-// Warning: If the write wait is too long it can stall other processes
-#define EEPROM_WRITE_WAIT    50             // Amount of time in ms to wait before blocking core1 and committing to flash
+#define EEPROM_ADDRESS_START _u(0x101FF000) // The arduino-pico EEPROM lib starts here, now only read to migrate old saves
+#define EEPROM_WRITE_WAIT    50             // Amount of time in ms to wait for more changes before committing to flash
+
+// The cache is saved as a log of records spread over several sectors directly below the old EEPROM sector
+#define EEPROM_LOG_SECTORS       8
+#define EEPROM_LOG_START         (EEPROM_ADDRESS_START - (EEPROM_LOG_SECTORS * FLASH_SECTOR_SIZE))
+#define EEPROM_BLOCK_SIZE        16 // Granularity of change tracking
+#define EEPROM_BLOCK_COUNT       (EEPROM_SIZE_BYTES / EEPROM_BLOCK_SIZE)
+#define EEPROM_PAGES_PER_SECTOR  ((int)(FLASH_SECTOR_SIZE / FLASH_PAGE_SIZE))
+#define EEPROM_LOG_PAGES         (EEPROM_LOG_SECTORS * EEPROM_PAGES_PER_SECTOR)
+#define EEPROM_RECORD_BLOCKS     ((int)(EEPROM_RECORD_DATA_SIZE / EEPROM_BLOCK_SIZE))
+
+// Records needed for the whole cache, the most a commit or a compaction step ever writes
+#define EEPROM_MAX_RECORDS       ((EEPROM_BLOCK_COUNT + EEPROM_RECORD_BLOCKS - 1) / EEPROM_RECORD_BLOCKS)
+
+// Free pages kept ahead of the log, room for the largest commit and a compaction step after it
+#define EEPROM_RESERVED_PAGES    (2 * EEPROM_MAX_RECORDS)
+
+/* One flash page of the log. A record holds a contiguous run of blocks from the cache, the newest record
+covering a block wins. An erased page reads as sequence 0xFFFFFFFF and never passes the CRC.
+All records written for one commit carry the sequence of its first record, and the last one also has
+EEPROM_COMMIT_LAST set. A commit cut short by a power loss has no last record and is ignored as a whole.
+Records from before commits were grouped have this field erased and each stand on their own. */
+struct FlashRecord
+{
+	uint32_t sequence;
+	uint16_t offset;
+	uint16_t length;
+	uint32_t crc;      // Covers the sequence, offset, length and data, plus the commit when it is set
+	uint32_t commit;
+	uint8_t data[FLASH_PAGE_SIZE - 16];
+};
+
+#define EEPROM_COMMIT_LAST      0x80000000
+#define EEPROM_RECORD_DATA_SIZE (sizeof(FlashRecord::data) - (sizeof(FlashRecord::data) % EEPROM_BLOCK_SIZE))
 
 class FlashPROM
 {
@@ -24,6 +57,8 @@ class FlashPROM
 		void start();
 		void commit();
 		void reset();
+		void poll(bool idle);
+		bool isBusy();
 
 		template<typename T>
 		T &get(uint16_t const index, T &value)
@@ -43,6 +78,23 @@ class FlashPROM
 				memcpy(&cache[index], &value, sizeof(T));
 		}
 
+		void get(uint16_t const index, void *data, uint16_t size)
+		{
+			if ((index + size) <= EEPROM_SIZE_BYTES)
+				memcpy(data, &cache[index], size);
+		}
+
+		void set(uint16_t const index, const void *data, uint16_t size)
+		{
+			if ((index + size) <= EEPROM_SIZE_BYTES)
+				memcpy(&cache[index], data, size);
+		}
+
+		static uint32_t eraseCount;   // Sectors erased since boot
+		static uint32_t programCount; // Pages programmed since boot
+		static uint32_t lastStallUS;  // Time core1 was locked out by the last flash step
+		static uint32_t maxStallUS;   // Worst case of the above since boot
+
 	private:
 		static uint8_t cache[EEPROM_SIZE_BYTES];
 };
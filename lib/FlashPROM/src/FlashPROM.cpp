@@ -4,49 +4,411 @@
  */
 
 #include "FlashPROM.h"
+#include "CRC32.h"
 
 uint8_t FlashPROM::cache[EEPROM_SIZE_BYTES] = { };
-volatile static alarm_id_t flashWriteAlarm = 0;
+uint32_t FlashPROM::eraseCount = 0;
+uint32_t FlashPROM::programCount = 0;
+uint32_t FlashPROM::lastStallUS = 0;
+uint32_t FlashPROM::maxStallUS = 0;
 volatile static spin_lock_t *flashLock = nullptr;
+volatile static bool commitPending = false;
+volatile static uint32_t commitTimeMS = 0;
 
-int64_t writeToFlash(alarm_id_t id, void *flashCache)
+typedef enum
 {
-	while (is_spin_locked(flashLock));
+	WRITE_IDLE,
+	WRITE_APPEND,   // Writing the blocks changed by the last commit
+	WRITE_RELOCATE, // Moving the live blocks out of the oldest sector
+	WRITE_ERASE,    // Erasing the oldest sector
+} WriteStage;
 
+static uint8_t image[EEPROM_SIZE_BYTES];       // Contents of the cache as currently stored in the log
+static uint8_t blockOwner[EEPROM_BLOCK_COUNT]; // Log sector holding the newest copy of each block, 0xFF if never written
+static uint32_t nextSequence = 0;
+static uint32_t commitStart = 0; // Sequence of the first record of the commit being appended
+static uint8_t headSector = 0; // Sector currently being appended to
+static uint8_t headPage = 0;   // Next free page in the head sector
+static uint8_t tailSector = 0; // Oldest sector still holding records
+
+static volatile WriteStage writeStage = WRITE_IDLE;
+static bool selected[EEPROM_BLOCK_COUNT]; // Blocks the current stage still has to write
+static int nextBlock = 0;
+
+static inline const FlashRecord *logRecord(int page)
+{
+	return reinterpret_cast<const FlashRecord *>(EEPROM_LOG_START + (page * FLASH_PAGE_SIZE));
+}
+
+static inline uint32_t logOffset(int sector, int page = 0)
+{
+	return (EEPROM_LOG_START - XIP_BASE) + (sector * FLASH_SECTOR_SIZE) + (page * FLASH_PAGE_SIZE);
+}
+
+static uint32_t __not_in_flash_func(recordCRC)(const FlashRecord *record)
+{
+	uint32_t crc = CRC32::checksum(record, 8); // sequence, offset and length
+	crc = CRC32::checksum(record->data, record->length, crc);
+	if (record->commit != 0xFFFFFFFF)
+		crc = CRC32::checksum(&record->commit, sizeof(record->commit), crc);
+
+	return crc;
+}
+
+// Records without a commit are from before commits were grouped, each of them is a commit of its own
+static inline uint32_t recordCommit(const FlashRecord *record)
+{
+	return (record->commit == 0xFFFFFFFF) ? record->sequence : (record->commit & ~EEPROM_COMMIT_LAST);
+}
+
+static inline bool endsCommit(const FlashRecord *record)
+{
+	return record->commit == 0xFFFFFFFF || (record->commit & EEPROM_COMMIT_LAST) != 0;
+}
+
+static bool isValidRecord(const FlashRecord *record)
+{
+	return record->sequence != 0xFFFFFFFF
+		&& record->length > 0
+		&& record->length <= EEPROM_RECORD_DATA_SIZE
+		&& (record->offset % EEPROM_BLOCK_SIZE) == 0
+		&& (record->length % EEPROM_BLOCK_SIZE) == 0
+		&& (record->offset + record->length) <= EEPROM_SIZE_BYTES
+		&& record->crc == recordCRC(record);
+}
+
+static bool isBlank(const uint8_t *data, uint32_t size)
+{
+	for (uint32_t i = 0; i < size; i++)
+	{
+		if (data[i] != 0xFF)
+			return false;
+	}
+
+	return true;
+}
+
+static inline int erasedSectors()
+{
+	return EEPROM_LOG_SECTORS - (((headSector - tailSector + EEPROM_LOG_SECTORS) % EEPROM_LOG_SECTORS) + 1);
+}
+
+// Pages that can be appended before the head would run into the tail
+static inline int freePages()
+{
+	return (erasedSectors() * EEPROM_PAGES_PER_SECTOR) + (EEPROM_PAGES_PER_SECTOR - headPage);
+}
+
+static void __not_in_flash_func(eraseSector)(int sector)
+{
+	flash_range_erase(logOffset(sector), FLASH_SECTOR_SIZE);
+	FlashPROM::eraseCount++;
+}
+
+// Programs a single page record with the given range of the stored image
+static void __not_in_flash_func(appendRecord)(uint16_t offset, uint16_t length, bool last)
+{
+	static FlashRecord record;
+
+	if (headPage == EEPROM_PAGES_PER_SECTOR)
+	{
+		headSector = (headSector + 1) % EEPROM_LOG_SECTORS;
+		headPage = 0;
+	}
+
+	memset(&record, 0xFF, sizeof(FlashRecord));
+	record.sequence = nextSequence++;
+	record.offset = offset;
+	record.length = length;
+	record.commit = commitStart | (last ? EEPROM_COMMIT_LAST : 0);
+	memcpy(record.data, &image[offset], length);
+	record.crc = recordCRC(&record);
+
+	flash_range_program(logOffset(headSector, headPage), reinterpret_cast<const uint8_t *>(&record), FLASH_PAGE_SIZE);
+	FlashPROM::programCount++;
+	headPage++;
+
+	for (int block = offset / EEPROM_BLOCK_SIZE; block < (offset + length) / EEPROM_BLOCK_SIZE; block++)
+		blockOwner[block] = headSector;
+}
+
+/* Finds the next record to write from the selected blocks. A page costs the same however much of it is
+used, so unselected blocks between two selected ones are written along with them. This also means
+relocating a sector never takes more records than the sector held. */
+static bool nextRun(uint16_t &offset, uint16_t &length)
+{
+	while (nextBlock < EEPROM_BLOCK_COUNT && !selected[nextBlock])
+		nextBlock++;
+
+	if (nextBlock >= EEPROM_BLOCK_COUNT)
+		return false;
+
+	int first = nextBlock;
+	int last = nextBlock;
+	for (int block = first; block < EEPROM_BLOCK_COUNT && (block - first) < EEPROM_RECORD_BLOCKS; block++)
+	{
+		if (selected[block])
+			last = block;
+	}
+
+	nextBlock = last + 1;
+	offset = first * EEPROM_BLOCK_SIZE;
+	length = (last - first + 1) * EEPROM_BLOCK_SIZE;
+	return true;
+}
+
+static bool hasNextRun()
+{
+	for (int block = nextBlock; block < EEPROM_BLOCK_COUNT; block++)
+	{
+		if (selected[block])
+			return true;
+	}
+
+	return false;
+}
+
+// Number of records the selected blocks take
+static int countRuns()
+{
+	uint16_t offset, length;
+	int runs = 0;
+
+	nextBlock = 0;
+	while (nextRun(offset, length))
+		runs++;
+
+	nextBlock = 0;
+	return runs;
+}
+
+/* Relocates the oldest sector when too few free pages are left ahead of the head, otherwise the write is done.
+Relocating never takes more pages than erasing the sector gives back, but when every page of the sector is
+still live it gives back nothing either. The whole image is rewritten instead then, which leaves every older
+record dead so the following steps only erase. */
+static void planCompaction()
+{
+	if (freePages() >= EEPROM_RESERVED_PAGES || tailSector == headSector)
+	{
+		writeStage = WRITE_IDLE;
+		return;
+	}
+
+	for (int block = 0; block < EEPROM_BLOCK_COUNT; block++)
+		selected[block] = (blockOwner[block] == tailSector);
+
+	if (countRuns() >= EEPROM_PAGES_PER_SECTOR && freePages() >= EEPROM_MAX_RECORDS)
+		memset(selected, true, sizeof(selected));
+
+	nextBlock = 0;
+	writeStage = WRITE_RELOCATE;
+}
+
+/* Takes a snapshot of the changed blocks, so the cache can keep changing while they are written. The commit
+only starts when a compaction step still fits after it, so the head can never be appended into the tail.
+Returns false without taking anything when compaction has to make room first. */
+static bool planCommit(const uint8_t *cache)
+{
+	bool changed = false;
+
+	for (int block = 0; block < EEPROM_BLOCK_COUNT; block++)
+	{
+		uint16_t offset = block * EEPROM_BLOCK_SIZE;
+		selected[block] = memcmp(&cache[offset], &image[offset], EEPROM_BLOCK_SIZE) != 0;
+		changed |= selected[block];
+	}
+
+	if (!changed)
+	{
+		planCompaction();
+		return true;
+	}
+
+	if (freePages() < countRuns() + EEPROM_MAX_RECORDS)
+		return false;
+
+	for (int block = 0; block < EEPROM_BLOCK_COUNT; block++)
+	{
+		if (selected[block])
+			memcpy(&image[block * EEPROM_BLOCK_SIZE], &cache[block * EEPROM_BLOCK_SIZE], EEPROM_BLOCK_SIZE);
+	}
+
+	nextBlock = 0;
+	commitStart = nextSequence;
+	writeStage = WRITE_APPEND;
+	return true;
+}
+
+/* Runs a single page program or sector erase. Core1 is locked out while the XIP cache is unavailable,
+so this and everything it calls during the lockout run from RAM to keep the stall as short as possible. */
+static void __not_in_flash_func(writeStep)()
+{
+	uint16_t offset = 0;
+	uint16_t length = 0;
+	bool erase = false;
+	bool last = true;
+
+	if (writeStage == WRITE_ERASE)
+	{
+		erase = true;
+	}
+	else if (!nextRun(offset, length))
+	{
+		if (writeStage == WRITE_RELOCATE)
+			writeStage = WRITE_ERASE;
+		else
+			planCompaction();
+
+		return;
+	}
+	else if (writeStage == WRITE_APPEND)
+	{
+		last = !hasNextRun();
+	}
+	else
+	{
+		// Relocated blocks are already committed, so every record is a commit of its own
+		commitStart = nextSequence;
+	}
+
+	uint32_t startUS = time_us_32();
 	multicore_lockout_start_blocking();
 	uint32_t interrupts = spin_lock_blocking(flashLock);
 
-	flash_range_erase((intptr_t)EEPROM_ADDRESS_START - (intptr_t)XIP_BASE, EEPROM_SIZE_BYTES);
-	flash_range_program((intptr_t)EEPROM_ADDRESS_START - (intptr_t)XIP_BASE, reinterpret_cast<uint8_t *>(flashCache), EEPROM_SIZE_BYTES);
+	if (erase)
+		eraseSector(tailSector);
+	else
+		appendRecord(offset, length, last);
 
-	flashWriteAlarm = 0;
 	multicore_lockout_end_blocking();
 	spin_unlock(flashLock, interrupts);
 
-	return 0;
+	uint32_t stallUS = time_us_32() - startUS;
+	FlashPROM::lastStallUS = stallUS;
+	if (stallUS > FlashPROM::maxStallUS)
+		FlashPROM::maxStallUS = stallUS;
+
+	if (erase)
+	{
+		tailSector = (tailSector + 1) % EEPROM_LOG_SECTORS;
+		planCompaction();
+	}
 }
 
+/* Rebuilds the cache by replaying every complete commit in sequence order. Runs before the second core
+is started, so sectors left in an unknown state by a power loss can be erased right away. */
 void FlashPROM::start()
 {
+	static uint16_t order[EEPROM_LOG_PAGES];
+	int count = 0;
+	bool restored = false;
+
 	if (flashLock == nullptr)
 		flashLock = spin_lock_instance(spin_lock_claim_unused(true));
 
-	memcpy(cache, reinterpret_cast<uint8_t *>(EEPROM_ADDRESS_START), EEPROM_SIZE_BYTES);
+	commitPending = false;
+	writeStage = WRITE_IDLE;
+	memset(image, 0, EEPROM_SIZE_BYTES);
+	memset(blockOwner, 0xFF, EEPROM_BLOCK_COUNT);
 
-	// When flash is new/reset, all bits are set to 1.
-	// If all bits from the FlashPROM section are 1's then set to 0's.
-	bool reset = true;
-	for (int i = 0; i < EEPROM_SIZE_BYTES; i++)
+	for (int page = 0; page < EEPROM_LOG_PAGES; page++)
 	{
-		if (cache[i] != 0xFF)
+		if (!isValidRecord(logRecord(page)))
+			continue;
+
+		// Insertion sort by sequence, the log only has a few hundred pages
+		int i = count++;
+		while (i > 0 && logRecord(order[i - 1])->sequence > logRecord(page)->sequence)
 		{
-			reset = false;
-			break;
+			order[i] = order[i - 1];
+			i--;
 		}
+		order[i] = page;
 	}
 
-	if (reset)
-		this->reset();
+	// A commit is only applied once its last record is found, records of an earlier one that never ended are dropped
+	int first = 0;
+	for (int i = 0; i < count; i++)
+	{
+		if (recordCommit(logRecord(order[i])) != recordCommit(logRecord(order[first])))
+			first = i;
+
+		if (!endsCommit(logRecord(order[i])))
+			continue;
+
+		for (; first <= i; first++)
+		{
+			const FlashRecord *record = logRecord(order[first]);
+			memcpy(&image[record->offset], record->data, record->length);
+			for (int block = record->offset / EEPROM_BLOCK_SIZE; block < (record->offset + record->length) / EEPROM_BLOCK_SIZE; block++)
+				blockOwner[block] = order[first] / EEPROM_PAGES_PER_SECTOR;
+		}
+
+		restored = true;
+	}
+
+	if (count > 0)
+	{
+		int last = order[count - 1];
+		nextSequence = logRecord(last)->sequence + 1;
+		headSector = last / EEPROM_PAGES_PER_SECTOR;
+		headPage = (last % EEPROM_PAGES_PER_SECTOR) + 1;
+
+		// Skip anything a torn write left behind after the newest record
+		while (headPage < EEPROM_PAGES_PER_SECTOR && !isBlank(reinterpret_cast<const uint8_t *>(logRecord(last + 1)), FLASH_PAGE_SIZE))
+		{
+			headPage++;
+			last++;
+		}
+
+		// The oldest sector is the first one after the head that still holds records
+		tailSector = headSector;
+		for (int i = 1; i < EEPROM_LOG_SECTORS; i++)
+		{
+			int sector = (headSector + i) % EEPROM_LOG_SECTORS;
+			for (int page = 0; page < EEPROM_PAGES_PER_SECTOR; page++)
+			{
+				if (isValidRecord(logRecord((sector * EEPROM_PAGES_PER_SECTOR) + page)))
+				{
+					tailSector = sector;
+					break;
+				}
+			}
+
+			if (tailSector != headSector)
+				break;
+		}
+	}
+	else
+	{
+		nextSequence = 0;
+		headSector = tailSector = 0;
+		headPage = 0;
+	}
+
+	// Everything between the head and the tail is appended to next, so it has to be erased
+	for (int i = (count > 0) ? 1 : 0; i <= erasedSectors(); i++)
+	{
+		int sector = (headSector + i) % EEPROM_LOG_SECTORS;
+		if (!isBlank(reinterpret_cast<const uint8_t *>(EEPROM_LOG_START + (sector * FLASH_SECTOR_SIZE)), FLASH_SECTOR_SIZE))
+		{
+			uint32_t interrupts = save_and_disable_interrupts();
+			eraseSector(sector);
+			restore_interrupts(interrupts);
+		}
+	}
+
+	if (!restored && !isBlank(reinterpret_cast<const uint8_t *>(EEPROM_ADDRESS_START), EEPROM_SIZE_BYTES))
+	{
+		// Saves from before the log are migrated once, the old sector is left untouched
+		memcpy(cache, reinterpret_cast<uint8_t *>(EEPROM_ADDRESS_START), EEPROM_SIZE_BYTES);
+		commit();
+	}
+	else
+	{
+		// When flash is new/reset, nothing has been written yet and the cache stays zeroed
+		memcpy(cache, image, EEPROM_SIZE_BYTES);
+	}
 }
 
 /* We don't have an actual EEPROM, so we need to be extra careful about minimizing writes. Instead
@@ -54,9 +416,36 @@ void FlashPROM::start()
 	to commit in that timeframe, we'll hold off until the user is done sending changes. */
 void FlashPROM::commit()
 {
-	while (is_spin_locked(flashLock));
-	cancel_alarm(flashWriteAlarm);
-	flashWriteAlarm = add_alarm_in_ms(EEPROM_WRITE_WAIT, writeToFlash, cache, true);
+	commitTimeMS = to_ms_since_boot(get_absolute_time()) + EEPROM_WRITE_WAIT;
+	commitPending = true;
+}
+
+/* Called once per input frame on core0. Writes only happen while the caller reports the input as idle,
+and each call does at most one page program or sector erase, so a large commit is spread over frames. */
+void FlashPROM::poll(bool idle)
+{
+	if (!idle)
+		return;
+
+	if (writeStage == WRITE_IDLE)
+	{
+		if (!commitPending || (int32_t)(to_ms_since_boot(get_absolute_time()) - commitTimeMS) < 0)
+			return;
+
+		// Make room first when the commit and a compaction step after it don't both fit
+		if (planCommit(cache))
+			commitPending = false;
+		else
+			planCompaction();
+	}
+
+	if (writeStage != WRITE_IDLE)
+		writeStep();
+}
+
+bool FlashPROM::isBusy()
+{
+	return commitPending || writeStage != WRITE_IDLE;
 }
 
 void FlashPROM::reset()
@@ -11,55 +11,94 @@
 
 #include "pico/stdlib.h"
 #include "hardware/pio.h"
+#include "hardware/dma.h"
 #include "hardware/clocks.h"
 #include "NeoPico.hpp"
 
+int NeoPico::programOffsets[NUM_PIOS] = { -1, -1 };
+
 LEDFormat NeoPico::GetFormat() {
   return format;
 }
 
-void NeoPico::PutPixel(uint32_t pixelData) {
-  switch (format) {
-    case LED_FORMAT_GRB:
-    case LED_FORMAT_RGB:
-      pio_sm_put_blocking(pio0, 0, pixelData << 8u);
-      break;
-    case LED_FORMAT_GRBW:
-    case LED_FORMAT_RGBW:
-      pio_sm_put_blocking(pio0, 0, pixelData);
-      break;
+NeoPico::NeoPico(int ledPin, int numPixels, uint32_t *frame, LEDFormat format) : format(format), numPixels(numPixels), frame(frame) {
+  // Take the first free state machine, spilling over to pio1 once pio0 is full
+  sm = pio_claim_unused_sm(pio0, false);
+  if (sm < 0) {
+    pio = pio1;
+    sm = pio_claim_unused_sm(pio1, true);
   }
-}
 
-NeoPico::NeoPico(int ledPin, int numPixels, LEDFormat format) : format(format), numPixels(numPixels) {
-  PIO pio = pio0;
-  int sm = 0;
-  uint offset = pio_add_program(pio, &ws2812_program);
+  // The program is shared by every state machine on a PIO block, only load it once
+  uint pioIndex = pio_get_index(pio);
+  if (programOffsets[pioIndex] < 0)
+    programOffsets[pioIndex] = pio_add_program(pio, &ws2812_program);
+
   bool rgbw = (format == LED_FORMAT_GRBW) || (format == LED_FORMAT_RGBW);
-  ws2812_program_init(pio, sm, offset, ledPin, 800000, rgbw);
+  bitsPerPixel = rgbw ? 32 : 24;
+  ws2812_program_init(pio, sm, programOffsets[pioIndex], ledPin, 800000, rgbw);
+
+  dmaChannel = dma_claim_unused_channel(true);
+  dma_channel_config config = dma_channel_get_default_config(dmaChannel);
+  channel_config_set_transfer_data_size(&config, DMA_SIZE_32);
+  channel_config_set_read_increment(&config, true);
+  channel_config_set_write_increment(&config, false);
+  channel_config_set_dreq(&config, pio_get_dreq(pio, sm, true));
+  dma_channel_configure(dmaChannel, &config, &pio->txf[sm], frame, numPixels, false);
+
   this->Clear();
-  sleep_ms(10);
 }
 
-void NeoPico::Clear() {
-  memset(frame, 0, sizeof(frame));
+NeoPico::~NeoPico() {
+  this->Wait();
+  dma_channel_unclaim(dmaChannel);
+  pio_sm_set_enabled(pio, sm, false);
+  pio_sm_unclaim(pio, sm);
 }
 
-void NeoPico::SetFrame(uint32_t newFrame[100]) {
-  memcpy(frame, newFrame, sizeof(frame));
+/* Blocks until the last frame has been clocked out and latched. */
+void NeoPico::Wait() {
+  dma_channel_wait_for_finish_blocking(dmaChannel);
+  sleep_until(latchTime);
 }
 
-void NeoPico::Show() {
+void NeoPico::Clear() {
+  this->Wait();
+  memset(frame, 0, numPixels * sizeof(uint32_t));
+}
+
+/* Returns false when the new frame is identical to the last one, so the caller can skip Show(). */
+bool NeoPico::SetFrame(uint32_t *newFrame) {
+  uint8_t shift = 32 - bitsPerPixel; // The PIO program shifts out from the MSB
+  bool changed = false;
+
   for (int i = 0; i < this->numPixels; ++i) {
-     this->PutPixel(this->frame[i]);
+    uint32_t value = newFrame[i] << shift;
+    if (frame[i] != value) {
+      // Don't touch the buffer while the previous frame is still being read out of it
+      if (!changed)
+        this->Wait();
+
+      frame[i] = value;
+      changed = true;
+    }
   }
-  sleep_ms(10);
+
+  return changed;
+}
+
+/* Starts the transfer and returns immediately, the DMA channel feeds the state machine in the background. */
+void NeoPico::Show() {
+  this->Wait();
+  dma_channel_transfer_from_buffer_now(dmaChannel, frame, numPixels);
+
+  // 1.25us per bit at 800kHz, plus the reset time before the next frame may start
+  uint32_t transferUS = (numPixels * bitsPerPixel * 5) / 4;
+  latchTime = make_timeout_time_us(transferUS + WS2812_LATCH_US);
 }
 
 void NeoPico::Off() {
   Clear();
-  for (int i = 0; i < this->numPixels; ++i) {
-     this->PutPixel(this->frame[i]);
-  }
-  sleep_ms(10);
+  Show();
+  Wait();
 }
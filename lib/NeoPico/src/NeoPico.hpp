@@ -1,6 +1,7 @@
 #ifndef _NEO_PICO_H_
 #define _NEO_PICO_H_
 
+#include <stdint.h>
 #include "ws2812.pio.h"
 #include <vector>
 
@@ -12,22 +13,42 @@ typedef enum
   LED_FORMAT_RGBW = 3,
 } LEDFormat;
 
+#if !PICO_NO_HARDWARE
+#include "hardware/dma.h"
+#include "pico/time.h"
+
+#define WS2812_LATCH_US 300 // Time the data line has to be held low between frames
+
+/* A single WS2812 chain. Each instance claims its own PIO state machine and DMA channel, so several
+chains on different pins can transmit at the same time. */
 class NeoPico
 {
 public:
-  NeoPico(int ledPin, int numPixels, LEDFormat format = LED_FORMAT_GRB);
+  NeoPico(int ledPin, int numPixels, uint32_t *frame, LEDFormat format = LED_FORMAT_GRB);
+  ~NeoPico();
   void Show();
   void Clear();
   void Off();
+  void Wait();
   LEDFormat GetFormat();
   // void SetPixel(int pixel, uint32_t color);
-  void SetFrame(uint32_t newFrame[100]);
+  bool SetFrame(uint32_t *newFrame);
 private:
-  void PutPixel(uint32_t pixel_grb);
   LEDFormat format;
   PIO pio = pio0;
+  int sm = -1;
+  int dmaChannel = -1;
   int numPixels = 0;
-  uint32_t frame[100];
+  uint8_t bitsPerPixel = 24;
+  uint32_t *frame; // Owned by the caller, sized to numPixels and stored in wire format
+  absolute_time_t latchTime = 0;
+  static int programOffsets[NUM_PIOS];
 };
 
+#else
+
+class NeoPico; // Host builds only hold pointers to chains, nothing is driven
+
+#endif
+
 #endif
@@ -0,0 +1,24 @@
+/*
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "tusb.h"
+#include "GamepadDescriptors.h"
+
+// Adds a vendor HID interface to the HID and XInput configurations, set to 0 to present the gamepad alone
+#ifndef USB_CONFIG_INTERFACE
+#define USB_CONFIG_INTERFACE 1
+#endif
+
+// Every request and response is one fixed size report without a report ID
+#define CONFIG_REPORT_SIZE CFG_TUD_HID_EP_BUFSIZE
+
+bool config_interface_enabled(void);
+uint8_t config_hid_instance(void);
+uint8_t const *config_report_descriptor(void);
+uint8_t const *add_config_interface(uint8_t const *configuration);
+void config_report_received(uint8_t const *buffer, uint16_t size);
+uint16_t get_config_report(uint8_t *buffer, uint16_t size);
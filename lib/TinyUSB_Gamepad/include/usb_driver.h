@@ -17,4 +17,6 @@ InputMode get_input_mode(void);
 void initialize_driver(InputMode mode);
 void receive_report(uint8_t *buffer);
 void send_report(void *report, uint16_t report_size);
+bool receive_config_report(uint8_t *buffer);
+bool send_config_report(uint8_t const *buffer);
 
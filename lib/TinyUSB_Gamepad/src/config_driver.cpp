@@ -0,0 +1,115 @@
+/*
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <string.h>
+#include "config_driver.h"
+#include "usb_driver.h"
+
+static uint8_t const config_report_desc[] =
+{
+	TUD_HID_REPORT_DESC_GENERIC_INOUT(CONFIG_REPORT_SIZE)
+};
+
+// Largest gamepad configuration plus the interface added here
+static uint8_t composite_descriptor[256];
+
+// One request is buffered until the main loop picks it up, the host waits for the response before sending the next
+static uint8_t request_buffer[CONFIG_REPORT_SIZE];
+static volatile bool request_pending = false;
+static uint8_t response_buffer[CONFIG_REPORT_SIZE];
+
+// Switch consoles reject unknown interfaces, so the config interface stays off in Switch mode
+bool config_interface_enabled(void)
+{
+	InputMode mode = get_input_mode();
+	return USB_CONFIG_INTERFACE && (mode == INPUT_MODE_HID || mode == INPUT_MODE_XINPUT);
+}
+
+// TinyUSB numbers HID interfaces in descriptor order, the gamepad comes first in HID mode
+uint8_t config_hid_instance(void)
+{
+	return (get_input_mode() == INPUT_MODE_HID) ? 1 : 0;
+}
+
+uint8_t const *config_report_descriptor(void)
+{
+	return config_report_desc;
+}
+
+/* Appends the config interface to a gamepad configuration descriptor. It takes the next interface number
+and the first endpoint number the gamepad does not use, so the gamepad interfaces are left untouched. */
+uint8_t const *add_config_interface(uint8_t const *configuration)
+{
+	static uint8_t const *composed_from = nullptr;
+	if (composed_from == configuration)
+		return composite_descriptor;
+
+	uint16_t length = configuration[2] | (configuration[3] << 8);
+	uint8_t interface_count = configuration[4];
+
+	uint8_t endpoint_number = 0;
+	for (uint16_t i = 0; i < length && configuration[i] != 0; i += configuration[i])
+	{
+		if (configuration[i + 1] == TUSB_DESC_ENDPOINT && (configuration[i + 2] & 0x0F) > endpoint_number)
+			endpoint_number = configuration[i + 2] & 0x0F;
+	}
+	endpoint_number++;
+
+	uint8_t const interface[] =
+	{
+		TUD_HID_INOUT_DESCRIPTOR(interface_count, 0, HID_ITF_PROTOCOL_NONE, sizeof(config_report_desc),
+			endpoint_number, 0x80 | endpoint_number, CONFIG_REPORT_SIZE, 1)
+	};
+
+	if (length + sizeof(interface) > sizeof(composite_descriptor))
+		return configuration;
+
+	memcpy(composite_descriptor, configuration, length);
+	memcpy(&composite_descriptor[length], interface, sizeof(interface));
+	length += sizeof(interface);
+	composite_descriptor[2] = length & 0xFF;
+	composite_descriptor[3] = length >> 8;
+	composite_descriptor[4] = interface_count + 1;
+
+	composed_from = configuration;
+	return composite_descriptor;
+}
+
+// Called by TinyUSB for OUT reports and SET_REPORT requests on the config interface
+void config_report_received(uint8_t const *buffer, uint16_t size)
+{
+	if (request_pending)
+		return;
+
+	memset(request_buffer, 0, sizeof(request_buffer));
+	memcpy(request_buffer, buffer, (size < sizeof(request_buffer)) ? size : sizeof(request_buffer));
+	request_pending = true;
+}
+
+uint16_t get_config_report(uint8_t *buffer, uint16_t size)
+{
+	uint16_t length = (size < sizeof(response_buffer)) ? size : sizeof(response_buffer);
+	memcpy(buffer, response_buffer, length);
+	return length;
+}
+
+bool receive_config_report(uint8_t *buffer)
+{
+	if (!request_pending)
+		return false;
+
+	memcpy(buffer, request_buffer, CONFIG_REPORT_SIZE);
+	request_pending = false;
+	return true;
+}
+
+bool send_config_report(uint8_t const *buffer)
+{
+	uint8_t instance = config_hid_instance();
+	if (!tud_hid_n_ready(instance))
+		return false;
+
+	memcpy(response_buffer, buffer, CONFIG_REPORT_SIZE);
+	return tud_hid_n_report(instance, 0, response_buffer, CONFIG_REPORT_SIZE);
+}
@@ -16,6 +16,7 @@
 #include "net_driver.h"
 #include "hid_driver.h"
 #include "xinput_driver.h"
+#include "config_driver.h"
 
 UsbMode usb_mode = USB_MODE_HID;
 InputMode input_mode = INPUT_MODE_XINPUT;
@@ -84,6 +85,14 @@ const usbd_class_driver_t *usbd_app_driver_get_cb(uint8_t *driver_count)
 		switch (input_mode)
 		{
 			case INPUT_MODE_XINPUT:
+				if (config_interface_enabled())
+				{
+					// HID first, xinput_open() would claim the config interface too
+					static const usbd_class_driver_t xinput_config_drivers[] = { hid_driver, xinput_driver };
+					*driver_count = 2;
+					return xinput_config_drivers;
+				}
+
 				return &xinput_driver;
 
 			default:
@@ -99,6 +108,9 @@ const usbd_class_driver_t *usbd_app_driver_get_cb(uint8_t *driver_count)
 // Return zero will cause the stack to STALL request
 uint16_t tud_hid_get_report_cb(uint8_t itf, uint8_t report_id, hid_report_type_t report_type, uint8_t *buffer, uint16_t reqlen)
 {
+	if (config_interface_enabled() && itf == config_hid_instance())
+		return get_config_report(buffer, reqlen);
+
 	// TODO: Handle the correct report type, if required
 	(void)itf;
 	(void)report_id;
@@ -128,7 +140,11 @@ uint16_t tud_hid_get_report_cb(uint8_t itf, uint8_t report_id, hid_report_type_t
 // received data on OUT endpoint ( Report ID = 0, Type = 0 )
 void tud_hid_set_report_cb(uint8_t itf, uint8_t report_id, hid_report_type_t report_type, uint8_t const *buffer, uint16_t bufsize)
 {
-	(void) itf;
+	if (config_interface_enabled() && itf == config_hid_instance())
+	{
+		config_report_received(buffer, bufsize);
+		return;
+	}
 
 	// echo back anything we received from host
 	tud_hid_report(report_id, buffer, bufsize);
@@ -9,6 +9,7 @@
 #include "usb_driver.h"
 #include "GamepadDescriptors.h"
 #include "webserver_descriptors.h"
+#include "config_driver.h"
 
 // Invoked when received GET STRING DESCRIPTOR request
 // Application return pointer to descriptor, whose contents must exist long enough for transfer to complete
@@ -52,7 +53,9 @@ uint8_t const *tud_descriptor_device_cb(void)
 // Descriptor contents must exist long enough for transfer to complete
 uint8_t const *tud_hid_descriptor_report_cb(uint8_t itf)
 {
-	(void) itf;
+	if (config_interface_enabled() && itf == config_hid_instance())
+		return config_report_descriptor();
+
 	switch (get_input_mode())
 	{
 		case INPUT_MODE_SWITCH:
@@ -74,12 +77,12 @@ uint8_t const *tud_descriptor_configuration_cb(uint8_t index)
 			return net_configuration_arr[index];
 
 		case INPUT_MODE_XINPUT:
-			return xinput_configuration_descriptor;
+			return config_interface_enabled() ? add_config_interface(xinput_configuration_descriptor) : xinput_configuration_descriptor;
 
 		case INPUT_MODE_SWITCH:
 			return switch_configuration_descriptor;
 
 		default:
-			return hid_configuration_descriptor;
+			return config_interface_enabled() ? add_config_interface(hid_configuration_descriptor) : hid_configuration_descriptor;
 	}
 }
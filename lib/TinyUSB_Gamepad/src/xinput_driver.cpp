@@ -50,6 +50,8 @@ static void xinput_reset(uint8_t rhport)
 
 static uint16_t xinput_open(uint8_t rhport, tusb_desc_interface_t const *itf_descriptor, uint16_t max_length)
 {
+	TU_VERIFY(itf_descriptor->bInterfaceClass == TUSB_CLASS_VENDOR_SPECIFIC, 0);
+
 	uint16_t driver_length = sizeof(tusb_desc_interface_t) + (itf_descriptor->bNumEndpoints * sizeof(tusb_desc_endpoint_t)) + 16;
 
 	TU_VERIFY(max_length >= driver_length, 0);
@@ -2146,6 +2146,13 @@ http_find_file(struct http_state *hs, const char *uri, int is_09)
 static err_t
 http_init_file(struct http_state *hs, struct fs_file *file, int is_09, const char *uri, u8_t tag_check)
 {
+#if LWIP_HTTPD_SUPPORT_11_KEEPALIVE
+  /* Only a response with its own Content-Length can be followed by another request on the same
+     connection, anything else (generated headers, 404) is terminated by closing the connection */
+  if ((file == NULL) || !(file->http_header_included & FS_FILE_FLAGS_HEADER_PERSISTENT)) {
+    hs->keepalive = 0;
+  }
+#endif /* LWIP_HTTPD_SUPPORT_11_KEEPALIVE */
   if (file != NULL) {
     /* file opened, initialise struct http_state */
 #if LWIP_HTTPD_SSI
@@ -47,9 +47,17 @@
 #define LWIP_IP_ACCEPT_UDP_PORT(p)      ((p) == PP_NTOHS(67))
 
 #define TCP_MSS                         (1500 /*mtu*/ - 20 /*iphdr*/ - 20 /*tcphhr*/)
-#define TCP_SND_BUF                     (2 * TCP_MSS)
+#define TCP_WND                         (4 * TCP_MSS) // One segment per RNDIS receive slot
+#define TCP_SND_BUF                     (8 * TCP_MSS) // Static files are referenced from flash, this only costs headers
+#define TCP_SND_QUEUELEN                (2 * TCP_SND_BUF / TCP_MSS)
+#define MEMP_NUM_TCP_SEG                TCP_SND_QUEUELEN
+#define MEMP_NUM_TCP_PCB                8  // Browsers open up to 6 connections per host
+#define MEMP_NUM_PBUF                   32 // ROM pbufs for file data in flight
+#define MEM_SIZE                        (16 * 1024)
+#define PBUF_POOL_BUFSIZE               1514 // CFG_TUD_NET_MTU, a full Ethernet frame
 
 #define ETHARP_SUPPORT_STATIC_ENTRIES   1
+#define LWIP_SUPPORT_CUSTOM_PBUF        1 // RNDIS receive slots
 
 #define LWIP_HTTPD_CGI                  0
 #define LWIP_HTTPD_SSI                  0
@@ -58,9 +66,17 @@
 #define LWIP_HTTPD_CUSTOM_FILES         1
 #define LWIP_HTTPD_SUPPORT_POST         1
 #define LWIP_HTTPD_SUPPORT_V09          0
-#define LWIP_HTTPD_SUPPORT_11_KEEPALIVE 0 // Causes lockups with CGI requests
+#define LWIP_HTTPD_SUPPORT_11_KEEPALIVE 1
 #define LWIP_HTTPD_ABORT_ON_CLOSE_MEM_ERROR 1
 
+// API responses live in a reused RAM buffer and must be copied, file data in flash can be sent by reference
+#define HTTP_IS_DATA_VOLATILE(hs)       (((const char *)(hs)->file < (const char *)0x20000000) ? 0 : TCP_WRITE_FLAG_COPY)
+
 #define LWIP_SINGLE_NETIF               1
 
+// High-water marks reported by /api/getStats
+#define LWIP_STATS                      1
+#define MEM_STATS                       1
+#define MEMP_STATS                      1
+
 #endif /* __LWIPOPTS_H__ */
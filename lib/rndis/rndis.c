@@ -50,12 +50,39 @@ try changing the first byte of tud_network_mac_address[] below from 0x02 to 0x00
 #include "lwip/init.h"
 #include "lwip/timeouts.h"
 #include <httpd.h>
+#include "rndis.h"
 
 /* lwip context */
 static struct netif netif_data;
 
-/* shared between tud_network_recv_cb() and service_traffic() */
-static struct pbuf *received_frame;
+/* Frames waiting for lwip, filled by tud_network_recv_cb() and drained by service_traffic(). tud_task() can
+run inside linkoutput_fn() while lwip is busy, so more frames can arrive before the last one was handled. */
+#ifndef RNDIS_RX_QUEUE_DEPTH
+#define RNDIS_RX_QUEUE_DEPTH 4
+#endif
+
+/* Frames lwip handed over while the USB endpoint was still busy */
+#ifndef RNDIS_TX_QUEUE_DEPTH
+#define RNDIS_TX_QUEUE_DEPTH 4
+#endif
+
+/* Each slot is a custom pbuf over a static frame buffer. The slot returns to the free mask when lwip frees
+the pbuf, which may be later than ethernet_input() when TCP keeps out of order segments. */
+struct rx_slot
+{
+  struct pbuf_custom pc;
+  uint8_t frame[CFG_TUD_NET_MTU];
+};
+
+static struct rx_slot rx_slots[RNDIS_RX_QUEUE_DEPTH];
+static uint32_t rx_free_mask = (1u << RNDIS_RX_QUEUE_DEPTH) - 1;
+static struct pbuf *rx_queue[RNDIS_RX_QUEUE_DEPTH];
+static uint8_t rx_head, rx_count;
+
+static struct pbuf *tx_queue[RNDIS_TX_QUEUE_DEPTH];
+static uint8_t tx_head, tx_count;
+
+static struct rndis_stats stats;
 
 /* this is used by this code, ./class/net/net_driver.c, and usb_descriptors.c */
 /* ideally speaking, this should be generated from the hardware's unique ID (if available) */
@@ -86,26 +113,56 @@ static const dhcp_config_t dhcp_config =
         entries                                    /* entries */
 };
 
+/* sends queued frames in order for as long as the USB endpoint is free */
+static void flush_tx_queue(void)
+{
+  while (tx_count && tud_network_can_xmit())
+  {
+    struct pbuf *p = tx_queue[tx_head];
+    tx_head = (tx_head + 1) % RNDIS_TX_QUEUE_DEPTH;
+    tx_count--;
+
+    tud_network_xmit(p, 0 /* unused for this example */);
+    pbuf_free(p);
+  }
+}
+
 static err_t linkoutput_fn(struct netif *netif, struct pbuf *p)
 {
   (void)netif;
 
-  for (;;)
+  /* if TinyUSB isn't ready, we must signal back to lwip that there is nothing we can do */
+  if (!tud_ready())
+    return ERR_USE;
+
+  flush_tx_queue();
+
+  /* the chain is copied straight into the USB buffer by tud_network_xmit_cb() */
+  if (!tx_count && tud_network_can_xmit())
   {
-    /* if TinyUSB isn't ready, we must signal back to lwip that there is nothing we can do */
+    tud_network_xmit(p, 0 /* unused for this example */);
+    stats.tx_frames++;
+    return ERR_OK;
+  }
+
+  /* the queue is full, transfer execution to TinyUSB in the hopes that it will finish the prior packet */
+  while (tx_count == RNDIS_TX_QUEUE_DEPTH)
+  {
+    tud_task();
+    flush_tx_queue();
     if (!tud_ready())
       return ERR_USE;
+  }
 
-    /* if the network driver can accept another packet, we make it happen */
-    if (tud_network_can_xmit())
-    {
-      tud_network_xmit(p, 0 /* unused for this example */);
-      return ERR_OK;
-    }
+  /* keep a reference instead of a copy, lwip will not reuse the pbuf until it is freed */
+  pbuf_ref(p);
+  tx_queue[(tx_head + tx_count) % RNDIS_TX_QUEUE_DEPTH] = p;
+  tx_count++;
+  stats.tx_frames++;
+  if (tx_count > stats.tx_queue_peak)
+    stats.tx_queue_peak = tx_count;
 
-    /* transfer execution to TinyUSB in the hopes that it will finish transmitting the prior packet */
-    tud_task();
-  }
+  return ERR_OK;
 }
 
 static err_t output_fn(struct netif *netif, struct pbuf *p, const ip_addr_t *addr)
@@ -152,27 +209,38 @@ bool dns_query_proc(const char *name, ip_addr_t *addr)
   return false;
 }
 
+static void rx_slot_free(struct pbuf *p)
+{
+  struct rx_slot *slot = (struct rx_slot *)p;
+  rx_free_mask |= 1u << (slot - rx_slots);
+}
+
 bool tud_network_recv_cb(const uint8_t *src, uint16_t size)
 {
-  /* this shouldn't happen, but if we get another packet before
-  parsing the previous, we must signal our inability to accept it */
-  if (received_frame)
+  if (size == 0 || size > CFG_TUD_NET_MTU)
     return false;
 
-  if (size)
+  /* every slot is still queued or held by lwip, TinyUSB renews the endpoint and the frame is dropped */
+  if (!rx_free_mask)
   {
-    struct pbuf *p = pbuf_alloc(PBUF_RAW, size, PBUF_POOL);
+    stats.rx_dropped++;
+    return false;
+  }
 
-    if (p)
-    {
-      /* pbuf_alloc() has already initialized struct; all we need to do is copy the data */
-      memcpy(p->payload, src, size);
+  uint32_t index = __builtin_ctz(rx_free_mask);
+  struct rx_slot *slot = &rx_slots[index];
+  rx_free_mask &= ~(1u << index);
 
-      /* store away the pointer for service_traffic() to later handle */
-      received_frame = p;
-    }
-  }
+  /* the one unavoidable copy, out of the TinyUSB endpoint buffer so it can be re-armed right away */
+  memcpy(slot->frame, src, size);
+  slot->pc.custom_free_function = rx_slot_free;
+  rx_queue[(rx_head + rx_count) % RNDIS_RX_QUEUE_DEPTH] = pbuf_alloced_custom(PBUF_RAW, size, PBUF_REF, &slot->pc, slot->frame, sizeof(slot->frame));
+  rx_count++;
+  stats.rx_frames++;
+  if (rx_count > stats.rx_queue_peak)
+    stats.rx_queue_peak = rx_count;
 
+  tud_network_recv_renew();
   return true;
 }
 
@@ -199,26 +267,44 @@ uint16_t tud_network_xmit_cb(uint8_t *dst, void *ref, uint16_t arg)
 
 static void service_traffic(void)
 {
-  /* handle any packet received by tud_network_recv_cb() */
-  if (received_frame)
+  /* handle the packets received by tud_network_recv_cb(), more may be queued while lwip runs */
+  while (rx_count)
   {
-    ethernet_input(received_frame, &netif_data);
-    pbuf_free(received_frame);
-    received_frame = NULL;
-    tud_network_recv_renew();
+    struct pbuf *p = rx_queue[rx_head];
+    rx_head = (rx_head + 1) % RNDIS_RX_QUEUE_DEPTH;
+    rx_count--;
+
+    if (ethernet_input(p, &netif_data) != ERR_OK)
+      pbuf_free(p);
   }
 
+  if (tud_ready())
+    flush_tx_queue();
+
   sys_check_timeouts();
 }
 
 void tud_network_init_cb(void)
 {
-  /* if the network is re-initializing and we have a leftover packet, we must do a cleanup */
-  if (received_frame)
+  /* if the network is re-initializing and we have leftover packets, we must do a cleanup */
+  while (rx_count)
   {
-    pbuf_free(received_frame);
-    received_frame = NULL;
+    pbuf_free(rx_queue[rx_head]);
+    rx_head = (rx_head + 1) % RNDIS_RX_QUEUE_DEPTH;
+    rx_count--;
   }
+
+  while (tx_count)
+  {
+    pbuf_free(tx_queue[tx_head]);
+    tx_head = (tx_head + 1) % RNDIS_TX_QUEUE_DEPTH;
+    tx_count--;
+  }
+}
+
+const struct rndis_stats *rndis_get_stats(void)
+{
+  return &stats;
 }
 
 int rndis_init(void)
@@ -1,12 +1,24 @@
 #ifndef RNDIS_H_
 #define RNDIS_H_
 
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+struct rndis_stats
+{
+  uint32_t rx_frames;
+  uint32_t rx_dropped;    // Frames that arrived with every receive slot in use
+  uint32_t tx_frames;
+  uint8_t rx_queue_peak;
+  uint8_t tx_queue_peak;
+};
+
 int rndis_init(void);
 void rndis_task(void);
+const struct rndis_stats *rndis_get_stats(void);
 
 #ifdef __cplusplus
 }
@@ -226,8 +226,11 @@ uint8_t Adafruit_MPR121::readRegister8(uint8_t reg) {
 uint16_t Adafruit_MPR121::readRegister16(uint8_t reg) {
   uint8_t buffer[2];
   uint8_t width = sizeof(buffer) / sizeof(buffer[0]);
-  i2c_write_blocking_until(i2c_dev, _i2caddr, &reg, 1, true, make_timeout_time_ms(_timeout));
-  i2c_read_blocking_until(i2c_dev, _i2caddr, buffer, width, false, make_timeout_time_ms(_timeout));
+  if (i2c_write_blocking_until(i2c_dev, _i2caddr, &reg, 1, true, make_timeout_time_ms(_timeout)) < 0 ||
+      i2c_read_blocking_until(i2c_dev, _i2caddr, buffer, width, false, make_timeout_time_ms(_timeout)) < 0) {
+    errorCount++;
+    return 0;
+  }
 
   //LSBFIRSTなので、変換
   uint16_t value = 0;
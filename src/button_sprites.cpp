@@ -0,0 +1,59 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#include "button_sprites.h"
+#include "OneBitDisplay.h"
+
+/* Rasterises the filled and outlined button circles once for every vertical phase, using the same
+obdPreciseEllipse() calls as before so the result is pixel identical. */
+void rasteriseButtonSprites(ButtonSprites &sprites, int radius)
+{
+	OBDISP sprite = {};
+
+	if (radius > BUTTON_SPRITE_MAX_RADIUS)
+		radius = BUTTON_SPRITE_MAX_RADIUS;
+
+	sprites.radius = radius;
+	sprites.width = (radius * 2) + 1;
+
+	for (int phase = 0; phase < 8; phase++)
+	{
+		obdCreateVirtualDisplay(&sprite, sprites.width, BUTTON_SPRITE_PAGES * 8, sprites.fill[phase]);
+		obdFill(&sprite, 0, 0);
+		obdPreciseEllipse(&sprite, radius, radius + phase, radius, radius, 1, 1);
+
+		obdCreateVirtualDisplay(&sprite, sprites.width, BUTTON_SPRITE_PAGES * 8, sprites.outline[phase]);
+		obdFill(&sprite, 0, 0);
+		obdPreciseEllipse(&sprite, radius, radius + phase, radius, radius, 1, 0);
+	}
+}
+
+/* Blits the button centred on x, y into a page-major buffer. The filled circle is used as the mask,
+so a released button also erases its old fill. */
+void blitButtonSprite(const ButtonSprites &sprites, uint8_t *buffer, int width, int height, int x, int y, bool pressed)
+{
+	const int top = y - sprites.radius;
+	const int left = x - sprites.radius;
+	const int phase = top & 7;
+	const int screenPages = height >> 3;
+	const uint8_t *fill = sprites.fill[phase];
+	const uint8_t *bits = pressed ? fill : sprites.outline[phase];
+
+	for (int page = 0; page < BUTTON_SPRITE_PAGES; page++)
+	{
+		const int screenPage = (top >> 3) + page;
+		if (screenPage < 0 || screenPage >= screenPages)
+			continue;
+
+		uint8_t *dest = &buffer[screenPage * width];
+		const int offset = page * sprites.width;
+		for (int col = 0; col < sprites.width; col++)
+		{
+			const int destX = left + col;
+			if (destX >= 0 && destX < width)
+				dest[destX] = (dest[destX] & ~fill[offset + col]) | bits[offset + col];
+		}
+	}
+}
@@ -0,0 +1,120 @@
+/*
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <string.h>
+#include "config_protocol.h"
+#include "usb_driver.h"
+#include "FlashPROM.h"
+
+ConfigProtocol configProtocol;
+
+static_assert(3 + sizeof(ConfigTelemetry) <= CONFIG_REPORT_SIZE, "Telemetry does not fit in a config report");
+
+static void getOptions(Gamepad &gamepad, ConfigOptions &options)
+{
+	options.dpadMode = gamepad.options.dpadMode;
+	options.socdMode = gamepad.options.socdMode;
+	options.inputMode = gamepad.options.inputMode;
+	options.activeProfile = gamepad.activeProfile;
+	options.sliderRange = gamepad.sliderRange;
+}
+
+static bool setOptions(Gamepad &gamepad, const ConfigOptions &options)
+{
+	if (options.dpadMode > DPAD_MODE_RIGHT_ANALOG || options.socdMode > SOCD_MODE_SECOND_INPUT_PRIORITY)
+		return false;
+	if (options.inputMode != INPUT_MODE_XINPUT && options.inputMode != INPUT_MODE_SWITCH && options.inputMode != INPUT_MODE_HID)
+		return false;
+	if (options.activeProfile >= PROFILE_COUNT || options.sliderRange < 1 || options.sliderRange > SLIDER_RANGE_MAX)
+		return false;
+
+	// Switch first, a profile brings its own modes and slider range which are then overridden below
+	gamepad.setProfile(options.activeProfile);
+
+	gamepad.options.dpadMode = (DpadMode)options.dpadMode;
+	gamepad.options.socdMode = (SOCDMode)options.socdMode;
+	gamepad.options.inputMode = (InputMode)options.inputMode;
+	gamepad.setSliderRange(options.sliderRange); // Saves the options along with the profile
+
+	return true;
+}
+
+// Returns the status and writes the response payload to result
+uint8_t ConfigProtocol::handleRequest(Gamepad &gamepad, const uint8_t *payload, uint8_t *result)
+{
+	switch (response[0])
+	{
+		case CONFIG_COMMAND_GET_INFO:
+		{
+			ConfigInfo info;
+			info.protocolVersion = CONFIG_PROTOCOL_VERSION;
+			info.inputMode = gamepad.options.inputMode;
+			info.profileCount = PROFILE_COUNT;
+			info.activeProfile = gamepad.activeProfile;
+			memcpy(result, &info, sizeof(info));
+			return CONFIG_STATUS_OK;
+		}
+
+		case CONFIG_COMMAND_GET_OPTIONS:
+		{
+			ConfigOptions options;
+			getOptions(gamepad, options);
+			memcpy(result, &options, sizeof(options));
+			return CONFIG_STATUS_OK;
+		}
+
+		case CONFIG_COMMAND_SET_OPTIONS:
+		{
+			ConfigOptions options;
+			memcpy(&options, payload, sizeof(options));
+			uint8_t status = setOptions(gamepad, options) ? CONFIG_STATUS_OK : CONFIG_STATUS_INVALID_VALUE;
+			getOptions(gamepad, options);
+			memcpy(result, &options, sizeof(options));
+			return status;
+		}
+
+		case CONFIG_COMMAND_GET_TELEMETRY:
+		{
+			ConfigTelemetry telemetry;
+			telemetry.buttons = gamepad.state.buttons;
+			telemetry.dpad = gamepad.state.dpad;
+			telemetry.aux = gamepad.state.aux;
+			telemetry.touched = gamepad.currtouched;
+			telemetry.touchL = gamepad.currTouchedPositionL;
+			telemetry.touchR = gamepad.currTouchedPositionR;
+			telemetry.lx = gamepad.state.lx;
+			telemetry.ly = gamepad.state.ly;
+			telemetry.rx = gamepad.state.rx;
+			telemetry.ry = gamepad.state.ry;
+			telemetry.touchScanUS = gamepad.touchScanUS;
+			telemetry.touchErrors = gamepad.touchErrors;
+			telemetry.flashMaxStallUS = FlashPROM::maxStallUS;
+			memcpy(result, &telemetry, sizeof(telemetry));
+			return CONFIG_STATUS_OK;
+		}
+
+		default:
+			return CONFIG_STATUS_UNKNOWN_COMMAND;
+	}
+}
+
+void ConfigProtocol::process(Gamepad &gamepad)
+{
+	// A response that found the IN endpoint busy is retried before the next request is taken
+	if (responsePending)
+	{
+		responsePending = !send_config_report(response);
+		return;
+	}
+
+	uint8_t request[CONFIG_REPORT_SIZE];
+	if (!receive_config_report(request))
+		return;
+
+	memset(response, 0, sizeof(response));
+	response[0] = request[0];
+	response[1] = request[1];
+	response[2] = handleRequest(gamepad, &request[2], &response[3]);
+	responsePending = !send_config_report(response);
+}
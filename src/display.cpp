@@ -3,119 +3,413 @@
  * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
  */
 
-#include <string>
+#include <stdio.h>
+#include <string.h>
 #include "display.h"
 #include "storage.h"
 #include "pico/stdlib.h"
 #include "OneBitDisplay.h"
+#include "button_sprites.h"
+#include "i2c_bus.h"
 
-uint8_t ucBackBuffer[1024];
+// Bit positions of each button in DisplayState::buttons, in drawing order
+typedef enum
+{
+	DISPLAY_BUTTON_LEFT,
+	DISPLAY_BUTTON_DOWN,
+	DISPLAY_BUTTON_RIGHT,
+	DISPLAY_BUTTON_UP,
+	DISPLAY_BUTTON_B3,
+	DISPLAY_BUTTON_B4,
+	DISPLAY_BUTTON_R1,
+	DISPLAY_BUTTON_L1,
+	DISPLAY_BUTTON_B1,
+	DISPLAY_BUTTON_B2,
+	DISPLAY_BUTTON_R2,
+	DISPLAY_BUTTON_L2,
+} DisplayButton;
+
+typedef enum
+{
+	DISPLAY_MODE_BUTTONS,
+	DISPLAY_MODE_SLIDER, // Touch slider diagnostics, toggled with F1 + L3
+} DisplayMode;
+
+// Everything that is shown on screen, used to decide which widgets need to be redrawn
+struct DisplayState
+{
+	uint16_t buttons;
+	InputMode inputMode;
+	DpadMode dpadMode;
+	SOCDMode socdMode;
+	uint8_t profile;
+};
+
+// Everything shown on the slider diagnostics screen
+struct SliderState
+{
+	uint32_t touched;
+	int8_t positionL;
+	int8_t positionR;
+	uint16_t lx;
+	uint32_t scanUS;
+	uint32_t errors;
+	uint32_t waitUS;
+};
+
+// Slider diagnostics layout, in 8 pixel pages
+#define SLIDER_BAR_PAGE          2
+#define SLIDER_MARKER_PAGE       3
+#define SLIDER_STICK_PAGE        5
+#define SLIDER_WAIT_PAGE         6
+#define SLIDER_STATS_PAGE        7
+#define SLIDER_STATS_INTERVAL_MS 250 // The numbers change on every scan, so limit how often they are redrawn
+
+struct ButtonPosition
+{
+	int16_t x;
+	int16_t y;
+};
+
+uint8_t ucBackBuffer[1024];  // Frame being drawn
+uint8_t ucFrontBuffer[1024]; // Last frame sent to the display
 OBDISP obd;
-string statusBar;
+static ButtonPosition buttonPositions[DISPLAY_BUTTON_L2 + 1]; // Static, leds.cpp has its own buttonPositions
+ButtonSprites buttonSprites;
+DisplayMode displayMode = DISPLAY_MODE_BUTTONS;
+DisplayState displayState;
+SliderState sliderState;
+uint32_t nextSliderStatsMS = 0;
+uint16_t changedButtons = 0;
+bool redrawAll = true;
 
 inline void clearScreen(int render = 0)
 {
 	obdFill(&obd, 0, render);
 }
 
-inline void drawHitbox(int startX, int startY, int buttonRadius, int buttonPadding, Gamepad *gamepad)
+inline void setButtonPosition(DisplayButton button, int x, int y)
+{
+	buttonPositions[button].x = x;
+	buttonPositions[button].y = y;
+}
+
+// Blits a single button into the back buffer, but only when its state changed since the last frame
+inline void drawButton(DisplayButton button)
+{
+	const uint16_t mask = (1 << button);
+	if (!(changedButtons & mask))
+		return;
+
+	blitButtonSprite(buttonSprites, ucBackBuffer, obd.width, obd.height,
+		buttonPositions[button].x, buttonPositions[button].y, displayState.buttons & mask);
+}
+
+inline void drawButtons()
+{
+	for (int button = DISPLAY_BUTTON_LEFT; button <= DISPLAY_BUTTON_L2; button++)
+		drawButton((DisplayButton)button);
+}
+
+void setHitboxLayout(int startX, int startY, int buttonRadius, int buttonPadding)
 {
 	const int buttonMargin = buttonPadding + (buttonRadius * 2);
 
+	rasteriseButtonSprites(buttonSprites, buttonRadius);
+
 	// UDLR
-	obdPreciseEllipse(&obd, startX, startY, buttonRadius, buttonRadius, 1, gamepad->pressedLeft());
-	obdPreciseEllipse(&obd, startX + buttonMargin, startY, buttonRadius, buttonRadius, 1, gamepad->pressedDown());
-	obdPreciseEllipse(&obd, startX + (buttonMargin * 1.875), startY + (buttonMargin / 2), buttonRadius, buttonRadius, 1, gamepad->pressedRight());
-	obdPreciseEllipse(&obd, startX + (buttonMargin * 2.25), startY + buttonMargin * 1.875, buttonRadius, buttonRadius, 1, gamepad->pressedUp());
+	setButtonPosition(DISPLAY_BUTTON_LEFT, startX, startY);
+	setButtonPosition(DISPLAY_BUTTON_DOWN, startX + buttonMargin, startY);
+	setButtonPosition(DISPLAY_BUTTON_RIGHT, startX + (buttonMargin * 1.875), startY + (buttonMargin / 2));
+	setButtonPosition(DISPLAY_BUTTON_UP, startX + (buttonMargin * 2.25), startY + buttonMargin * 1.875);
 
 	// 8-button
-	obdPreciseEllipse(&obd, startX + (buttonMargin * 2.75), startY, buttonRadius, buttonRadius, 1, gamepad->pressedB3());
-	obdPreciseEllipse(&obd, startX + (buttonMargin * 3.75), startY - (buttonMargin / 4), buttonRadius, buttonRadius, 1, gamepad->pressedB4());
-	obdPreciseEllipse(&obd, startX + (buttonMargin * 4.75), startY - (buttonMargin / 4), buttonRadius, buttonRadius, 1, gamepad->pressedR1());
-	obdPreciseEllipse(&obd, startX + (buttonMargin * 5.75), startY, buttonRadius, buttonRadius, 1, gamepad->pressedL1());
+	setButtonPosition(DISPLAY_BUTTON_B3, startX + (buttonMargin * 2.75), startY);
+	setButtonPosition(DISPLAY_BUTTON_B4, startX + (buttonMargin * 3.75), startY - (buttonMargin / 4));
+	setButtonPosition(DISPLAY_BUTTON_R1, startX + (buttonMargin * 4.75), startY - (buttonMargin / 4));
+	setButtonPosition(DISPLAY_BUTTON_L1, startX + (buttonMargin * 5.75), startY);
 
-	obdPreciseEllipse(&obd, startX + (buttonMargin * 2.75), startY + buttonMargin, buttonRadius, buttonRadius, 1, gamepad->pressedB1());
-	obdPreciseEllipse(&obd, startX + (buttonMargin * 3.75), startY + buttonMargin - (buttonMargin / 4), buttonRadius, buttonRadius, 1, gamepad->pressedB2());
-	obdPreciseEllipse(&obd, startX + (buttonMargin * 4.75), startY + buttonMargin - (buttonMargin / 4), buttonRadius, buttonRadius, 1, gamepad->pressedR2());
-	obdPreciseEllipse(&obd, startX + (buttonMargin * 5.75), startY + buttonMargin, buttonRadius, buttonRadius, 1, gamepad->pressedL2());
+	setButtonPosition(DISPLAY_BUTTON_B1, startX + (buttonMargin * 2.75), startY + buttonMargin);
+	setButtonPosition(DISPLAY_BUTTON_B2, startX + (buttonMargin * 3.75), startY + buttonMargin - (buttonMargin / 4));
+	setButtonPosition(DISPLAY_BUTTON_R2, startX + (buttonMargin * 4.75), startY + buttonMargin - (buttonMargin / 4));
+	setButtonPosition(DISPLAY_BUTTON_L2, startX + (buttonMargin * 5.75), startY + buttonMargin);
 }
 
-inline void drawWasdBox(int startX, int startY, int buttonRadius, int buttonPadding, Gamepad *gamepad)
+void setWasdLayout(int startX, int startY, int buttonRadius, int buttonPadding)
 {
 	const int buttonMargin = buttonPadding + (buttonRadius * 2);
 
+	rasteriseButtonSprites(buttonSprites, buttonRadius);
+
 	// UDLR
-	obdPreciseEllipse(&obd, startX, startY + buttonMargin * 0.5, buttonRadius, buttonRadius, 1, gamepad->pressedLeft());
-	obdPreciseEllipse(&obd, startX + buttonMargin, startY + buttonMargin * 0.875, buttonRadius, buttonRadius, 1, gamepad->pressedDown());
-	obdPreciseEllipse(&obd, startX + buttonMargin * 1.5, startY - buttonMargin * 0.125, buttonRadius, buttonRadius, 1, gamepad->pressedUp());
-	obdPreciseEllipse(&obd, startX + (buttonMargin * 2), startY + buttonMargin * 1.25, buttonRadius, buttonRadius, 1, gamepad->pressedRight());
+	setButtonPosition(DISPLAY_BUTTON_LEFT, startX, startY + buttonMargin * 0.5);
+	setButtonPosition(DISPLAY_BUTTON_DOWN, startX + buttonMargin, startY + buttonMargin * 0.875);
+	setButtonPosition(DISPLAY_BUTTON_UP, startX + buttonMargin * 1.5, startY - buttonMargin * 0.125);
+	setButtonPosition(DISPLAY_BUTTON_RIGHT, startX + (buttonMargin * 2), startY + buttonMargin * 1.25);
 
 	// 8-button
-	obdPreciseEllipse(&obd, startX + buttonMargin * 3.625, startY, buttonRadius, buttonRadius, 1, gamepad->pressedB3());
-	obdPreciseEllipse(&obd, startX + buttonMargin * 4.625, startY - (buttonMargin / 4), buttonRadius, buttonRadius, 1, gamepad->pressedB4());
-	obdPreciseEllipse(&obd, startX + buttonMargin * 5.625, startY - (buttonMargin / 4), buttonRadius, buttonRadius, 1, gamepad->pressedR1());
-	obdPreciseEllipse(&obd, startX + buttonMargin * 6.625, startY, buttonRadius, buttonRadius, 1, gamepad->pressedL1());
+	setButtonPosition(DISPLAY_BUTTON_B3, startX + buttonMargin * 3.625, startY);
+	setButtonPosition(DISPLAY_BUTTON_B4, startX + buttonMargin * 4.625, startY - (buttonMargin / 4));
+	setButtonPosition(DISPLAY_BUTTON_R1, startX + buttonMargin * 5.625, startY - (buttonMargin / 4));
+	setButtonPosition(DISPLAY_BUTTON_L1, startX + buttonMargin * 6.625, startY);
 
-	obdPreciseEllipse(&obd, startX + buttonMargin * 3.25, startY + buttonMargin, buttonRadius, buttonRadius, 1, gamepad->pressedB1());
-	obdPreciseEllipse(&obd, startX + buttonMargin * 4.25, startY + buttonMargin - (buttonMargin / 4), buttonRadius, buttonRadius, 1, gamepad->pressedB2());
-	obdPreciseEllipse(&obd, startX + buttonMargin * 5.25, startY + buttonMargin - (buttonMargin / 4), buttonRadius, buttonRadius, 1, gamepad->pressedR2());
-	obdPreciseEllipse(&obd, startX + buttonMargin * 6.25, startY + buttonMargin, buttonRadius, buttonRadius, 1, gamepad->pressedL2());
+	setButtonPosition(DISPLAY_BUTTON_B1, startX + buttonMargin * 3.25, startY + buttonMargin);
+	setButtonPosition(DISPLAY_BUTTON_B2, startX + buttonMargin * 4.25, startY + buttonMargin - (buttonMargin / 4));
+	setButtonPosition(DISPLAY_BUTTON_R2, startX + buttonMargin * 5.25, startY + buttonMargin - (buttonMargin / 4));
+	setButtonPosition(DISPLAY_BUTTON_L2, startX + buttonMargin * 6.25, startY + buttonMargin);
 }
 
-inline void drawArcadeStick(int startX, int startY, int buttonRadius, int buttonPadding, Gamepad *gamepad)
+void setArcadeStickLayout(int startX, int startY, int buttonRadius, int buttonPadding)
 {
 	const int buttonMargin = buttonPadding + (buttonRadius * 2);
 
+	rasteriseButtonSprites(buttonSprites, buttonRadius);
+
 	// UDLR
-	obdPreciseEllipse(&obd, startX, startY + buttonMargin / 2, buttonRadius, buttonRadius, 1, gamepad->pressedLeft());
-	obdPreciseEllipse(&obd, startX + (buttonMargin * 0.875), startY - (buttonMargin / 4), buttonRadius, buttonRadius, 1, gamepad->pressedUp());
-	obdPreciseEllipse(&obd, startX + (buttonMargin * 0.875), startY + buttonMargin * 1.25, buttonRadius, buttonRadius, 1, gamepad->pressedDown());
-	obdPreciseEllipse(&obd, startX + (buttonMargin * 1.625), startY + buttonMargin / 2, buttonRadius, buttonRadius, 1, gamepad->pressedRight());
+	setButtonPosition(DISPLAY_BUTTON_LEFT, startX, startY + buttonMargin / 2);
+	setButtonPosition(DISPLAY_BUTTON_UP, startX + (buttonMargin * 0.875), startY - (buttonMargin / 4));
+	setButtonPosition(DISPLAY_BUTTON_DOWN, startX + (buttonMargin * 0.875), startY + buttonMargin * 1.25);
+	setButtonPosition(DISPLAY_BUTTON_RIGHT, startX + (buttonMargin * 1.625), startY + buttonMargin / 2);
 
 	// 8-button
-	obdPreciseEllipse(&obd, startX + buttonMargin * 3.125, startY, buttonRadius, buttonRadius, 1, gamepad->pressedB3());
-	obdPreciseEllipse(&obd, startX + buttonMargin * 4.125, startY - (buttonMargin / 4), buttonRadius, buttonRadius, 1, gamepad->pressedB4());
-	obdPreciseEllipse(&obd, startX + buttonMargin * 5.125, startY - (buttonMargin / 4), buttonRadius, buttonRadius, 1, gamepad->pressedR1());
-	obdPreciseEllipse(&obd, startX + buttonMargin * 6.125, startY, buttonRadius, buttonRadius, 1, gamepad->pressedL1());
+	setButtonPosition(DISPLAY_BUTTON_B3, startX + buttonMargin * 3.125, startY);
+	setButtonPosition(DISPLAY_BUTTON_B4, startX + buttonMargin * 4.125, startY - (buttonMargin / 4));
+	setButtonPosition(DISPLAY_BUTTON_R1, startX + buttonMargin * 5.125, startY - (buttonMargin / 4));
+	setButtonPosition(DISPLAY_BUTTON_L1, startX + buttonMargin * 6.125, startY);
 
-	obdPreciseEllipse(&obd, startX + buttonMargin * 2.875, startY + buttonMargin, buttonRadius, buttonRadius, 1, gamepad->pressedB1());
-	obdPreciseEllipse(&obd, startX + buttonMargin * 3.875, startY + buttonMargin - (buttonMargin / 4), buttonRadius, buttonRadius, 1, gamepad->pressedB2());
-	obdPreciseEllipse(&obd, startX + buttonMargin * 4.875, startY + buttonMargin - (buttonMargin / 4), buttonRadius, buttonRadius, 1, gamepad->pressedR2());
-	obdPreciseEllipse(&obd, startX + buttonMargin * 5.875, startY + buttonMargin, buttonRadius, buttonRadius, 1, gamepad->pressedL2());
+	setButtonPosition(DISPLAY_BUTTON_B1, startX + buttonMargin * 2.875, startY + buttonMargin);
+	setButtonPosition(DISPLAY_BUTTON_B2, startX + buttonMargin * 3.875, startY + buttonMargin - (buttonMargin / 4));
+	setButtonPosition(DISPLAY_BUTTON_R2, startX + buttonMargin * 4.875, startY + buttonMargin - (buttonMargin / 4));
+	setButtonPosition(DISPLAY_BUTTON_L2, startX + buttonMargin * 5.875, startY + buttonMargin);
 }
 
 inline void drawStatusBar()
 {
-	obdWriteString(&obd, 0, 0, 0, (char *)statusBar.c_str(), FONT_6x8, 0, 0);
+	// Limit to 21 chars with 6x8 font for now. Every field is fixed width, so the previous text is always fully overwritten.
+	char statusBar[22] = "";
+
+	switch (displayState.inputMode)
+	{
+		case INPUT_MODE_HID:    strcat(statusBar, "DINPUT"); break;
+		case INPUT_MODE_SWITCH: strcat(statusBar, "SWITCH"); break;
+		case INPUT_MODE_XINPUT: strcat(statusBar, "XINPUT"); break;
+		case INPUT_MODE_CONFIG: strcat(statusBar, "CONFIG"); break;
+	}
+
+	char profile[4] = " P1";
+	profile[2] = '1' + (displayState.profile % 9);
+	strcat(statusBar, profile);
+
+	switch (displayState.dpadMode)
+	{
+
+		case DPAD_MODE_DIGITAL:      strcat(statusBar, "      DPAD"); break;
+		case DPAD_MODE_LEFT_ANALOG:  strcat(statusBar, "      LEFT"); break;
+		case DPAD_MODE_RIGHT_ANALOG: strcat(statusBar, "     RIGHT"); break;
+	}
+
+	switch (displayState.socdMode)
+	{
+		case SOCD_MODE_NEUTRAL:               strcat(statusBar, "-N"); break;
+		case SOCD_MODE_UP_PRIORITY:           strcat(statusBar, "-U"); break;
+		case SOCD_MODE_SECOND_INPUT_PRIORITY: strcat(statusBar, "-L"); break;
+	}
+
+	obdWriteString(&obd, 0, 0, 0, statusBar, FONT_6x8, 0, 0);
+}
+
+inline uint16_t getButtonState(Gamepad *gamepad)
+{
+	return (gamepad->pressedLeft()  << DISPLAY_BUTTON_LEFT)
+	     | (gamepad->pressedDown()  << DISPLAY_BUTTON_DOWN)
+	     | (gamepad->pressedRight() << DISPLAY_BUTTON_RIGHT)
+	     | (gamepad->pressedUp()    << DISPLAY_BUTTON_UP)
+	     | (gamepad->pressedB3()    << DISPLAY_BUTTON_B3)
+	     | (gamepad->pressedB4()    << DISPLAY_BUTTON_B4)
+	     | (gamepad->pressedR1()    << DISPLAY_BUTTON_R1)
+	     | (gamepad->pressedL1()    << DISPLAY_BUTTON_L1)
+	     | (gamepad->pressedB1()    << DISPLAY_BUTTON_B1)
+	     | (gamepad->pressedB2()    << DISPLAY_BUTTON_B2)
+	     | (gamepad->pressedR2()    << DISPLAY_BUTTON_R2)
+	     | (gamepad->pressedL2()    << DISPLAY_BUTTON_L2);
+}
+
+/* Draws one box per electrode, filled while touched. A single MPR121 has 12 electrodes, three of them
+are read into a 32 bit mask, so the last 4 electrodes of the third chip are not shown. */
+inline void drawSliderBar(uint32_t touched, int segments)
+{
+	const int segmentWidth = obd.width / segments;
+	const int left = (obd.width - (segments * segmentWidth)) / 2;
+	uint8_t *row = &ucBackBuffer[SLIDER_BAR_PAGE * obd.width];
+
+	for (int segment = 0; segment < segments; segment++)
+	{
+		const bool on = touched & (1u << segment);
+		uint8_t *dest = &row[left + (segment * segmentWidth)];
+		for (int col = 0; col < segmentWidth - 1; col++)
+			dest[col] = (on || col == 0 || col == segmentWidth - 2) ? 0xFF : 0x81;
+
+		dest[segmentWidth - 1] = 0x00;
+	}
+}
+
+inline void drawSliderMarker(int8_t position, int segments)
+{
+	static const uint8_t marker[] = { 0x0C, 0x0E, 0x0F, 0x0E, 0x0C };
+
+	if (position == NOT_TOUCHED || position >= segments)
+		return;
+
+	const int segmentWidth = obd.width / segments;
+	const int left = (obd.width - (segments * segmentWidth)) / 2;
+	const int center = left + (position * segmentWidth) + ((segmentWidth - 1) / 2);
+	uint8_t *row = &ucBackBuffer[SLIDER_MARKER_PAGE * obd.width];
+
+	for (int i = 0; i < (int)sizeof(marker); i++)
+	{
+		const int x = center - 2 + i;
+		if (x >= 0 && x < obd.width)
+			row[x] |= marker[i];
+	}
+}
+
+// Horizontal gauge of the left stick X output, growing out from the center tick
+inline void drawSliderStick(uint16_t lx)
+{
+	const int center = obd.width / 2;
+	const int offset = ((int32_t)lx - GAMEPAD_JOYSTICK_MID) * (center - 1) / GAMEPAD_JOYSTICK_MID;
+	uint8_t *row = &ucBackBuffer[SLIDER_STICK_PAGE * obd.width];
+
+	memset(row, 0, obd.width);
+	for (int x = (offset < 0 ? offset : 0); x <= (offset > 0 ? offset : 0); x++)
+		row[center + x] = 0x3C;
+
+	row[center] = 0xFF;
 }
 
-void setStatusBar(Gamepad *gamepad)
+bool drawSliderDiagnostics(Gamepad *gamepad)
 {
-	// Limit to 21 chars with 6x8 font for now
-	statusBar.clear();
+	const int segments = gamepad->isTouch32Bit ? 32 : 12;
+	const uint32_t nowMS = to_ms_since_boot(get_absolute_time());
 
-	switch (gamepad->options.inputMode)
+	SliderState state;
+	state.touched = gamepad->currtouched;
+	state.positionL = gamepad->currTouchedPositionL;
+	state.positionR = gamepad->currTouchedPositionR;
+	state.lx = gamepad->state.lx;
+	state.scanUS = gamepad->touchScanUS;
+	state.errors = gamepad->touchErrors;
+	state.waitUS = i2cBus.maxTouchWaitUS;
+
+	const bool statsDue = redrawAll || (int32_t)(nowMS - nextSliderStatsMS) >= 0;
+	const bool touchChanged = redrawAll || state.touched != sliderState.touched;
+	const bool markerChanged = redrawAll || state.positionL != sliderState.positionL || state.positionR != sliderState.positionR;
+	const bool stickChanged = redrawAll || state.lx != sliderState.lx;
+	const bool statsChanged = statsDue && (redrawAll
+		|| state.scanUS != sliderState.scanUS
+		|| state.errors != sliderState.errors
+		|| state.waitUS != sliderState.waitUS);
+
+	if (!touchChanged && !markerChanged && !stickChanged && !statsChanged)
+		return false;
+
+	if (redrawAll)
+		obdWriteString(&obd, 0, 0, 0, (char *)"SLIDER DIAGNOSTICS", FONT_6x8, 0, 0);
+
+	if (touchChanged)
 	{
-		case INPUT_MODE_HID:    statusBar += "DINPUT"; break;
-		case INPUT_MODE_SWITCH: statusBar += "SWITCH"; break;
-		case INPUT_MODE_XINPUT: statusBar += "XINPUT"; break;
-		case INPUT_MODE_CONFIG: statusBar += "CONFIG"; break;
+		sliderState.touched = state.touched;
+		drawSliderBar(state.touched, segments);
 	}
 
-	switch (gamepad->options.dpadMode)
+	if (markerChanged)
 	{
+		sliderState.positionL = state.positionL;
+		sliderState.positionR = state.positionR;
+		memset(&ucBackBuffer[SLIDER_MARKER_PAGE * obd.width], 0, obd.width);
+		drawSliderMarker(state.positionL, segments);
+		drawSliderMarker(state.positionR, segments);
+	}
 
-		case DPAD_MODE_DIGITAL:      statusBar += "         DPAD"; break;
-		case DPAD_MODE_LEFT_ANALOG:  statusBar += "         LEFT"; break;
-		case DPAD_MODE_RIGHT_ANALOG: statusBar += "        RIGHT"; break;
+	if (stickChanged)
+	{
+		sliderState.lx = state.lx;
+		drawSliderStick(state.lx);
 	}
 
-	switch (gamepad->options.socdMode)
+	if (statsChanged)
 	{
-		case SOCD_MODE_NEUTRAL:               statusBar += "-N"; break;
-		case SOCD_MODE_UP_PRIORITY:           statusBar += "-U"; break;
-		case SOCD_MODE_SECOND_INPUT_PRIORITY: statusBar += "-L"; break;
+		char line[22];
+
+		sliderState.scanUS = state.scanUS;
+		sliderState.errors = state.errors;
+		sliderState.waitUS = state.waitUS;
+		nextSliderStatsMS = nowMS + SLIDER_STATS_INTERVAL_MS;
+
+		snprintf(line, sizeof(line), "WAIT%5luus  BUS%3u%%", state.waitUS, i2cBus.getOccupancy(I2C_CLIENT_TOUCH));
+		obdWriteString(&obd, 0, 0, SLIDER_WAIT_PAGE, line, FONT_6x8, 0, 0);
+		snprintf(line, sizeof(line), "SCAN%5luus ERR%6lu", state.scanUS, state.errors);
+		obdWriteString(&obd, 0, 0, SLIDER_STATS_PAGE, line, FONT_6x8, 0, 0);
 	}
+
+	redrawAll = false;
+	return true;
+}
+
+bool drawButtonLayout(Gamepad *gamepad)
+{
+	DisplayState state;
+	state.buttons = getButtonState(gamepad);
+	state.inputMode = gamepad->options.inputMode;
+	state.dpadMode = gamepad->options.dpadMode;
+	state.socdMode = gamepad->options.socdMode;
+	state.profile = gamepad->activeProfile;
+
+	bool statusChanged = redrawAll
+		|| state.inputMode != displayState.inputMode
+		|| state.dpadMode != displayState.dpadMode
+		|| state.socdMode != displayState.socdMode
+		|| state.profile != displayState.profile;
+
+	changedButtons = redrawAll ? 0xFFFF : (state.buttons ^ displayState.buttons);
+
+	if (!statusChanged && !changedButtons)
+		return false;
+
+	displayState = state;
+	redrawAll = false;
+
+	if (statusChanged)
+		drawStatusBar();
+
+	drawButtons();
+	return true;
+}
+
+/* Sends only the 16 byte blocks that differ from the last frame sent, the same ones obdDumpBuffer() would.
+The bus is taken per block rather than for the whole frame, so a touch scan waits for one block at most.
+obdWriteDataBlock() copies what it sends into the display's own buffer, so the front buffer is swapped in
+for the duration of the transfer. */
+inline void flushScreen()
+{
+	const int pages = obd.height >> 3;
+
+	obdSetBackBuffer(&obd, ucFrontBuffer);
+	for (int page = 0; page < pages; page++)
+	{
+		for (int x = 0; x + 16 <= obd.width; x += 16)
+		{
+			const int offset = (page * obd.width) + x;
+			if (memcmp(&ucBackBuffer[offset], &ucFrontBuffer[offset], 16) == 0)
+				continue;
+
+			i2cBus.acquire(I2C_CLIENT_DISPLAY);
+			obdSetPosition(&obd, x, page, 1);
+			obdWriteDataBlock(&obd, &ucBackBuffer[offset], 16, 1);
+			i2cBus.release(I2C_CLIENT_DISPLAY);
+		}
+	}
+	obdSetBackBuffer(&obd, ucBackBuffer);
 }
 
 void DisplayModule::setup()
@@ -137,37 +431,58 @@ void DisplayModule::setup()
 			options.i2cSpeed);
 
 		obdSetContrast(&obd, 0xFF);
-		obdSetBackBuffer(&obd, ucBackBuffer);
+		obdSetBackBuffer(&obd, ucFrontBuffer);
 		clearScreen(1);
+		obdSetBackBuffer(&obd, ucBackBuffer);
+		clearScreen();
+		redrawAll = true;
+
+		transport.init(&obd, ucFrontBuffer, options.i2cSpeed);
+
+		switch (BUTTON_LAYOUT)
+		{
+			case BUTTON_LAYOUT_ARCADE:
+				setArcadeStickLayout(8, 28, 8, 2);
+				break;
+
+			case BUTTON_LAYOUT_HITBOX:
+				setHitboxLayout(8, 20, 8, 2);
+				break;
+
+			case BUTTON_LAYOUT_WASD:
+				setWasdLayout(8, 28, 7, 3);
+				break;
+		}
 	}
 }
 
 void DisplayModule::loop()
 {
-	// All screen updates should be handled in process() as they need to display ASAP
+	// Frames are drawn in process() as soon as a snapshot arrives, this only moves them to the panel
+	transport.update();
 }
 
 void DisplayModule::process(Gamepad *gamepad)
 {
-	clearScreen();
-
-	setStatusBar(gamepad);
-
-	drawStatusBar();
-	switch (BUTTON_LAYOUT)
+	// The hotkey is handled on core0, the snapshot only says which screen to show
+	const DisplayMode mode = gamepad->showDiagnostics ? DISPLAY_MODE_SLIDER : DISPLAY_MODE_BUTTONS;
+	if (mode != displayMode)
 	{
-		case BUTTON_LAYOUT_ARCADE:
-			drawArcadeStick(8, 28, 8, 2, gamepad);
-			break;
+		displayMode = mode;
+		clearScreen();
+		redrawAll = true;
+	}
 
-		case BUTTON_LAYOUT_HITBOX:
-			drawHitbox(8, 20, 8, 2, gamepad);
-			break;
+	bool drawn = (displayMode == DISPLAY_MODE_SLIDER)
+		? drawSliderDiagnostics(gamepad)
+		: drawButtonLayout(gamepad);
 
-		case BUTTON_LAYOUT_WASD:
-			drawWasdBox(8, 28, 7, 3, gamepad);
-			break;
-	}
+	// Nothing on screen changed, skip the I2C transfer entirely
+	if (!drawn)
+		return;
 
-	obdDumpBuffer(&obd, NULL);
+	if (transport.isEnabled())
+		transport.queueFrame(ucBackBuffer);
+	else
+		flushScreen();
 }
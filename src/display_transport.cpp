@@ -0,0 +1,258 @@
+/*
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <string.h>
+#include "display_transport.h"
+#include "i2c_bus.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+
+static DisplayTransport *irqTransport = nullptr;
+
+static void displayTransportIRQ()
+{
+	irqTransport->handleIRQ();
+}
+
+bool DisplayTransport::init(OBDISP *obd, uint8_t *frontBuffer, uint32_t speed)
+{
+	// Only hardware I2C can be fed by DMA, everything else keeps using the blocking OneBitDisplay calls
+	if (obd->com_mode != COM_I2C || !obd->bbi2c.bWire || obd->bbi2c.picoI2C == nullptr)
+		return false;
+
+	if ((obd->height >> 3) > DISPLAY_TRANSPORT_MAX_PAGES || obd->width * (obd->height >> 3) > 1024)
+		return false;
+
+	dmaChannel = dma_claim_unused_channel(false);
+	if (dmaChannel < 0)
+		return false;
+
+	this->obd = obd;
+	this->i2c = obd->bbi2c.picoI2C;
+	this->frontBuffer = frontBuffer;
+	this->byteTimeUS = (9 * 1000000) / speed + 1; // 8 data bits and an ACK
+
+	dma_channel_config config = dma_channel_get_default_config(dmaChannel);
+	channel_config_set_transfer_data_size(&config, DMA_SIZE_16);
+	channel_config_set_read_increment(&config, true);
+	channel_config_set_write_increment(&config, false);
+	channel_config_set_dreq(&config, i2c_hw_index(i2c) == 0 ? DREQ_I2C0_TX : DREQ_I2C1_TX);
+	dma_channel_configure(dmaChannel, &config, &i2c_get_hw(i2c)->data_cmd, words, 0, false);
+
+	i2c_get_hw(i2c)->intr_mask = 0;
+	irqTransport = this;
+	invalidate();
+	return true;
+}
+
+/* Hands over a new frame. If the previous one is still waiting for the bus, it is replaced, since
+only the latest frame matters. */
+void DisplayTransport::queueFrame(uint8_t *backBuffer)
+{
+	if (pendingFrame != nullptr)
+		framesDropped++;
+
+	pendingFrame = backBuffer;
+}
+
+void DisplayTransport::update()
+{
+	if (!isEnabled())
+		return;
+
+	// Enabled from here rather than init(), so the interrupt is taken on core1 and not the touch core
+	if (!irqEnabled)
+	{
+		int irq = (i2c_hw_index(i2c) == 0) ? I2C0_IRQ : I2C1_IRQ;
+		irq_set_exclusive_handler(irq, displayTransportIRQ);
+		irq_set_enabled(irq, true);
+		irqEnabled = true;
+	}
+
+	if (sending)
+		return;
+
+	if (chunkStarted)
+	{
+		chunkStarted = false;
+		chunkFinished();
+	}
+
+	if (nextChunk >= chunkCount && pendingFrame != nullptr)
+	{
+		encodeFrame();
+		pendingFrame = nullptr;
+		if (chunkCount == 0)
+			framesSent++; // Nothing changed, so there is nothing to send
+	}
+
+	if (nextChunk < chunkCount)
+		startChunk();
+}
+
+// Forces the next frame to be sent in full, e.g. after a failed transfer left the panel in an unknown state
+void DisplayTransport::invalidate()
+{
+	fullRefresh = true;
+}
+
+void DisplayTransport::encodeFrame()
+{
+	const int pages = obd->height >> 3;
+
+	wordCount = 0;
+	chunkCount = 0;
+	nextChunk = 0;
+
+	for (int page = 0; page < pages; page++)
+	{
+		uint8_t *src = &pendingFrame[page * obd->width];
+		uint8_t *dest = &frontBuffer[page * obd->width];
+		int firstCol = 0;
+		int lastCol = obd->width - 1;
+
+		if (!fullRefresh)
+		{
+			while (firstCol <= lastCol && src[firstCol] == dest[firstCol])
+				firstCol++;
+			while (lastCol >= firstCol && src[lastCol] == dest[lastCol])
+				lastCol--;
+		}
+
+		if (firstCol > lastCol)
+			continue;
+
+		if (src != dest)
+			memcpy(&dest[firstCol], &src[firstCol], lastCol - firstCol + 1);
+
+		for (int col = firstCol; col <= lastCol; col += DISPLAY_TRANSPORT_CHUNK_BYTES)
+		{
+			int chunkLast = col + DISPLAY_TRANSPORT_CHUNK_BYTES - 1;
+			encodeChunk(page, col, (chunkLast < lastCol) ? chunkLast : lastCol);
+		}
+	}
+
+	fullRefresh = false;
+}
+
+/* Encodes one chunk as two I2C transactions, a position command followed by the pixel data. This
+matches the bytes obdSetPosition() and obdWriteDataBlock() send, including the panel offsets. */
+void DisplayTransport::encodeChunk(int page, int firstCol, int lastCol)
+{
+	int x = firstCol;
+	int y = page;
+
+	switch (obd->type)
+	{
+		case OLED_64x32:
+			x += 32;
+			if (obd->flip == 0)
+				y += 4;
+			break;
+
+		case OLED_132x64:
+			x += 2;
+			break;
+
+		case OLED_96x16:
+			if (obd->flip)
+				x += 32;
+			else
+				y += 2;
+			break;
+
+		case OLED_72x40:
+			x += 28;
+			if (!obd->flip)
+				y += 3;
+			break;
+	}
+
+	words[wordCount++] = 0x00;                // command introducer
+	words[wordCount++] = 0xb0 | y;            // set page to Y
+	words[wordCount++] = x & 0xf;             // lower column address
+	words[wordCount++] = (0x10 | (x >> 4)) | I2C_IC_DATA_CMD_STOP_BITS;
+
+	words[wordCount++] = 0x40;                // data introducer
+	uint8_t *src = &frontBuffer[(page * obd->width)];
+	for (int col = firstCol; col <= lastCol; col++)
+		words[wordCount++] = src[col];
+
+	words[wordCount - 1] |= I2C_IC_DATA_CMD_STOP_BITS;
+	chunkEnds[chunkCount++] = wordCount;
+}
+
+bool DisplayTransport::startChunk()
+{
+	uint16_t first = (nextChunk == 0) ? 0 : chunkEnds[nextChunk - 1];
+	uint16_t count = chunkEnds[nextChunk] - first;
+
+	// Two extra byte times cover the start and stop conditions of each transaction
+	if (!i2cBus.tryAcquire(I2C_CLIENT_DISPLAY, (count + 2) * byteTimeUS))
+		return false;
+
+	// Same target setup as i2c_write_blocking(), the address can only change while the block is disabled
+	i2c_hw_t *hw = i2c_get_hw(i2c);
+	hw->enable = 0;
+	hw->tar = obd->oled_addr;
+	hw->enable = 1;
+	(void)hw->clr_stop_det;
+	(void)hw->clr_tx_abrt;
+
+	aborted = false;
+	sending = true;
+	chunkStarted = true;
+	nextChunk++;
+	dma_channel_transfer_from_buffer_now(dmaChannel, &words[first], count);
+
+	// Only while the display holds the bus, the touch code polls the same status bits itself
+	hw->intr_mask = I2C_IC_INTR_MASK_M_STOP_DET_BITS | I2C_IC_INTR_MASK_M_TX_ABRT_BITS;
+	return true;
+}
+
+/* Runs on every STOP and abort while a chunk is on the wire. Each chunk is two transactions, so the
+first STOP is ignored until DMA has fed the last word and the controller has sent it. */
+void DisplayTransport::handleIRQ()
+{
+	i2c_hw_t *hw = i2c_get_hw(i2c);
+
+	// Never touch the status bits of a transfer that isn't ours
+	if (!sending)
+	{
+		hw->intr_mask = 0;
+		return;
+	}
+
+	// Cleared before checking, so a STOP that lands in between raises the interrupt again
+	(void)hw->clr_stop_det;
+
+	if (hw->raw_intr_stat & I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS)
+	{
+		// The controller flushes its FIFO on an abort, so stop feeding it
+		dma_channel_abort(dmaChannel);
+		(void)hw->clr_tx_abrt;
+		aborted = true;
+	}
+	else if (dma_channel_is_busy(dmaChannel) || !(hw->status & I2C_IC_STATUS_TFE_BITS) || (hw->status & I2C_IC_STATUS_MST_ACTIVITY_BITS))
+		return;
+
+	hw->intr_mask = 0;
+	sending = false;
+	i2cBus.release(I2C_CLIENT_DISPLAY);
+}
+
+void DisplayTransport::chunkFinished()
+{
+	if (aborted)
+	{
+		// Resend the whole frame, the panel is in an unknown state
+		transferErrors++;
+		nextChunk = chunkCount;
+		invalidate();
+		if (pendingFrame == nullptr)
+			pendingFrame = frontBuffer;
+	}
+	else if (nextChunk >= chunkCount)
+		framesSent++;
+}
@@ -0,0 +1,324 @@
+/*
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <string.h>
+#include "firmware_update.h"
+#include "CRC32.h"
+#include "pico/bootrom.h"
+#include "pico/multicore.h"
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+#include "hardware/structs/scb.h"
+
+#define UF2_MAGIC_START0        0x0A324655
+#define UF2_MAGIC_START1        0x9E5D5157
+#define UF2_MAGIC_END           0x0AB16F30
+#define UF2_FLAG_NOT_MAIN_FLASH 0x00000001
+#define UF2_FLAG_FAMILY_ID      0x00002000
+#define UF2_FAMILY_RP2040       0xE48BFF56
+#define UF2_PAYLOAD_SIZE        256
+
+#define SWAP_STACK_TOP          0x20042000 // Top of SRAM, the stub's sector buffer lives on this stack
+#define SWAP_VECTORS_OFFSET     0x100      // Where boot2 expects the initial SP and reset vector
+#define SWAP_LOADER_OFFSET      0x140
+#define SWAP_STUB_OFFSET        0x200
+#define SWAP_STUB_MAX           (FLASH_SECTOR_SIZE - SWAP_STUB_OFFSET)
+#define SWAP_BLOCK_ERASE_CMD    0xD8
+
+struct UF2Block
+{
+	uint32_t magicStart0;
+	uint32_t magicStart1;
+	uint32_t flags;
+	uint32_t targetAddr;
+	uint32_t payloadSize;
+	uint32_t blockNo;
+	uint32_t numBlocks;
+	uint32_t familyID;
+	uint8_t data[476];
+	uint32_t magicEnd;
+};
+
+static_assert(sizeof(UF2Block) == 512, "UF2 blocks are 512 bytes");
+static_assert(FIRMWARE_STAGING_SIZE <= FIRMWARE_STAGING_OFFSET, "A staged image would overwrite itself while it is copied");
+
+extern char __flash_binary_end; // End of the running image, from the linker script
+
+FirmwareUpdate firmwareUpdate;
+
+static UF2Block block;
+static uint16_t blockLength = 0;
+static uint8_t sectorData[FLASH_SECTOR_SIZE]; // The only part of the image held in RAM
+static int32_t sector = -1;                   // Image sector in sectorData, -1 before the first block
+
+// Core1 is held off and interrupts are disabled while XIP is unavailable, the same as for saves
+static void programStagingSector(int32_t index, const uint8_t *data)
+{
+	uint32_t offset = FIRMWARE_STAGING_OFFSET + (index * FLASH_SECTOR_SIZE);
+
+	multicore_lockout_start_blocking();
+	uint32_t interrupts = save_and_disable_interrupts();
+	flash_range_erase(offset, FLASH_SECTOR_SIZE);
+	if (data != nullptr)
+		flash_range_program(offset, data, FLASH_SECTOR_SIZE);
+	restore_interrupts(interrupts);
+	multicore_lockout_end_blocking();
+}
+
+typedef void *(*RomLookupFn)(uint16_t *table, uint32_t code);
+typedef void (*RomFlashFn)();
+typedef void (*RomEraseFn)(uint32_t offset, size_t count, uint32_t blockSize, uint8_t blockCmd);
+typedef void (*RomProgramFn)(uint32_t offset, const uint8_t *data, size_t count);
+typedef void (*RomUsbBootFn)(uint32_t gpioMask, uint32_t interfaceMask);
+
+/* The swap stub. It boots from the recovery sector that replaces sector 0 while the image is copied, so it
+runs before anything is set up: it only uses the boot ROM and the swap record, never the firmware it is
+overwriting, and reads through volatile pointers to keep the compiler from calling memcpy. Sectors that
+already match are skipped, so it picks up where a power loss stopped it. Sector 0 goes last. Its erase here
+and in startSwap() are the only moments a power loss leaves nothing to boot, the ROM then falls back to BOOTSEL. */
+static void __not_in_flash_func(swapStub)()
+{
+	RomLookupFn lookup = reinterpret_cast<RomLookupFn>(static_cast<uintptr_t>(*reinterpret_cast<const volatile uint16_t *>(0x18)));
+	uint16_t *table = reinterpret_cast<uint16_t *>(static_cast<uintptr_t>(*reinterpret_cast<const volatile uint16_t *>(0x14)));
+	RomFlashFn connectFlash = reinterpret_cast<RomFlashFn>(lookup(table, ROM_TABLE_CODE('I', 'F')));
+	RomFlashFn exitXIP      = reinterpret_cast<RomFlashFn>(lookup(table, ROM_TABLE_CODE('E', 'X')));
+	RomEraseFn erase        = reinterpret_cast<RomEraseFn>(lookup(table, ROM_TABLE_CODE('R', 'E')));
+	RomProgramFn program    = reinterpret_cast<RomProgramFn>(lookup(table, ROM_TABLE_CODE('R', 'P')));
+	RomFlashFn flushCache   = reinterpret_cast<RomFlashFn>(lookup(table, ROM_TABLE_CODE('F', 'C')));
+	RomFlashFn enterXIP     = reinterpret_cast<RomFlashFn>(lookup(table, ROM_TABLE_CODE('C', 'X')));
+
+	const volatile FirmwareSwapRecord *record = reinterpret_cast<const volatile FirmwareSwapRecord *>(FIRMWARE_SWAP_START);
+	uint32_t sectors = record->sectors;
+	if (record->magic != FIRMWARE_SWAP_MAGIC || record->check != (~FIRMWARE_SWAP_MAGIC ^ sectors)
+		|| sectors == 0 || sectors > FIRMWARE_STAGING_SIZE / FLASH_SECTOR_SIZE)
+	{
+		RomUsbBootFn usbBoot = reinterpret_cast<RomUsbBootFn>(lookup(table, ROM_TABLE_CODE('U', 'B')));
+		usbBoot(0, 0);
+	}
+
+	uint32_t buffer[FLASH_SECTOR_SIZE / sizeof(uint32_t)];
+	for (uint32_t n = 1; n <= sectors; n++)
+	{
+		uint32_t offset = (n == sectors) ? 0 : n * FLASH_SECTOR_SIZE;
+		const volatile uint32_t *source = reinterpret_cast<const volatile uint32_t *>(FIRMWARE_STAGING_START + offset);
+		const volatile uint32_t *target = reinterpret_cast<const volatile uint32_t *>(XIP_BASE + offset);
+
+		bool copied = (offset != 0); // Sector 0 holds this stub until the end
+		for (uint32_t i = 0; i < FLASH_SECTOR_SIZE / sizeof(uint32_t); i++)
+		{
+			buffer[i] = source[i];
+			if (buffer[i] != target[i])
+				copied = false;
+		}
+
+		if (copied)
+			continue;
+
+		connectFlash();
+		exitXIP();
+		erase(offset, FLASH_SECTOR_SIZE, FLASH_BLOCK_SIZE, SWAP_BLOCK_ERASE_CMD);
+		program(offset, reinterpret_cast<const uint8_t *>(buffer), FLASH_SECTOR_SIZE);
+		flushCache();
+		enterXIP();
+	}
+
+	connectFlash();
+	exitXIP();
+	erase(FIRMWARE_SWAP_START - XIP_BASE, FLASH_SECTOR_SIZE, FLASH_BLOCK_SIZE, SWAP_BLOCK_ERASE_CMD);
+	flushCache();
+	enterXIP();
+
+	scb_hw->aircr = (0x5FA << M0PLUS_AIRCR_VECTKEY_LSB) | M0PLUS_AIRCR_SYSRESETREQ_BITS;
+	while (1)
+		tight_loop_contents();
+}
+
+/* Copies the stub from its place in RAM to the same address and jumps to it, assembled from
+	ldr r0, =source; ldr r1, =stub; ldr r2, =words
+1:	ldmia r0!, {r3}; stmia r1!, {r3}; subs r2, #1; bne 1b
+	ldr r0, =stub + 1; bx r0
+followed by the four literals. */
+static const uint16_t swapLoader[] = { 0x4804, 0x4905, 0x4A05, 0xC808, 0xC108, 0x3A01, 0xD1FB, 0x4804, 0x4700, 0x46C0 };
+
+/* The recovery sector keeps the running boot2, so XIP comes up as usual, and points the reset vector at
+the loader. The stub is taken as SWAP_STUB_MAX bytes from its start, whatever follows it is never run.
+check-swap-stub.py fails the build if the stub and its literal pool outgrow that. */
+static void buildRecoverySector(uint8_t *data)
+{
+	uintptr_t stub = reinterpret_cast<uintptr_t>(&swapStub) & ~1u;
+	uint32_t *vectors = reinterpret_cast<uint32_t *>(&data[SWAP_VECTORS_OFFSET]);
+	uint32_t *literals = reinterpret_cast<uint32_t *>(&data[SWAP_LOADER_OFFSET + sizeof(swapLoader)]);
+
+	memset(data, 0xFF, FLASH_SECTOR_SIZE);
+	memcpy(data, reinterpret_cast<const void *>(XIP_BASE), 256);
+	vectors[0] = SWAP_STACK_TOP;
+	vectors[1] = (XIP_BASE + SWAP_LOADER_OFFSET) | 1;
+	memcpy(&data[SWAP_LOADER_OFFSET], swapLoader, sizeof(swapLoader));
+	literals[0] = XIP_BASE + SWAP_STUB_OFFSET;
+	literals[1] = stub;
+	literals[2] = SWAP_STUB_MAX / sizeof(uint32_t);
+	literals[3] = stub | 1;
+	memcpy(&data[SWAP_STUB_OFFSET], reinterpret_cast<const void *>(stub), SWAP_STUB_MAX);
+}
+
+/* Runs from RAM since it replaces sector 0 of the firmware it was called from. The record goes first, a
+power loss before sector 0 is erased leaves the old firmware running and the record is simply rewritten
+by the next update. */
+static void __not_in_flash_func(startSwap)(const uint8_t *record, const uint8_t *recovery)
+{
+	multicore_lockout_start_blocking();
+	save_and_disable_interrupts();
+
+	flash_range_erase(FIRMWARE_SWAP_START - XIP_BASE, FLASH_SECTOR_SIZE);
+	flash_range_program(FIRMWARE_SWAP_START - XIP_BASE, record, FLASH_PAGE_SIZE);
+	flash_range_erase(0, FLASH_SECTOR_SIZE);
+	flash_range_program(0, recovery, FLASH_SECTOR_SIZE);
+
+	scb_hw->aircr = (0x5FA << M0PLUS_AIRCR_VECTKEY_LSB) | M0PLUS_AIRCR_SYSRESETREQ_BITS;
+	while (1)
+		tight_loop_contents();
+}
+
+void FirmwareUpdate::begin(uint32_t contentLength)
+{
+	state = FIRMWARE_RECEIVING;
+	error = nullptr;
+	size = 0;
+	crc = 0;
+	hasBootBlock = false;
+	applyPending = false;
+	blockLength = 0;
+	sector = -1;
+
+	if (reinterpret_cast<uintptr_t>(&__flash_binary_end) > FIRMWARE_STAGING_START)
+		fail("The running firmware is too large to stage an update");
+	else if ((contentLength % sizeof(UF2Block)) != 0)
+		fail("Not a UF2 file");
+	else if ((contentLength / sizeof(UF2Block)) * UF2_PAYLOAD_SIZE > FIRMWARE_STAGING_SIZE)
+		fail("Firmware too large");
+}
+
+// Upload data in whatever pieces the network delivers it, split into UF2 blocks
+void FirmwareUpdate::write(const uint8_t *data, size_t length)
+{
+	uint8_t *blockData = reinterpret_cast<uint8_t *>(&block);
+
+	while (state == FIRMWARE_RECEIVING && length > 0)
+	{
+		size_t count = sizeof(UF2Block) - blockLength;
+		if (count > length)
+			count = length;
+
+		memcpy(&blockData[blockLength], data, count);
+		blockLength += count;
+		data += count;
+		length -= count;
+
+		if (blockLength == sizeof(UF2Block))
+		{
+			handleBlock();
+			blockLength = 0;
+		}
+	}
+}
+
+/* Blocks have to arrive in address order, which is how every UF2 tool writes them. A sector is
+programmed as soon as a block for a later one arrives, sectors the image skips are left erased. */
+void FirmwareUpdate::handleBlock()
+{
+	if (block.magicStart0 != UF2_MAGIC_START0 || block.magicStart1 != UF2_MAGIC_START1 || block.magicEnd != UF2_MAGIC_END)
+		return fail("Not a UF2 file");
+	if (block.flags & UF2_FLAG_NOT_MAIN_FLASH)
+		return;
+	if (!(block.flags & UF2_FLAG_FAMILY_ID) || block.familyID != UF2_FAMILY_RP2040)
+		return fail("Not an RP2040 image");
+	if (block.payloadSize != UF2_PAYLOAD_SIZE || (block.targetAddr % UF2_PAYLOAD_SIZE) != 0
+		|| block.targetAddr < XIP_BASE || block.targetAddr - XIP_BASE + UF2_PAYLOAD_SIZE > FIRMWARE_STAGING_SIZE)
+		return fail("Image does not fit the firmware area");
+
+	uint32_t offset = block.targetAddr - XIP_BASE;
+	int32_t blockSector = offset / FLASH_SECTOR_SIZE;
+
+	if (blockSector < sector)
+		return fail("UF2 blocks out of order");
+
+	if (blockSector != sector)
+	{
+		flushSector();
+		for (int32_t skipped = sector + 1; skipped < blockSector; skipped++)
+			programStagingSector(skipped, nullptr);
+
+		sector = blockSector;
+		memset(sectorData, 0xFF, FLASH_SECTOR_SIZE);
+	}
+
+	memcpy(&sectorData[offset % FLASH_SECTOR_SIZE], block.data, UF2_PAYLOAD_SIZE);
+	if (offset + UF2_PAYLOAD_SIZE > size)
+		size = offset + UF2_PAYLOAD_SIZE;
+	if (offset == 0)
+		hasBootBlock = true;
+}
+
+void FirmwareUpdate::flushSector()
+{
+	if (sector >= 0)
+		programStagingSector(sector, sectorData);
+}
+
+void FirmwareUpdate::fail(const char *reason)
+{
+	state = FIRMWARE_FAILED;
+	error = reason;
+}
+
+// Called once the whole upload has arrived, the CRC covers the staged image as it reads back from flash
+bool FirmwareUpdate::finish()
+{
+	if (state == FIRMWARE_RECEIVING)
+	{
+		if (blockLength != 0)
+			fail("Upload ended in the middle of a block");
+		else if (!hasBootBlock)
+			fail("Image does not start at the beginning of flash");
+	}
+
+	if (state != FIRMWARE_RECEIVING)
+		return false;
+
+	flushSector();
+	sector = -1;
+	crc = CRC32::checksum(reinterpret_cast<const void *>(FIRMWARE_STAGING_START), size);
+	state = FIRMWARE_STAGED;
+	return true;
+}
+
+/* Schedules the copy if the caller's CRC matches the staged image, checked again in case flash changed since.
+The copy itself waits for any pending settings save, a reset would drop it. */
+bool FirmwareUpdate::apply(uint32_t expectedCRC)
+{
+	if (state != FIRMWARE_STAGED || expectedCRC != crc
+		|| CRC32::checksum(reinterpret_cast<const void *>(FIRMWARE_STAGING_START), size) != crc)
+		return false;
+
+	applyAtMS = to_ms_since_boot(get_absolute_time()) + FIRMWARE_APPLY_DELAY_MS;
+	applyPending = true;
+	return true;
+}
+
+void FirmwareUpdate::poll()
+{
+	if (!applyPending || EEPROM.isBusy() || (int32_t)(to_ms_since_boot(get_absolute_time()) - applyAtMS) < 0)
+		return;
+
+	uint8_t record[FLASH_PAGE_SIZE];
+	FirmwareSwapRecord swap;
+	swap.magic = FIRMWARE_SWAP_MAGIC;
+	swap.sectors = (size + FLASH_SECTOR_SIZE - 1) / FLASH_SECTOR_SIZE;
+	swap.check = ~FIRMWARE_SWAP_MAGIC ^ swap.sectors;
+	memset(record, 0xFF, sizeof(record));
+	memcpy(record, &swap, sizeof(swap));
+
+	buildRecoverySector(sectorData);
+	startSwap(record, sectorData);
+}
@@ -11,6 +11,88 @@
 #include "OneBitDisplay.h"
 #include "Adafruit_MPR121.h"
 #include "Arduino.h"
+#include "i2c_bus.h"
+#include "leds.h"
+#include "pleds.h"
+
+static GamepadProfile profiles[PROFILE_COUNT];
+
+static void decodeProfile(const ProfileOptions &options, GamepadProfile &profile)
+{
+	for (int i = 0; i < PROFILE_PIN_COUNT; i++)
+	{
+		profile.pins[i] = options.pins[i];
+		profile.pinMasks[i] = 1 << options.pins[i];
+	}
+
+	profile.dpadMode = (DpadMode)options.dpadMode;
+	profile.socdMode = (SOCDMode)options.socdMode;
+	profile.sliderRange = (options.sliderRange > 0) ? options.sliderRange : SLIDER_RANGE;
+	profile.sliderStep = GAMEPAD_JOYSTICK_MID / profile.sliderRange;
+}
+
+static void encodeProfile(const GamepadProfile &profile, ProfileOptions &options)
+{
+	memcpy(options.pins, profile.pins, PROFILE_PIN_COUNT);
+	options.dpadMode = profile.dpadMode;
+	options.socdMode = profile.socdMode;
+	options.sliderRange = profile.sliderRange;
+}
+
+static void reservePin(uint32_t &pins, int pin)
+{
+	if (pin >= 0 && pin < NUM_BANK0_GPIOS)
+		pins |= 1 << pin;
+}
+
+// Pins owned by the I2C bus and the LED outputs, which a stored profile must never turn into inputs
+static uint32_t getReservedPins(const BoardOptions &boardOptions)
+{
+	uint32_t pins = 0;
+	reservePin(pins, boardOptions.i2cSDAPin);
+	reservePin(pins, boardOptions.i2cSCLPin);
+
+	LEDOptions ledOptions = getLEDOptions();
+	if (ledOptions.useUserDefinedLEDs)
+	{
+		reservePin(pins, ledOptions.dataPin);
+		for (int i = 0; i < LED_CHAIN_MAX - 1; i++)
+			reservePin(pins, ledOptions.chainPins[i]);
+	}
+	else
+	{
+		reservePin(pins, BOARD_LEDS_PIN);
+		reservePin(pins, LED_CHAIN1_PIN);
+		reservePin(pins, LED_CHAIN2_PIN);
+		reservePin(pins, LED_CHAIN3_PIN);
+	}
+
+	if (PLED_TYPE == PLED_TYPE_PWM)
+	{
+		reservePin(pins, PLED1_PIN);
+		reservePin(pins, PLED2_PIN);
+		reservePin(pins, PLED3_PIN);
+		reservePin(pins, PLED4_PIN);
+	}
+
+	return pins;
+}
+
+// The pin fields of BoardOptions, in the same order as gamepadMappings
+static void setBoardPins(BoardOptions &boardOptions, const uint8_t *pins)
+{
+	uint8_t *boardPins[PROFILE_PIN_COUNT] =
+	{
+		&boardOptions.pinDpadUp,   &boardOptions.pinDpadDown, &boardOptions.pinDpadLeft, &boardOptions.pinDpadRight,
+		&boardOptions.pinButtonB1, &boardOptions.pinButtonB2, &boardOptions.pinButtonB3, &boardOptions.pinButtonB4,
+		&boardOptions.pinButtonL1, &boardOptions.pinButtonR1, &boardOptions.pinButtonL2, &boardOptions.pinButtonR2,
+		&boardOptions.pinButtonS1, &boardOptions.pinButtonS2, &boardOptions.pinButtonL3, &boardOptions.pinButtonR3,
+		&boardOptions.pinButtonA1, &boardOptions.pinButtonA2
+	};
+
+	for (int i = 0; i < PROFILE_PIN_COUNT; i++)
+		*boardPins[i] = pins[i];
+}
 
 void Gamepad::setup()
 {
@@ -48,11 +130,24 @@ void Gamepad::setup()
 		mapButtonA1, mapButtonA2
 	};
 
-	for (int i = 0; i < GAMEPAD_DIGITAL_INPUT_COUNT; i++)
+	setupProfiles();
+
+	// Every pin of every profile is set up now, so switching profiles never has to touch the GPIOs
+	uint32_t profilePins = 0;
+	for (int index = 0; index < PROFILE_COUNT; index++)
 	{
-		gpio_init(gamepadMappings[i]->pin);             // Initialize pin
-		gpio_set_dir(gamepadMappings[i]->pin, GPIO_IN); // Set as INPUT
-		gpio_pull_up(gamepadMappings[i]->pin);          // Set as PULLUP
+		for (int i = 0; i < PROFILE_PIN_COUNT; i++)
+			profilePins |= profiles[index].pinMasks[i];
+	}
+
+	for (uint pin = 0; pin < NUM_BANK0_GPIOS; pin++)
+	{
+		if (!(profilePins & (1 << pin)))
+			continue;
+
+		gpio_init(pin);             // Initialize pin
+		gpio_set_dir(pin, GPIO_IN); // Set as INPUT
+		gpio_pull_up(pin);          // Set as PULLUP
 	}
 
 	#ifdef PIN_SETTINGS
@@ -96,6 +191,158 @@ void Gamepad::setup()
 	hasRightAnalogStick = true;
 }
 
+// F1 + L3 toggles the display's slider diagnostics, handled here so the buttons never reach the host
+void Gamepad::diagnosticsHotkey()
+{
+	static bool wasPressed = false;
+
+	const bool pressed = pressedF1() && pressedL3();
+	if (pressed)
+	{
+		state.buttons &= ~(GAMEPAD_MASK_L3 | f1Mask);
+		if (!wasPressed)
+			showDiagnostics = !showDiagnostics;
+	}
+
+	wasPressed = pressed;
+}
+
+/* Reads and decodes every profile bank once at boot. Banks that were never written start out as a copy
+of the current settings, and the active bank takes the live options, which may have been changed by the
+web configurator or hotkeys since it was stored. */
+void Gamepad::setupProfiles()
+{
+	ProfileOptions current;
+	for (int i = 0; i < PROFILE_PIN_COUNT; i++)
+		current.pins[i] = gamepadMappings[i]->pin;
+
+	current.dpadMode = options.dpadMode;
+	current.socdMode = options.socdMode;
+	current.sliderRange = SLIDER_RANGE;
+
+	// A bank pin on the I2C bus or an LED output falls back to the current mapping, like one out of range
+	uint32_t reservedPins = getReservedPins(getBoardOptions());
+
+	activeProfile = getActiveProfile();
+	for (uint8_t index = 0; index < PROFILE_COUNT; index++)
+	{
+		ProfileOptions stored;
+		if (!getProfileOptions(index, stored))
+			stored = current;
+
+		for (int i = 0; i < PROFILE_PIN_COUNT; i++)
+		{
+			if (index == activeProfile || stored.pins[i] >= NUM_BANK0_GPIOS || (reservedPins & (1 << stored.pins[i])))
+				stored.pins[i] = current.pins[i];
+		}
+
+		if (index == activeProfile)
+		{
+			stored.dpadMode = current.dpadMode;
+			stored.socdMode = current.socdMode;
+		}
+
+		decodeProfile(stored, profiles[index]);
+	}
+
+	applyProfile(profiles[activeProfile]);
+}
+
+void Gamepad::applyProfile(const GamepadProfile &profile)
+{
+	for (int i = 0; i < PROFILE_PIN_COUNT; i++)
+	{
+		gamepadMappings[i]->pin = profile.pins[i];
+		gamepadMappings[i]->pinMask = profile.pinMasks[i];
+	}
+
+	options.dpadMode = profile.dpadMode;
+	options.socdMode = profile.socdMode;
+	sliderRange = profile.sliderRange;
+	sliderStep = profile.sliderStep;
+}
+
+void Gamepad::storeProfile(uint8_t index)
+{
+	ProfileOptions stored;
+	encodeProfile(profiles[index], stored);
+	setProfileOptions(index, stored);
+}
+
+/* Runs between two input frames and only touches RAM. The banks and the mirrored board and gamepad
+options are saved by the idle-time flash commit later on. */
+void Gamepad::setProfile(uint8_t index)
+{
+	if (index >= PROFILE_COUNT || index == activeProfile)
+		return;
+
+	// Keep any hotkey changes made while the old profile was active
+	profiles[activeProfile].dpadMode = options.dpadMode;
+	profiles[activeProfile].socdMode = options.socdMode;
+	storeProfile(activeProfile);
+
+	activeProfile = index;
+	applyProfile(profiles[activeProfile]);
+	setActiveProfile(activeProfile);
+
+	BoardOptions boardOptions = getBoardOptions();
+	setBoardPins(boardOptions, profiles[activeProfile].pins);
+	setBoardOptions(boardOptions);
+	save();
+}
+
+// Changes the slider travel of the active profile, also saved by the idle-time flash commit
+bool Gamepad::setSliderRange(int16_t range)
+{
+	if (range < 1 || range > SLIDER_RANGE_MAX)
+		return false;
+
+	GamepadProfile &profile = profiles[activeProfile];
+	profile.dpadMode = options.dpadMode;
+	profile.socdMode = options.socdMode;
+	profile.sliderRange = range;
+	profile.sliderStep = GAMEPAD_JOYSTICK_MID / range;
+	sliderRange = profile.sliderRange;
+	sliderStep = profile.sliderStep;
+	storeProfile(activeProfile);
+	save();
+
+	return true;
+}
+
+// F2 + B1-B4 selects one of the first four profiles, F2 + L1/R1 steps through all of them
+void Gamepad::profileHotkey()
+{
+	static bool wasPressed = false;
+
+	if (!pressedF2())
+	{
+		wasPressed = false;
+		return;
+	}
+
+	int index = -1;
+	uint16_t buttonMask = 0;
+	if (pressedB1())      { index = 0; buttonMask = GAMEPAD_MASK_B1; }
+	else if (pressedB2()) { index = 1; buttonMask = GAMEPAD_MASK_B2; }
+	else if (pressedB3()) { index = 2; buttonMask = GAMEPAD_MASK_B3; }
+	else if (pressedB4()) { index = 3; buttonMask = GAMEPAD_MASK_B4; }
+	else if (pressedL1()) { index = (activeProfile + PROFILE_COUNT - 1) % PROFILE_COUNT; buttonMask = GAMEPAD_MASK_L1; }
+	else if (pressedR1()) { index = (activeProfile + 1) % PROFILE_COUNT; buttonMask = GAMEPAD_MASK_R1; }
+
+	if (index < 0)
+	{
+		wasPressed = false;
+		return;
+	}
+
+	state.buttons &= ~(buttonMask | f2Mask);
+	if (!wasPressed)
+		setProfile(index);
+
+	wasPressed = true;
+}
+
 void Gamepad::read()
 {
 	// Need to invert since we're using pullups
@@ -147,17 +394,26 @@ void Gamepad::slideBar()
 	{
 		return;
 	}
-	currtouched = mpr121_1->touched();
+	if (isTouch32Bit && (mpr121_2 == nullptr || mpr121_3 == nullptr))
+	{
+		return;
+	}
 
+	uint32_t scanStartUS = time_us_32();
+	i2cBus.acquire(I2C_CLIENT_TOUCH);
+	currtouched = mpr121_1->touched();
+	touchErrors = mpr121_1->errorCount;
 	if (isTouch32Bit)
 	{
-		if (mpr121_2 == nullptr || mpr121_3 == nullptr)
-		{
-			return;
-		}
 		currtouched |= mpr121_2->touched() << 12;
 		currtouched |= mpr121_3->touched() << 24;
+		touchErrors += mpr121_2->errorCount + mpr121_3->errorCount;
 	}
+	i2cBus.release(I2C_CLIENT_TOUCH);
+
+	// Average over roughly the last 16 scans
+	uint32_t scanUS = time_us_32() - scanStartUS;
+	touchScanUS = touchScanUS + ((int32_t)(scanUS - touchScanUS) / 16);
 
 	makeTouchedPosition(currtouched, currTouchedPositionL, currTouchedPositionR);
 
@@ -184,15 +440,15 @@ void Gamepad::slideBar()
 	{
 		//触れている途中
 		int16_t dist = currTouchedPositionL - startTouchedPositionL;
-		if (dist > 3)
+		if (dist > sliderRange)
 		{
-			dist = 3;
+			dist = sliderRange;
 		}
-		else if (dist < -3)
+		else if (dist < -sliderRange)
 		{
-			dist = -3;
+			dist = -sliderRange;
 		}
-		state.lx = GAMEPAD_JOYSTICK_MID + dist * (GAMEPAD_JOYSTICK_MID / 3);
+		state.lx = GAMEPAD_JOYSTICK_MID + dist * sliderStep;
 	}
 
 	lastTouchedPositionL = currTouchedPositionL;
@@ -220,15 +476,15 @@ void Gamepad::slideBar()
 	{
 		//触れている途中
 		int16_t dist = currTouchedPositionR - startTouchedPositionR;
-		if (dist > 3)
+		if (dist > sliderRange)
 		{
-			dist = 3;
+			dist = sliderRange;
 		}
-		else if (dist < -3)
+		else if (dist < -sliderRange)
 		{
-			dist = -3;
+			dist = -sliderRange;
 		}
-		state.lx = GAMEPAD_JOYSTICK_MID + dist * (GAMEPAD_JOYSTICK_MID / 3);
+		state.lx = GAMEPAD_JOYSTICK_MID + dist * sliderStep;
 	}
 
 	lastTouchedPositionR = currTouchedPositionR;
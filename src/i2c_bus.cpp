@@ -0,0 +1,110 @@
+/*
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "i2c_bus.h"
+#include "pico/time.h"
+
+I2CBusArbiter i2cBus;
+
+// Must run before the second core is launched
+void I2CBusArbiter::init()
+{
+	if (lock == nullptr)
+		lock = spin_lock_init(spin_lock_claim_unused(true));
+
+	resetStats();
+}
+
+// Blocks until the bus is free. The touch client flags its request first, so the display backs off immediately.
+void I2CBusArbiter::acquire(I2CClient client)
+{
+	uint32_t startUS = time_us_32();
+
+	if (client == I2C_CLIENT_TOUCH)
+		touchPending = true;
+
+	while (!tryAcquire(client, 0))
+		tight_loop_contents();
+
+	if (client == I2C_CLIENT_TOUCH)
+	{
+		uint32_t waitUS = acquiredUS - startUS;
+		if (waitUS > maxTouchWaitUS)
+			maxTouchWaitUS = waitUS;
+
+		if (lastTouchUS != 0)
+			touchPeriodUS = acquiredUS - lastTouchUS;
+
+		lastTouchUS = acquiredUS;
+	}
+}
+
+bool I2CBusArbiter::tryAcquire(I2CClient client, uint32_t durationUS)
+{
+	uint32_t nowUS = time_us_32();
+
+	if (client != I2C_CLIENT_TOUCH)
+	{
+		if (touchPending)
+			return false;
+
+		// Only start if the transfer fits before the next touch scan, or the touch scans have stopped
+		uint32_t elapsedUS = nowUS - touchReleasedUS;
+		if (touchPeriodUS != 0 && durationUS < touchPeriodUS && elapsedUS < touchPeriodUS && elapsedUS + durationUS > touchPeriodUS)
+			return false;
+	}
+
+	uint32_t save = spin_lock_blocking(lock);
+	bool granted = (owner == I2C_CLIENT_NONE);
+	if (granted)
+	{
+		owner = client;
+		acquiredUS = nowUS;
+		if (client == I2C_CLIENT_TOUCH)
+			touchPending = false;
+	}
+	spin_unlock(lock, save);
+
+	return granted;
+}
+
+void I2CBusArbiter::release(I2CClient client)
+{
+	uint32_t nowUS = time_us_32();
+
+	uint32_t save = spin_lock_blocking(lock);
+	if (owner == client)
+	{
+		busyUS[client] += nowUS - acquiredUS;
+		if (client == I2C_CLIENT_TOUCH)
+			touchReleasedUS = nowUS;
+
+		owner = I2C_CLIENT_NONE;
+	}
+	spin_unlock(lock, save);
+}
+
+uint8_t I2CBusArbiter::getOccupancy(I2CClient client)
+{
+	uint32_t save = spin_lock_blocking(lock);
+	uint64_t clientBusyUS = busyUS[client];
+	uint64_t elapsedUS = time_us_64() - statsStartUS;
+	spin_unlock(lock, save);
+
+	if (elapsedUS == 0)
+		return 0;
+
+	return clientBusyUS * 100 / elapsedUS;
+}
+
+void I2CBusArbiter::resetStats()
+{
+	uint32_t save = spin_lock_blocking(lock);
+	for (int i = 0; i < I2C_CLIENT_COUNT; i++)
+		busyUS[i] = 0;
+
+	maxTouchWaitUS = 0;
+	statsStartUS = time_us_64();
+	spin_unlock(lock, save);
+}
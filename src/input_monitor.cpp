@@ -0,0 +1,190 @@
+/*
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "input_monitor.h"
+#include "lwip/tcp.h"
+
+InputMonitor inputMonitor;
+
+struct InputMonitorClient
+{
+	struct tcp_pcb *pcb;
+	bool requested; // The request has been read, the response header may still be waiting for room
+	bool streaming; // The response header has been sent
+	uint32_t lastSendMS;
+	char lastRecord[INPUT_MONITOR_RECORD_SIZE];
+};
+
+static InputMonitorClient clients[INPUT_MONITOR_MAX_CLIENTS];
+
+static const char streamHeader[] =
+	"HTTP/1.1 200 OK\r\n"
+	"Content-Type: text/event-stream\r\n"
+	"Cache-Control: no-cache\r\n"
+	"Access-Control-Allow-Origin: *\r\n"
+	"\r\n"
+	"retry: 1000\n\n";
+
+static void resetClient(InputMonitorClient *client, struct tcp_pcb *pcb)
+{
+	client->pcb = pcb;
+	client->requested = false;
+	client->streaming = false;
+	client->lastSendMS = 0;
+	client->lastRecord[0] = '\0'; // A new client always gets the current state
+}
+
+static void closeClient(InputMonitorClient *client)
+{
+	struct tcp_pcb *pcb = client->pcb;
+	resetClient(client, nullptr);
+
+	tcp_arg(pcb, nullptr);
+	tcp_recv(pcb, nullptr);
+	tcp_err(pcb, nullptr);
+	if (tcp_close(pcb) != ERR_OK)
+		tcp_abort(pcb);
+}
+
+// Only a few events may be in flight, so a client that falls behind skips states instead of queueing them
+static bool sendToClient(InputMonitorClient *client, const char *data, uint16_t length)
+{
+	uint16_t available = tcp_sndbuf(client->pcb);
+	if (available < length || TCP_SND_BUF - available > INPUT_MONITOR_MAX_IN_FLIGHT)
+		return false;
+
+	if (tcp_write(client->pcb, data, length, TCP_WRITE_FLAG_COPY) != ERR_OK)
+		return false;
+
+	tcp_output(client->pcb);
+	return true;
+}
+
+// Retried from update() until the send buffer takes it, the stream only starts once it has gone out
+static void sendHeader(InputMonitorClient *client)
+{
+	if (tcp_write(client->pcb, streamHeader, sizeof(streamHeader) - 1, 0) != ERR_OK)
+		return;
+
+	tcp_output(client->pcb);
+	client->streaming = true;
+}
+
+static void onError(void *arg, err_t err)
+{
+	// The pcb has already been freed
+	resetClient((InputMonitorClient *)arg, nullptr);
+}
+
+static err_t onReceive(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err)
+{
+	InputMonitorClient *client = (InputMonitorClient *)arg;
+
+	if (p == nullptr)
+	{
+		closeClient(client);
+		return ERR_OK;
+	}
+
+	// Any request starts the stream, there is only the one resource on this port
+	tcp_recved(pcb, p->tot_len);
+	pbuf_free(p);
+
+	if (!client->requested)
+	{
+		client->requested = true;
+		sendHeader(client);
+	}
+
+	return ERR_OK;
+}
+
+static err_t onAccept(void *arg, struct tcp_pcb *pcb, err_t err)
+{
+	if (err != ERR_OK || pcb == nullptr)
+		return ERR_VAL;
+
+	for (auto &client : clients)
+	{
+		if (client.pcb == nullptr)
+		{
+			resetClient(&client, pcb);
+			tcp_arg(pcb, &client);
+			tcp_recv(pcb, onReceive);
+			tcp_err(pcb, onError);
+			tcp_nagle_disable(pcb);
+			return ERR_OK;
+		}
+	}
+
+	tcp_abort(pcb);
+	return ERR_ABRT;
+}
+
+// Must run after lwIP has been initialized
+void InputMonitor::start()
+{
+	struct tcp_pcb *pcb = tcp_new();
+	if (pcb == nullptr)
+		return;
+
+	if (tcp_bind(pcb, IP_ANY_TYPE, INPUT_MONITOR_PORT) != ERR_OK)
+	{
+		tcp_close(pcb);
+		return;
+	}
+
+	pcb = tcp_listen(pcb);
+	tcp_accept(pcb, onAccept);
+}
+
+void InputMonitor::update(Gamepad &gamepad)
+{
+	uint32_t nowMS = to_ms_since_boot(get_absolute_time());
+	if (nowMS - lastUpdateMS < INPUT_MONITOR_INTERVAL_MS)
+		return;
+
+	lastUpdateMS = nowMS;
+
+	bool anyClient = false;
+	for (auto &client : clients)
+	{
+		if (client.requested && !client.streaming)
+			sendHeader(&client);
+
+		anyClient |= client.streaming;
+	}
+
+	if (!anyClient)
+		return;
+
+	char record[INPUT_MONITOR_RECORD_SIZE];
+	int length = snprintf(record, sizeof(record), "data:%x,%x,%x,%lx,%d,%d,%x,%x,%x,%x,%x,%x\n\n",
+		gamepad.state.buttons, gamepad.state.dpad, gamepad.state.aux, (unsigned long)gamepad.currtouched,
+		gamepad.currTouchedPositionL, gamepad.currTouchedPositionR,
+		gamepad.state.lx, gamepad.state.ly, gamepad.state.rx, gamepad.state.ry, gamepad.state.lt, gamepad.state.rt);
+
+	for (auto &client : clients)
+	{
+		if (!client.streaming)
+			continue;
+
+		// A client keeps its last sent record until it can take a new one, so no change is lost for good
+		if (strcmp(record, client.lastRecord) != 0)
+		{
+			if (sendToClient(&client, record, length))
+			{
+				memcpy(client.lastRecord, record, length + 1);
+				client.lastSendMS = nowMS;
+			}
+		}
+		else if (nowMS - client.lastSendMS >= INPUT_MONITOR_HEARTBEAT_MS)
+		{
+			if (sendToClient(&client, ":\n\n", 3))
+				client.lastSendMS = nowMS;
+		}
+	}
+}
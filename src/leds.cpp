@@ -9,10 +9,12 @@
 
 #include "AnimationStation.hpp"
 #include "AnimationStorage.hpp"
+#include "FlashPROM.h"
 #include "NeoPico.hpp"
 #include "Pixel.hpp"
 #include "PlayerLEDs.h"
 #include "gp2040.h"
+#include "led_layouts.h"
 #include "leds.h"
 #include "pleds.h"
 #include "storage.h"
@@ -20,202 +22,14 @@
 
 using namespace std;
 
-static vector<uint8_t> EMPTY_VECTOR;
-extern void setRGBPLEDs(uint32_t *frame);
+extern void setRGBPLEDs(uint32_t *frame, uint16_t ledCount);
 
-uint8_t ledCount;
 PixelMatrix matrix;
-NeoPico *neopico;
 AnimationStation as;
 queue_t baseAnimationQueue;
 queue_t buttonAnimationQueue;
 queue_t animationSaveQueue;
-map<string, int> buttonPositions;
-
-inline vector<uint8_t> *getLEDPositions(string button, vector<vector<uint8_t>> *positions)
-{
-	int buttonPosition = buttonPositions[button];
-	if (buttonPosition < 0)
-		return &EMPTY_VECTOR;
-	else
-		return &positions->at(buttonPosition);
-}
-
-/**
- * @brief Create an LED layout using a 2x4 matrix.
- */
-vector<vector<Pixel>> createLedLayoutArcadeButtons(vector<vector<uint8_t>> *positions)
-{
-	vector<vector<Pixel>> pixels =
-	{
-		{
-			Pixel(buttonPositions[BUTTON_LABEL_B3], GAMEPAD_MASK_B3, *getLEDPositions(BUTTON_LABEL_B3, positions)),
-			Pixel(buttonPositions[BUTTON_LABEL_B1], GAMEPAD_MASK_B1, *getLEDPositions(BUTTON_LABEL_B1, positions)),
-		},
-		{
-			Pixel(buttonPositions[BUTTON_LABEL_B4], GAMEPAD_MASK_B4, *getLEDPositions(BUTTON_LABEL_B4, positions)),
-			Pixel(buttonPositions[BUTTON_LABEL_B2], GAMEPAD_MASK_B2, *getLEDPositions(BUTTON_LABEL_B2, positions)),
-		},
-		{
-			Pixel(buttonPositions[BUTTON_LABEL_R1], GAMEPAD_MASK_R1, *getLEDPositions(BUTTON_LABEL_R1, positions)),
-			Pixel(buttonPositions[BUTTON_LABEL_R2], GAMEPAD_MASK_R2, *getLEDPositions(BUTTON_LABEL_R2, positions)),
-		},
-		{
-			Pixel(buttonPositions[BUTTON_LABEL_L1], GAMEPAD_MASK_L1, *getLEDPositions(BUTTON_LABEL_L1, positions)),
-			Pixel(buttonPositions[BUTTON_LABEL_L2], GAMEPAD_MASK_L2, *getLEDPositions(BUTTON_LABEL_L2, positions)),
-		},
-		{
-			Pixel(buttonPositions[BUTTON_LABEL_LEFT], GAMEPAD_MASK_DL, *getLEDPositions(BUTTON_LABEL_LEFT, positions)),
-			Pixel(buttonPositions[BUTTON_LABEL_DOWN], GAMEPAD_MASK_DD, *getLEDPositions(BUTTON_LABEL_DOWN, positions)),
-			Pixel(buttonPositions[BUTTON_LABEL_RIGHT], GAMEPAD_MASK_DR, *getLEDPositions(BUTTON_LABEL_RIGHT, positions)),
-			Pixel(buttonPositions[BUTTON_LABEL_UP], GAMEPAD_MASK_DU, *getLEDPositions(BUTTON_LABEL_UP, positions)),
-			Pixel(buttonPositions[BUTTON_LABEL_S1], GAMEPAD_MASK_S1, *getLEDPositions(BUTTON_LABEL_S1, positions)),
-			Pixel(buttonPositions[BUTTON_LABEL_S2], GAMEPAD_MASK_S2, *getLEDPositions(BUTTON_LABEL_S2, positions)),
-			Pixel(buttonPositions[BUTTON_LABEL_L3], GAMEPAD_MASK_L3, *getLEDPositions(BUTTON_LABEL_L3, positions)),
-			Pixel(buttonPositions[BUTTON_LABEL_R3], GAMEPAD_MASK_R3, *getLEDPositions(BUTTON_LABEL_R3, positions)),
-			Pixel(buttonPositions[BUTTON_LABEL_A1], GAMEPAD_MASK_A1, *getLEDPositions(BUTTON_LABEL_A1, positions)),
-			Pixel(buttonPositions[BUTTON_LABEL_A2], GAMEPAD_MASK_A2, *getLEDPositions(BUTTON_LABEL_A2, positions)),
-		},
-	};
-
-	return pixels;
-}
-
-/**
- * @brief Create an LED layout using a 3x8 matrix.
- */
-vector<vector<Pixel>> createLedLayoutArcadeHitbox(vector<vector<uint8_t>> *positions)
-{
-	vector<vector<Pixel>> pixels =
-	{
-		{
-			Pixel(buttonPositions[BUTTON_LABEL_LEFT], GAMEPAD_MASK_DL, *getLEDPositions(BUTTON_LABEL_LEFT, positions)),
-			NO_PIXEL,
-			NO_PIXEL,
-		},
-		{
-			Pixel(buttonPositions[BUTTON_LABEL_DOWN], GAMEPAD_MASK_DD, *getLEDPositions(BUTTON_LABEL_DOWN, positions)),
-			NO_PIXEL,
-			NO_PIXEL,
-		},
-		{
-			Pixel(buttonPositions[BUTTON_LABEL_RIGHT], GAMEPAD_MASK_DR, *getLEDPositions(BUTTON_LABEL_RIGHT, positions)),
-			NO_PIXEL,
-			NO_PIXEL,
-		},
-		{
-			NO_PIXEL,
-			Pixel(buttonPositions[BUTTON_LABEL_UP], GAMEPAD_MASK_DU, *getLEDPositions(BUTTON_LABEL_UP, positions)),
-		},
-		{
-			Pixel(buttonPositions[BUTTON_LABEL_B3], GAMEPAD_MASK_B3, *getLEDPositions(BUTTON_LABEL_B3, positions)),
-			Pixel(buttonPositions[BUTTON_LABEL_B1], GAMEPAD_MASK_B1, *getLEDPositions(BUTTON_LABEL_B1, positions)),
-			NO_PIXEL,
-		},
-		{
-			Pixel(buttonPositions[BUTTON_LABEL_B4], GAMEPAD_MASK_B4, *getLEDPositions(BUTTON_LABEL_B4, positions)),
-			Pixel(buttonPositions[BUTTON_LABEL_B2], GAMEPAD_MASK_B2, *getLEDPositions(BUTTON_LABEL_B2, positions)),
-			NO_PIXEL,
-		},
-		{
-			Pixel(buttonPositions[BUTTON_LABEL_R1], GAMEPAD_MASK_R1, *getLEDPositions(BUTTON_LABEL_R1, positions)),
-			Pixel(buttonPositions[BUTTON_LABEL_R2], GAMEPAD_MASK_R2, *getLEDPositions(BUTTON_LABEL_R2, positions)),
-			NO_PIXEL,
-		},
-		{
-			Pixel(buttonPositions[BUTTON_LABEL_L1], GAMEPAD_MASK_L1, *getLEDPositions(BUTTON_LABEL_L1, positions)),
-			Pixel(buttonPositions[BUTTON_LABEL_L2], GAMEPAD_MASK_L2, *getLEDPositions(BUTTON_LABEL_L2, positions)),
-			NO_PIXEL,
-		},
-		{
-			Pixel(buttonPositions[BUTTON_LABEL_S1], GAMEPAD_MASK_S1, *getLEDPositions(BUTTON_LABEL_S1, positions)),
-			Pixel(buttonPositions[BUTTON_LABEL_S2], GAMEPAD_MASK_S2, *getLEDPositions(BUTTON_LABEL_S2, positions)),
-			Pixel(buttonPositions[BUTTON_LABEL_L3], GAMEPAD_MASK_L3, *getLEDPositions(BUTTON_LABEL_L3, positions)),
-			Pixel(buttonPositions[BUTTON_LABEL_R3], GAMEPAD_MASK_R3, *getLEDPositions(BUTTON_LABEL_R3, positions)),
-			Pixel(buttonPositions[BUTTON_LABEL_A1], GAMEPAD_MASK_A1, *getLEDPositions(BUTTON_LABEL_A1, positions)),
-			Pixel(buttonPositions[BUTTON_LABEL_A2], GAMEPAD_MASK_A2, *getLEDPositions(BUTTON_LABEL_A2, positions)),
-		},
-	};
-
-	return pixels;
-}
-
-/**
- * @brief Create an LED layout using a 2x7 matrix.
- */
-vector<vector<Pixel>> createLedLayoutArcadeWasd(vector<vector<uint8_t>> *positions)
-{
-	vector<vector<Pixel>> pixels =
-	{
-		{
-			NO_PIXEL,
-			Pixel(buttonPositions[BUTTON_LABEL_LEFT], GAMEPAD_MASK_DL, *getLEDPositions(BUTTON_LABEL_LEFT, positions)),
-		},
-		{
-			Pixel(buttonPositions[BUTTON_LABEL_UP], GAMEPAD_MASK_DU, *getLEDPositions(BUTTON_LABEL_UP, positions)),
-			Pixel(buttonPositions[BUTTON_LABEL_DOWN], GAMEPAD_MASK_DD, *getLEDPositions(BUTTON_LABEL_DOWN, positions)),
-		},
-		{
-			NO_PIXEL,
-			Pixel(buttonPositions[BUTTON_LABEL_RIGHT], GAMEPAD_MASK_DR, *getLEDPositions(BUTTON_LABEL_RIGHT, positions)),
-		},
-		{
-			Pixel(buttonPositions[BUTTON_LABEL_B3], GAMEPAD_MASK_B3, *getLEDPositions(BUTTON_LABEL_B3, positions)),
-			Pixel(buttonPositions[BUTTON_LABEL_B1], GAMEPAD_MASK_B1, *getLEDPositions(BUTTON_LABEL_B1, positions)),
-		},
-		{
-			Pixel(buttonPositions[BUTTON_LABEL_B4], GAMEPAD_MASK_B4, *getLEDPositions(BUTTON_LABEL_B4, positions)),
-			Pixel(buttonPositions[BUTTON_LABEL_B2], GAMEPAD_MASK_B2, *getLEDPositions(BUTTON_LABEL_B2, positions)),
-		},
-		{
-			Pixel(buttonPositions[BUTTON_LABEL_R1], GAMEPAD_MASK_R1, *getLEDPositions(BUTTON_LABEL_R1, positions)),
-			Pixel(buttonPositions[BUTTON_LABEL_R2], GAMEPAD_MASK_R2, *getLEDPositions(BUTTON_LABEL_R2, positions)),
-		},
-		{
-			Pixel(buttonPositions[BUTTON_LABEL_L1], GAMEPAD_MASK_L1, *getLEDPositions(BUTTON_LABEL_L1, positions)),
-			Pixel(buttonPositions[BUTTON_LABEL_L2], GAMEPAD_MASK_L2, *getLEDPositions(BUTTON_LABEL_L2, positions)),
-		},
-		{
-			Pixel(buttonPositions[BUTTON_LABEL_S1], GAMEPAD_MASK_S1, *getLEDPositions(BUTTON_LABEL_S1, positions)),
-			Pixel(buttonPositions[BUTTON_LABEL_S2], GAMEPAD_MASK_S2, *getLEDPositions(BUTTON_LABEL_S2, positions)),
-			Pixel(buttonPositions[BUTTON_LABEL_L3], GAMEPAD_MASK_L3, *getLEDPositions(BUTTON_LABEL_L3, positions)),
-			Pixel(buttonPositions[BUTTON_LABEL_R3], GAMEPAD_MASK_R3, *getLEDPositions(BUTTON_LABEL_R3, positions)),
-			Pixel(buttonPositions[BUTTON_LABEL_A1], GAMEPAD_MASK_A1, *getLEDPositions(BUTTON_LABEL_A1, positions)),
-			Pixel(buttonPositions[BUTTON_LABEL_A2], GAMEPAD_MASK_A2, *getLEDPositions(BUTTON_LABEL_A2, positions)),
-		},
-	};
-
-	return pixels;
-}
-
-vector<vector<Pixel>> createLedButtonLayout(ButtonLayout layout, vector<vector<uint8_t>> *positions)
-{
-	switch (layout)
-	{
-		case BUTTON_LAYOUT_ARCADE:
-			return createLedLayoutArcadeButtons(positions);
-
-		case BUTTON_LAYOUT_HITBOX:
-			return createLedLayoutArcadeHitbox(positions);
-
-		case BUTTON_LAYOUT_WASD:
-			return createLedLayoutArcadeWasd(positions);
-	}
-}
-
-vector<vector<Pixel>> createLedButtonLayout(ButtonLayout layout, uint8_t ledsPerPixel, uint8_t ledButtonCount)
-{
-	vector<vector<uint8_t>> positions(ledButtonCount);
-	for (int i = 0; i != ledButtonCount; i++)
-	{
-		positions[i].resize(ledsPerPixel);
-		for (int l = 0; l != ledsPerPixel; l++)
-			positions[i][l] = (i * ledsPerPixel) + l;
-	}
-
-	return createLedButtonLayout(layout, &positions);
-}
-
+queue_t profileSaveQueue;
 uint8_t setupButtonPositions()
 {
 	buttonPositions.clear();
@@ -254,9 +68,30 @@ void LEDModule::configureLEDs()
 	uint8_t buttonCount = setupButtonPositions();
 	vector<vector<Pixel>> pixels = createLedButtonLayout(ledOptions.ledLayout, ledOptions.ledsPerButton, buttonCount);
 	matrix.setup(pixels, ledOptions.ledsPerButton);
-	ledCount = matrix.getLedCount();
-	if (PLED_TYPE == PLED_TYPE_RGB && PLED_COUNT > 0)
-		ledCount += PLED_COUNT;
+
+	// The primary chain comes first in the logical frame, followed by each extra chain in order
+	uint32_t primaryCount = ledOptions.ledCount;
+	if (primaryCount == 0)
+	{
+		primaryCount = matrix.getLedCount();
+		if (PLED_TYPE == PLED_TYPE_RGB && PLED_COUNT > 0)
+			primaryCount += PLED_COUNT;
+	}
+
+	int chainPins[LED_CHAIN_MAX] = { ledOptions.dataPin };
+	uint32_t chainLengths[LED_CHAIN_MAX] = { primaryCount };
+	uint8_t configuredChains = 1;
+	uint32_t totalCount = primaryCount; // Summed wide so oversized chains are rejected instead of wrapping
+	for (int i = 0; i < LED_CHAIN_MAX - 1; i++)
+	{
+		if (ledOptions.chainPins[i] < 0 || ledOptions.chainLengths[i] == 0)
+			continue;
+
+		chainPins[configuredChains] = ledOptions.chainPins[i];
+		chainLengths[configuredChains] = ledOptions.chainLengths[i];
+		totalCount += ledOptions.chainLengths[i];
+		configuredChains++;
+	}
 
 	queue_free(&baseAnimationQueue);
 	queue_free(&buttonAnimationQueue);
@@ -264,14 +99,43 @@ void LEDModule::configureLEDs()
 
 	queue_init(&baseAnimationQueue, sizeof(AnimationHotkey), 1);
 	queue_init(&buttonAnimationQueue, sizeof(uint32_t), 1);
-	queue_init(&animationSaveQueue, sizeof(int), 1);
+	queue_init(&animationSaveQueue, sizeof(AnimationOptions), 1);
+
+	for (int i = 0; i < chainCount; i++)
+	{
+		chains[i]->Off();
+		delete chains[i];
+		chains[i] = nullptr;
+	}
+
+	chainCount = 0;
 
-	if (neopico != NULL)
-		neopico->Off();
+	// Every per-LED buffer is carved from the arena here, the frame loop never allocates
+	ledCount = 0;
+	LEDArena::Reset();
+	if (!fitsArena(totalCount))
+		return;
 
-	delete neopico;
-	neopico = new NeoPico(ledOptions.dataPin, ledCount, ledOptions.ledFormat);
-	neopico->Off();
+	ledCount = totalCount;
+	uint32_t *chainFrame = LEDArena::Allocate<uint32_t>(ledCount);
+	frame = LEDArena::Allocate<uint32_t>(ledCount);
+	if (chainFrame == nullptr || frame == nullptr || !as.Configure(ledCount))
+	{
+		ledCount = 0;
+		return;
+	}
+
+	// Each chain gets its own state machine and DMA channel and reads its slice of the wire buffer
+	uint32_t offset = 0;
+	for (int i = 0; i < configuredChains; i++)
+	{
+		chains[i] = new NeoPico(chainPins[i], chainLengths[i], chainFrame + offset, ledOptions.ledFormat);
+		chains[i]->Off();
+		chainOffsets[i] = offset;
+		offset += chainLengths[i];
+	}
+
+	chainCount = configuredChains;
 
 	Animation::format = ledOptions.ledFormat;
 	AnimationStation::ConfigureBrightness(ledOptions.brightnessMaximum, ledOptions.brightnessSteps);
@@ -279,6 +143,7 @@ void LEDModule::configureLEDs()
 	addStaticThemes(ledOptions);
 	as.SetMode(AnimationStation::options.baseAnimationIndex);
 	as.SetMatrix(matrix);
+	as.Invalidate();
 
 	nextRunTime = make_timeout_time_ms(0); // Reset timeout
 }
@@ -292,6 +157,13 @@ void LEDModule::setup()
 		ledOptions.ledFormat = LED_FORMAT;
 		ledOptions.ledLayout = BUTTON_LAYOUT;
 		ledOptions.ledsPerButton = LEDS_PER_PIXEL;
+		ledOptions.ledCount = LED_COUNT;
+		ledOptions.chainPins[0] = LED_CHAIN1_PIN;
+		ledOptions.chainLengths[0] = LED_CHAIN1_LENGTH;
+		ledOptions.chainPins[1] = LED_CHAIN2_PIN;
+		ledOptions.chainLengths[1] = LED_CHAIN2_LENGTH;
+		ledOptions.chainPins[2] = LED_CHAIN3_PIN;
+		ledOptions.chainLengths[2] = LED_CHAIN3_LENGTH;
 		ledOptions.brightnessMaximum = LED_BRIGHTNESS_MAXIMUM;
 		ledOptions.brightnessSteps = LED_BRIGHTNESS_STEPS;
 		ledOptions.indexUp = LEDS_DPAD_UP;
@@ -318,11 +190,66 @@ void LEDModule::setup()
 	if (enabled)
 	{
 		configureLEDs();
+		setupProfiles();
+	}
+}
+
+// Like the gamepad, the active profile takes the live animation options and unused banks start as a copy of them
+void LEDModule::setupProfiles()
+{
+	queue_init(&profileSaveQueue, sizeof(ProfileAnimationSave), PROFILE_COUNT);
+
+	activeProfile = getActiveProfile();
+	for (uint8_t index = 0; index < PROFILE_COUNT; index++)
+	{
+		if (index == activeProfile || !getProfileAnimationOptions(index, profileAnimations[index]))
+			profileAnimations[index] = AnimationStation::options;
+	}
+}
+
+// Follows the profile chosen on core0, the animation state only ever changes here on core1
+void LEDModule::setProfile(uint8_t index)
+{
+	// The storage cache is only written from core0, so the outgoing bank is handed over to be saved there
+	ProfileAnimationSave save = { activeProfile, AnimationStation::options };
+	profileAnimations[activeProfile] = AnimationStation::options;
+	queue_try_add(&profileSaveQueue, &save);
+
+	activeProfile = index;
+	AnimationStation::SetOptions(profileAnimations[activeProfile]);
+	as.SetMode(AnimationStation::options.baseAnimationIndex);
+	as.Invalidate();
+
+	trySave();
+}
+
+// Called from the core0 loop, stores the banks core1 switched away from and the live animation options
+void LEDModule::saveProfiles()
+{
+	if (!enabled)
+		return;
+
+	ProfileAnimationSave save;
+	bool saved = false;
+	while (queue_try_remove(&profileSaveQueue, &save))
+	{
+		setProfileAnimationOptions(save.index, save.options);
+		saved = true;
 	}
+
+	AnimationOptions options;
+	if (queue_try_remove(&animationSaveQueue, &options))
+		AnimationStore.save(options);
+
+	if (saved)
+		EEPROM.commit();
 }
 
 void LEDModule::process(Gamepad *gamepad)
 {
+	if (gamepad->activeProfile != activeProfile && gamepad->activeProfile < PROFILE_COUNT)
+		setProfile(gamepad->activeProfile);
+
 	AnimationHotkey action = animationHotkeys(gamepad);
 	if (action != HOTKEY_LEDS_NONE)
 		queue_try_add(&baseAnimationQueue, &action);
@@ -333,14 +260,14 @@ void LEDModule::process(Gamepad *gamepad)
 
 void LEDModule::loop()
 {
-	if (ledOptions.dataPin < 0 || !time_reached(this->nextRunTime))
+	if (ledOptions.dataPin < 0 || chainCount == 0 || !time_reached(this->nextRunTime))
 		return;
 
 	AnimationHotkey action;
 	if (queue_try_remove(&baseAnimationQueue, &action))
 	{
 		as.HandleEvent(action);
-		queue_try_add(&animationSaveQueue, 0);
+		trySave();
 	}
 
 	uint32_t buttonState;
@@ -363,25 +290,38 @@ void LEDModule::loop()
 			as.ClearPressed();
 	}
 
-	as.Animate();
-	as.ApplyBrightness(frame);
+	if (as.Animate())
+		as.ApplyBrightness(frame);
 
 	if (PLED_TYPE == PLED_TYPE_RGB)
-		setRGBPLEDs(frame); // PLEDs have their own brightness values, call this after as.ApplyBrightness()
+		setRGBPLEDs(frame, ledCount); // PLEDs have their own brightness values, call this after as.ApplyBrightness()
 
-	neopico->SetFrame(frame);
-	neopico->Show();
+	// Only push a chain's slice of the frame if it actually changed. Show() returns as soon as the
+	// DMA transfer starts, so the chains clock out in parallel.
+	bool shown = false;
+	for (int i = 0; i < chainCount; i++)
+	{
+		if (chains[i]->SetFrame(frame + chainOffsets[i]))
+		{
+			chains[i]->Show();
+			shown = true;
+		}
+	}
+
+	if (shown)
+		framesShown++;
+	else
+		framesSkipped++;
 
 	this->nextRunTime = make_timeout_time_ms(LEDModule::intervalMS);
-	trySave();
 }
 
+// Hands the animation options to core0 to be saved, only the newest ones are kept if core0 hasn't caught up
 void LEDModule::trySave()
 {
-	static int saveValue = 0;
-
-	if (queue_try_remove(&animationSaveQueue, &saveValue))
-		AnimationStore.save();
+	AnimationOptions stale;
+	queue_try_remove(&animationSaveQueue, &stale);
+	queue_try_add(&animationSaveQueue, &AnimationStation::options);
 }
 
 AnimationHotkey animationHotkeys(Gamepad *gamepad)
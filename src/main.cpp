@@ -4,6 +4,7 @@
  */
 
 #define GAMEPAD_DEBOUNCE_MILLIS 5
+#define FLASH_IDLE_MILLIS 500 // Saves are only written to flash once the inputs have been still this long
 
 #include "BoardConfig.h"
 
@@ -21,6 +22,11 @@
 #include "leds.h"
 #include "pleds.h"
 #include "display.h"
+#include "i2c_bus.h"
+#include "FlashPROM.h"
+#include "input_monitor.h"
+#include "config_protocol.h"
+#include "firmware_update.h"
 
 uint32_t getMillis() { return to_ms_since_boot(get_absolute_time()); }
 
@@ -65,6 +71,7 @@ void setup()
 {
 	// Start storage before anything else
 	GamepadStore.start();
+	i2cBus.init();
 	gamepad.setup();
 
 	// Check for input mode override
@@ -112,6 +119,8 @@ void loop()
 	static uint32_t nextRuntime = 0;
 	static uint8_t featureData[32] = { };
 	static Gamepad snapshot;
+	static GamepadState lastState = { };
+	static uint32_t lastInputMS = 0;
 
 	if (getMillis() - nextRuntime < 0)
 		return;
@@ -121,9 +130,12 @@ void loop()
 	gamepad.debounce();
 #endif
 	gamepad.hotkey();
+	gamepad.diagnosticsHotkey();
+	gamepad.profileHotkey();
 	gamepad.process();
 	report = gamepad.getReport();
 	send_report(report, reportSize);
+	configProtocol.process(gamepad);
 
 	memset(featureData, 0, sizeof(featureData));
 	receive_report(featureData);
@@ -138,6 +150,15 @@ void loop()
 		queue_try_add(&gamepadQueue, &snapshot);
 	}
 
+	// Flash writes stall both cores, so they wait until nobody is playing
+	if (memcmp(&lastState, &gamepad.state, sizeof(GamepadState)) != 0)
+	{
+		lastState = gamepad.state;
+		lastInputMS = getMillis();
+	}
+	ledModule.saveProfiles();
+	EEPROM.poll(tud_suspended() || (getMillis() - lastInputMS) >= FLASH_IDLE_MILLIS);
+
 	nextRuntime = getMillis() + intervalMS;
 }
 
@@ -165,6 +186,7 @@ void webserver()
 	static Gamepad snapshot;
 
 	rndis_init();
+	inputMonitor.start();
 	while (1)
 	{
 		gamepad.read();
@@ -172,6 +194,7 @@ void webserver()
 		gamepad.debounce();
 #endif
 		gamepad.hotkey();
+		gamepad.diagnosticsHotkey();
 		gamepad.process();
 
 		if (queue_is_empty(&gamepadQueue))
@@ -180,6 +203,10 @@ void webserver()
 			queue_try_add(&gamepadQueue, &snapshot);
 		}
 
+		inputMonitor.update(gamepad);
 		rndis_task();
+		ledModule.saveProfiles();
+		EEPROM.poll(true);
+		firmwareUpdate.poll();
 	}
 }
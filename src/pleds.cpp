@@ -16,10 +16,10 @@ const int PLED_PINS[] = {PLED1_PIN, PLED2_PIN, PLED3_PIN, PLED4_PIN};
 InputMode inputMode;
 uint32_t rgbPLEDValues[4];
 
-void setRGBPLEDs(uint32_t *frame)
+void setRGBPLEDs(uint32_t *frame, uint16_t ledCount)
 {
 	for (int i = 0; i < PLED_COUNT; i++)
-		if (PLED_PINS[i] > -1)
+		if (PLED_PINS[i] > -1 && PLED_PINS[i] < ledCount)
 			frame[PLED_PINS[i]] = rgbPLEDValues[i];
 }
 
@@ -126,7 +126,7 @@ void RGBPlayerLEDs::display()
 			for (int i = 0; i < PLED_COUNT; i++) {
 				float level = (static_cast<float>(PLED_MAX_LEVEL - ledLevels[i]) / static_cast<float>(PLED_MAX_LEVEL));
 				float brightness = as.GetBrightnessX() * level;
-				rgbPLEDValues[i] = ((RGB)ColorGreen).value(neopico->GetFormat(), brightness);
+				rgbPLEDValues[i] = ((RGB)ColorGreen).value(Animation::format, brightness);
 			}
 			break;
 	}
@@ -4,7 +4,9 @@
  */
 
 #include "BoardConfig.h"
+#include <stddef.h>
 #include <GamepadStorage.h>
+#include "hardware/gpio.h"
 #include "AnimationStorage.hpp"
 #include "AnimationStation/src/Effects/StaticColor.hpp"
 #include "FlashPROM.h"
@@ -18,16 +20,346 @@
 #define IS_TOUCH_32BIT false
 #endif
 
+/* Sections are stored behind a header with their layout version and size, and a CRC of both and the
+payload. The layouts of a section are listed oldest first. A section stored in an older layout, including
+the headerless ones written before sections had a header, is upgraded one version at a time when it is
+read, and written back once on the first boot after a firmware update. */
+
+#define SECTION_MAGIC 0x5347 // "GS"
+
+struct SectionHeader
+{
+	uint16_t magic;
+	uint16_t version;
+	uint16_t size;
+	uint16_t reserved;
+	uint32_t checksum;
+};
+
+// Converts a payload in place from the previous layout to this one, anything past the old size is zeroed
+typedef void (*SectionUpgrade)(uint8_t *data);
+
+// Sanity checks a headerless payload that has no checksum of its own
+typedef bool (*SectionValidate)(const uint8_t *data);
+
+struct SectionLayout
+{
+	uint16_t size;
+	int16_t checksumOffset; // The struct's own checksum field, validates headerless layouts. -1 if there is none.
+	bool headerless;        // Stored before sections had a header
+	SectionUpgrade upgrade; // From the previous layout, nullptr if the payload is unchanged
+	SectionValidate validate; // Only for layouts without a checksum, nullptr to accept anything
+};
+
+struct StorageSection
+{
+	uint16_t index;
+	uint16_t capacity;
+	const SectionLayout *layouts;
+	uint8_t layoutCount; // The last layout is the current one
+};
+
+// LEDOptions before the primary chain length and the extra chains were added
+struct LEDOptionsV0
+{
+	bool useUserDefinedLEDs;
+	int dataPin;
+	LEDFormat ledFormat;
+	ButtonLayout ledLayout;
+	uint8_t ledsPerButton;
+	uint8_t brightnessMaximum;
+	uint8_t brightnessSteps;
+	int indexes[PROFILE_PIN_COUNT];
+};
+
+static_assert(sizeof(LEDOptionsV0) == offsetof(LEDOptions, ledCount), "Unexpected LEDOptions layout");
+
+static bool isValidPin(int pin)
+{
+	return pin >= -1 && pin < NUM_BANK0_GPIOS;
+}
+
+// Erased or unrelated flash must not be taken for LED settings, and the pins would be handed to the PIO
+static bool validateLEDOptionsV0(const uint8_t *data)
+{
+	LEDOptionsV0 options;
+	memcpy(&options, data, sizeof(LEDOptionsV0));
+
+	uint8_t useUserDefinedLEDs = data[offsetof(LEDOptionsV0, useUserDefinedLEDs)];
+	if (useUserDefinedLEDs > 1 || !isValidPin(options.dataPin) || (unsigned)options.ledLayout > BUTTON_LAYOUT_WASD)
+		return false;
+
+	for (int i = 0; i < PROFILE_PIN_COUNT; i++)
+	{
+		if (options.indexes[i] < -1 || options.indexes[i] > 0xFF)
+			return false;
+	}
+
+	return true;
+}
+
+static void upgradeLEDOptionsV1(uint8_t *data)
+{
+	LEDOptions options;
+	memset(&options, 0, sizeof(LEDOptions));
+	memcpy(&options, data, sizeof(LEDOptionsV0));
+
+	options.ledCount = LED_COUNT;
+	for (int i = 0; i < LED_CHAIN_MAX - 1; i++)
+	{
+		options.chainPins[i] = -1;
+		options.chainLengths[i] = 0;
+	}
+
+	memcpy(data, &options, sizeof(LEDOptions));
+}
+
+/* The active bank and every profile bank. A bank keeps its own checksum, as banks are only written once
+they are used. */
+struct ProfileBanks
+{
+	uint8_t active;
+	ProfileOptions banks[PROFILE_COUNT];
+};
+
+struct ProfileAnimations
+{
+	AnimationOptions banks[PROFILE_COUNT];
+};
+
+static_assert(offsetof(ProfileBanks, banks) == sizeof(uint32_t), "Unexpected ProfileBanks layout");
+
+template <typename T>
+static uint32_t sectionChecksum(T &options)
+{
+	options.checksum = 0;
+	return CRC32::checksum(&options, sizeof(T));
+}
+
+// Copied bytewise, so the padding covered by the checksum comes along
+template <typename T>
+static bool hasValidBank(const T &bank)
+{
+	T options;
+	memcpy(&options, &bank, sizeof(T));
+	uint32_t lastCRC = options.checksum;
+	return sectionChecksum(options) == lastCRC;
+}
+
+// The headerless banks only count once one of them was written, so erased flash is not taken for them
+static bool validateProfileBanksV0(const uint8_t *data)
+{
+	ProfileBanks profiles;
+	memcpy(&profiles, data, sizeof(ProfileBanks));
+	if (profiles.active >= PROFILE_COUNT)
+		return false;
+
+	for (auto &bank : profiles.banks)
+	{
+		if (hasValidBank(bank))
+			return true;
+	}
+
+	return false;
+}
+
+static bool validateProfileAnimationsV0(const uint8_t *data)
+{
+	ProfileAnimations animations;
+	memcpy(&animations, data, sizeof(ProfileAnimations));
+
+	for (auto &bank : animations.banks)
+	{
+		if (hasValidBank(bank))
+			return true;
+	}
+
+	return false;
+}
+
+static const SectionLayout gamepadLayouts[] =
+{
+	{ sizeof(GamepadOptions), offsetof(GamepadOptions, checksum), true, nullptr, nullptr },
+	{ sizeof(GamepadOptions), offsetof(GamepadOptions, checksum), false, nullptr, nullptr },
+};
+
+/* isTouch32Bit landed in padding, so BoardOptions from before it was added can't be told apart from the
+current headerless layout. Further changes get a new layout here, with an upgrade from the one before. */
+static const SectionLayout boardLayouts[] =
+{
+	{ sizeof(BoardOptions), offsetof(BoardOptions, checksum), true, nullptr, nullptr },
+	{ sizeof(BoardOptions), offsetof(BoardOptions, checksum), false, nullptr, nullptr },
+};
+
+static const SectionLayout ledLayouts[] =
+{
+	{ sizeof(LEDOptionsV0), -1, true, nullptr, validateLEDOptionsV0 },
+	{ sizeof(LEDOptions), -1, false, upgradeLEDOptionsV1, nullptr },
+};
+
+static const SectionLayout animationLayouts[] =
+{
+	{ sizeof(AnimationOptions), offsetof(AnimationOptions, checksum), true, nullptr, nullptr },
+	{ sizeof(AnimationOptions), offsetof(AnimationOptions, checksum), false, nullptr, nullptr },
+};
+
+static const SectionLayout profileLayouts[] =
+{
+	{ sizeof(ProfileBanks), -1, true, nullptr, validateProfileBanksV0 },
+	{ sizeof(ProfileBanks), -1, false, nullptr, nullptr },
+};
+
+static const SectionLayout profileAnimationLayouts[] =
+{
+	{ sizeof(ProfileAnimations), -1, true, nullptr, validateProfileAnimationsV0 },
+	{ sizeof(ProfileAnimations), -1, false, nullptr, nullptr },
+};
+
+#define SECTION_LAYOUTS(layouts) layouts, (sizeof(layouts) / sizeof(SectionLayout))
+
+static const StorageSection gamepadSection   = { GAMEPAD_STORAGE_INDEX,   1024, SECTION_LAYOUTS(gamepadLayouts) };
+static const StorageSection boardSection     = { BOARD_STORAGE_INDEX,      512, SECTION_LAYOUTS(boardLayouts) };
+static const StorageSection ledSection       = { LED_STORAGE_INDEX,        512, SECTION_LAYOUTS(ledLayouts) };
+static const StorageSection animationSection = { ANIMATION_STORAGE_INDEX,  512, SECTION_LAYOUTS(animationLayouts) };
+static const StorageSection profileSection   = { PROFILE_STORAGE_INDEX,    256, SECTION_LAYOUTS(profileLayouts) };
+static const StorageSection profileLEDSection = { PROFILE_LED_STORAGE_INDEX, 256, SECTION_LAYOUTS(profileAnimationLayouts) };
+
+// Sections are only loaded at boot and after a cache miss, all on core0 before core1 starts
+static uint8_t sectionData[512];
+
+static uint32_t headerChecksum(SectionHeader header, const uint8_t *data)
+{
+	header.checksum = 0;
+	return CRC32::checksum(data, header.size, CRC32::checksum(&header, sizeof(SectionHeader)));
+}
+
+static bool hasValidChecksum(const SectionLayout &layout, uint8_t *data)
+{
+	if (layout.checksumOffset < 0)
+		return layout.validate == nullptr || layout.validate(data); // No checksum, so the fields themselves have to make sense
+
+	uint32_t lastCRC;
+	memcpy(&lastCRC, &data[layout.checksumOffset], sizeof(uint32_t));
+	memset(&data[layout.checksumOffset], 0, sizeof(uint32_t));
+	return CRC32::checksum(data, layout.size) == lastCRC;
+}
+
+/* Reads a section into sectionData in its current layout. Returns the version it was stored in, or -1
+if nothing valid was found. */
+static int loadSection(const StorageSection &section)
+{
+	const int current = section.layoutCount - 1;
+	int version = -1;
+	SectionHeader header;
+
+	memset(sectionData, 0, sizeof(sectionData));
+	EEPROM.get(section.index, header);
+	const bool tagged = (header.magic == SECTION_MAGIC);
+	if (tagged
+		&& header.version <= current
+		&& !section.layouts[header.version].headerless
+		&& header.size == section.layouts[header.version].size
+		&& header.size + sizeof(SectionHeader) <= section.capacity)
+	{
+		EEPROM.get(section.index + sizeof(SectionHeader), sectionData, header.size);
+		if (headerChecksum(header, sectionData) == header.checksum)
+			version = header.version;
+	}
+
+	// Newest first, an older layout is only tried when the newer ones don't check out
+	for (int i = current; version < 0 && i >= 0; i--)
+	{
+		// A tagged section that fails its CRC must not be taken for a layout that can't be checked
+		if (!section.layouts[i].headerless || (tagged && section.layouts[i].checksumOffset < 0))
+			continue;
+
+		memset(sectionData, 0, sizeof(sectionData));
+		EEPROM.get(section.index, sectionData, section.layouts[i].size);
+		if (hasValidChecksum(section.layouts[i], sectionData))
+			version = i;
+	}
+
+	if (version < 0)
+		return -1;
+
+	for (int i = version + 1; i <= current; i++)
+	{
+		if (section.layouts[i].upgrade != nullptr)
+			section.layouts[i].upgrade(sectionData);
+	}
+
+	if (section.layouts[current].checksumOffset >= 0)
+		memset(&sectionData[section.layouts[current].checksumOffset], 0, sizeof(uint32_t));
+
+	return version;
+}
+
+static void saveSection(const StorageSection &section, const void *data)
+{
+	SectionHeader header;
+	header.magic = SECTION_MAGIC;
+	header.version = section.layoutCount - 1;
+	header.size = section.layouts[header.version].size;
+	header.reserved = 0;
+	header.checksum = headerChecksum(header, static_cast<const uint8_t *>(data));
+
+	EEPROM.set(section.index, header);
+	EEPROM.set(section.index + sizeof(SectionHeader), data, header.size);
+}
+
+template <typename T>
+static bool readSection(const StorageSection &section, T &options)
+{
+	memset(&options, 0, sizeof(T));
+	if (loadSection(section) < 0)
+		return false;
+
+	memcpy(&options, sectionData, sizeof(T));
+	return true;
+}
+
+// Rewrites every section stored in an older layout in the current one, then commits once
+static void migrateSections()
+{
+	const StorageSection *sections[] = { &gamepadSection, &boardSection, &ledSection, &animationSection, &profileSection, &profileLEDSection };
+	bool migrated = false;
+
+	for (auto section : sections)
+	{
+		int version = loadSection(*section);
+		if (version >= 0 && version != section->layoutCount - 1)
+		{
+			saveSection(*section, sectionData);
+			migrated = true;
+		}
+	}
+
+	if (migrated)
+		EEPROM.commit();
+}
+
+/* Each section is validated once and then served from RAM, until it is set again */
+
+static BoardOptions boardOptions;
+static GamepadOptions gamepadOptions;
+static AnimationOptions animationOptions;
+static bool hasBoardOptions = false;
+static bool hasGamepadOptions = false;
+static bool hasAnimationOptions = false;
+static ProfileBanks profileBanks;
+static ProfileAnimations profileAnimations;
+static bool hasProfileBanks = false;
+static bool hasProfileAnimations = false;
+
 /* Board stuffs */
 
 BoardOptions getBoardOptions()
 {
-	BoardOptions options;
-	EEPROM.get(BOARD_STORAGE_INDEX, options);
+	if (hasBoardOptions)
+		return boardOptions;
 
-	uint32_t lastCRC = options.checksum;
-	options.checksum = 0;
-	if (CRC32::calculate(&options) != lastCRC)
+	BoardOptions options;
+	if (!readSection(boardSection, options))
 	{
 		options.hasBoardOptions   = false;
 		options.pinDpadUp         = PIN_DPAD_UP;
@@ -61,28 +393,115 @@ BoardOptions getBoardOptions()
 		options.displayInvert     = DISPLAY_INVERT;
 	}
 
+	boardOptions = options;
+	hasBoardOptions = true;
 	return options;
 }
 
 void setBoardOptions(BoardOptions options)
 {
 	options.checksum = 0;
-	options.checksum = CRC32::calculate(&options);
-	EEPROM.set(BOARD_STORAGE_INDEX, options);
+	saveSection(boardSection, &options);
+
+	boardOptions = options;
+	hasBoardOptions = true;
 }
 
 /* LED stuffs */
 
+// Nothing stored means useUserDefinedLEDs is false, and the LED module falls back to BoardConfig.h
 LEDOptions getLEDOptions()
 {
 	LEDOptions options;
-	EEPROM.get(LED_STORAGE_INDEX, options);
+	readSection(ledSection, options);
 	return options;
 }
 
 void setLEDOptions(LEDOptions options)
 {
-	EEPROM.set(LED_STORAGE_INDEX, options);
+	saveSection(ledSection, &options);
+}
+
+/* Profile stuffs */
+
+static_assert(sizeof(SectionHeader) + sizeof(ProfileBanks) <= 256, "Too many profile banks");
+static_assert(sizeof(SectionHeader) + sizeof(ProfileAnimations) <= 256, "Too many profile banks");
+
+// Nothing stored leaves every bank unwritten with the first one active
+static ProfileBanks &getProfileBanks()
+{
+	if (!hasProfileBanks)
+	{
+		readSection(profileSection, profileBanks);
+		hasProfileBanks = true;
+	}
+
+	return profileBanks;
+}
+
+static ProfileAnimations &getProfileAnimations()
+{
+	if (!hasProfileAnimations)
+	{
+		readSection(profileLEDSection, profileAnimations);
+		hasProfileAnimations = true;
+	}
+
+	return profileAnimations;
+}
+
+uint8_t getActiveProfile()
+{
+	uint8_t index = getProfileBanks().active;
+	return (index < PROFILE_COUNT) ? index : 0;
+}
+
+void setActiveProfile(uint8_t index)
+{
+	ProfileBanks &profiles = getProfileBanks();
+	profiles.active = index;
+	saveSection(profileSection, &profiles);
+}
+
+// Returns false if the bank was never written, the caller decides what it starts out as
+bool getProfileOptions(uint8_t index, ProfileOptions &options)
+{
+	if (index >= PROFILE_COUNT)
+		return false;
+
+	memcpy(&options, &getProfileBanks().banks[index], sizeof(ProfileOptions));
+	return hasValidBank(options);
+}
+
+void setProfileOptions(uint8_t index, ProfileOptions options)
+{
+	if (index >= PROFILE_COUNT)
+		return;
+
+	ProfileBanks &profiles = getProfileBanks();
+	options.checksum = sectionChecksum(options);
+	memcpy(&profiles.banks[index], &options, sizeof(ProfileOptions));
+	saveSection(profileSection, &profiles);
+}
+
+bool getProfileAnimationOptions(uint8_t index, AnimationOptions &options)
+{
+	if (index >= PROFILE_COUNT)
+		return false;
+
+	memcpy(&options, &getProfileAnimations().banks[index], sizeof(AnimationOptions));
+	return hasValidBank(options);
+}
+
+void setProfileAnimationOptions(uint8_t index, AnimationOptions options)
+{
+	if (index >= PROFILE_COUNT)
+		return;
+
+	ProfileAnimations &animations = getProfileAnimations();
+	options.checksum = sectionChecksum(options);
+	memcpy(&animations.banks[index], &options, sizeof(AnimationOptions));
+	saveSection(profileLEDSection, &animations);
 }
 
 /* Gamepad stuffs */
@@ -90,6 +509,7 @@ void setLEDOptions(LEDOptions options)
 void GamepadStorage::start()
 {
 	EEPROM.start();
+	migrateSections();
 }
 
 void GamepadStorage::save()
@@ -99,12 +519,11 @@ void GamepadStorage::save()
 
 GamepadOptions GamepadStorage::getGamepadOptions()
 {
-	GamepadOptions options;
-	EEPROM.get(GAMEPAD_STORAGE_INDEX, options);
+	if (hasGamepadOptions)
+		return gamepadOptions;
 
-	uint32_t lastCRC = options.checksum;
-	options.checksum = 0;
-	if (CRC32::calculate(&options) != lastCRC)
+	GamepadOptions options;
+	if (!readSection(gamepadSection, options))
 	{
 		options.inputMode = InputMode::INPUT_MODE_XINPUT;
 		options.dpadMode = DpadMode::DPAD_MODE_DIGITAL;
@@ -115,26 +534,29 @@ GamepadOptions GamepadStorage::getGamepadOptions()
 #endif
 	}
 
+	gamepadOptions = options;
+	hasGamepadOptions = true;
 	return options;
 }
 
 void GamepadStorage::setGamepadOptions(GamepadOptions options)
 {
 	options.checksum = 0;
-	options.checksum = CRC32::calculate(&options);
-	EEPROM.set(GAMEPAD_STORAGE_INDEX, options);
+	saveSection(gamepadSection, &options);
+
+	gamepadOptions = options;
+	hasGamepadOptions = true;
 }
 
 /* Animation stuffs */
 
 AnimationOptions AnimationStorage::getAnimationOptions()
 {
-	AnimationOptions options;
-	EEPROM.get(ANIMATION_STORAGE_INDEX, options);
+	if (hasAnimationOptions)
+		return animationOptions;
 
-	uint32_t lastCRC = options.checksum;
-	options.checksum = 0;
-	if (CRC32::calculate(&options) != lastCRC)
+	AnimationOptions options;
+	if (!readSection(animationSection, options))
 	{
 		options.baseAnimationIndex = LEDS_BASE_ANIMATION_INDEX;
 		options.brightness         = LEDS_BRIGHTNESS;
@@ -147,24 +569,28 @@ AnimationOptions AnimationStorage::getAnimationOptions()
 		setAnimationOptions(options);
 	}
 
+	animationOptions = options;
+	hasAnimationOptions = true;
 	return options;
 }
 
 void AnimationStorage::setAnimationOptions(AnimationOptions options)
 {
 	options.checksum = 0;
-	options.checksum = CRC32::calculate(&options);
-	EEPROM.set(ANIMATION_STORAGE_INDEX, options);
+	saveSection(animationSection, &options);
+
+	animationOptions = options;
+	hasAnimationOptions = true;
 }
 
-void AnimationStorage::save()
+void AnimationStorage::save(AnimationOptions options)
 {
 	bool dirty = false;
 	AnimationOptions savedOptions = getAnimationOptions();
 
-	if (memcmp(&savedOptions, &AnimationStation::options, sizeof(AnimationOptions)))
+	if (memcmp(&savedOptions, &options, sizeof(AnimationOptions)))
 	{
-		this->setAnimationOptions(AnimationStation::options);
+		this->setAnimationOptions(options);
 		dirty = true;
 	}
 
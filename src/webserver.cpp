@@ -4,10 +4,8 @@
  */
 
 #include <stdio.h>
-#include <vector>
-#include <map>
-#include <string>
 #include <string.h>
+#include <algorithm>
 
 #include <ArduinoJson.h>
 #include "pico/stdlib.h"
@@ -19,12 +17,15 @@
 #include "httpd/httpd.h"
 #include "lwip/def.h"
 #include "lwip/mem.h"
+#include "lwip/memp.h"
+#include "lwip/stats.h"
 #include "rndis/rndis.h"
 
 #include "gamepad.h"
 #include "storage.h"
 #include "leds.h"
 #include "GamepadStorage.h"
+#include "firmware_update.h"
 
 #define PATH_CGI_ACTION "/cgi/action"
 
@@ -37,121 +38,379 @@
 #define API_SET_LED_OPTIONS "/api/setLedOptions"
 #define API_GET_PIN_MAPPINGS "/api/getPinMappings"
 #define API_SET_PIN_MAPPINGS "/api/setPinMappings"
+#define API_GET_CONFIG "/api/getConfig"
+#define API_SET_CONFIG "/api/setConfig"
+#define API_GET_STATS "/api/getStats"
+#define API_FIRMWARE "/api/firmware"
+#define API_APPLY_FIRMWARE "/api/applyFirmware"
 
-#define LWIP_HTTPD_POST_MAX_URI_LEN 128
-#define LWIP_HTTPD_POST_MAX_PAYLOAD_LEN 2048
+#define WEB_CONFIG_VERSION 1 // Bump when a field of getConfig changes meaning
+
+// Limits for settings that are only range checked here, the rest follow from their enums and the LED arena
+#define CONFIG_I2C_SPEED_MIN        10000   // SMBus low end
+#define CONFIG_I2C_SPEED_MAX        1000000 // Fast-mode Plus, the most the RP2040's I2C blocks do
+#define CONFIG_BRIGHTNESS_STEPS_MAX 10      // Same as the web configurator
 
-using namespace std;
+#define LWIP_HTTPD_POST_MAX_PAYLOAD_LEN 2048
+#define LWIP_HTTPD_RESPONSE_MAX_LEN 2048
+#define LWIP_HTTPD_RESPONSE_HEADER_LEN 128
+#define LWIP_HTTPD_JSON_DOCUMENT_SIZE 3072 // Fits a full setConfig document
 
 extern struct fsdata_file file__index_html[];
 extern Gamepad gamepad;
 
-const static vector<string> spaPaths = { "/display-config", "/led-config", "/pin-mapping", "/settings", "/reset-settings" };
-const static vector<string> excludePaths = { "/css", "/images", "/js", "/static" };
-static char *http_post_uri;
+struct WebRoute;
+
+/* The body of one POST at a time is kept, owned by post_connection until its response has been opened or
+the connection is gone. A POST arriving on another connection meanwhile is answered with 503. */
+static void *post_connection = nullptr;
+static const WebRoute *post_route = nullptr;
+static bool post_response_pending = false; // Set by httpd_post_finished, fs_open_custom follows right away
+static bool post_busy_pending = false;     // Set when httpd_post_begin turns a POST away
+static int post_content_left = 0;
 static char http_post_payload[LWIP_HTTPD_POST_MAX_PAYLOAD_LEN];
 static uint16_t http_post_payload_len = 0;
-static bool is_post = false;
+static bool is_firmware_upload = false; // The body is streamed to flash instead of http_post_payload
+
+// One request is handled at a time, so every request shares the same document and response buffer
+static StaticJsonDocument<LWIP_HTTPD_JSON_DOCUMENT_SIZE> json_document;
+static char http_response[LWIP_HTTPD_RESPONSE_HEADER_LEN + LWIP_HTTPD_RESPONSE_MAX_LEN];
+static char *http_response_body = http_response + LWIP_HTTPD_RESPONSE_HEADER_LEN;
+static size_t json_document_peak = 0; // Most of the shared document any request has used
 
 /*************************
  * Helper methods
  *************************/
 
-DynamicJsonDocument get_post_data()
+// Parses the POST body in place, strings in the document point into http_post_payload
+JsonDocument &get_post_data()
 {
-	vector<char> raw;
-	for (int i = 0; i < http_post_payload_len; i++)
-		raw.push_back(http_post_payload[i]);
+	json_document.clear();
+	deserializeJson(json_document, http_post_payload, http_post_payload_len);
+	if (json_document.memoryUsage() > json_document_peak)
+		json_document_peak = json_document.memoryUsage();
+
+	return json_document;
+}
 
-	DynamicJsonDocument doc(LWIP_HTTPD_POST_MAX_PAYLOAD_LEN);
-	deserializeJson(doc, raw);
-	return doc;
+JsonDocument &get_json_document()
+{
+	json_document.clear();
+	return json_document;
 }
 
-inline string serialize_json(DynamicJsonDocument &doc)
+inline size_t serialize_json(JsonDocument &doc)
 {
-	string data;
-	serializeJson(doc, data);
-	return data;
+	if (doc.memoryUsage() > json_document_peak)
+		json_document_peak = doc.memoryUsage();
+
+	return serializeJson(doc, http_response_body, LWIP_HTTPD_RESPONSE_MAX_LEN);
 }
 
-int set_file_data(struct fs_file *file, string data)
+// Answers a set request that was rejected, nothing of it has been applied
+inline size_t serialize_error(JsonDocument &doc, const char *error)
 {
-	static string returnData;
+	doc.clear();
+	doc["success"] = false;
+	doc["error"] = error;
 
-	returnData = data;
-	file->data = returnData.c_str();
-	file->len = returnData.size();
+	return serialize_json(doc);
+}
+
+/* Writes the header just in front of the body. The Content-Length lets the connection be kept alive,
+without it the client can only find the end of the response when the connection closes. */
+int set_file_data(struct fs_file *file, size_t size, const char *status = "200 OK")
+{
+	char header[LWIP_HTTPD_RESPONSE_HEADER_LEN];
+	int headerLen = snprintf(header, sizeof(header),
+		"HTTP/1.1 %s\r\n"
+		"Content-Type: application/json\r\n"
+		"Content-Length: %u\r\n"
+		"Cache-Control: no-store\r\n"
+		"\r\n",
+		status, (unsigned int)size);
+
+	char *start = http_response_body - headerLen;
+	memcpy(start, header, headerLen);
+
+	file->data = start;
+	file->len = headerLen + size;
 	file->index = file->len;
-	file->http_header_included = 0;
+	file->http_header_included = FS_FILE_FLAGS_HEADER_INCLUDED | FS_FILE_FLAGS_HEADER_PERSISTENT | FS_FILE_FLAGS_HEADER_HTTPVER_1_1;
 	file->pextension = NULL;
 
 	return 1;
 }
 
+/*************************
+ * Config sections
+ *************************/
+
+// Shared by the per-page endpoints and the bulk config, so both always agree on the format
+
+static const char *pinNames[PROFILE_PIN_COUNT] =
+{
+	"Up", "Down", "Left", "Right",
+	"B1", "B2", "B3", "B4",
+	"L1", "R1", "L2", "R2",
+	"S1", "S2", "L3", "R3",
+	"A1", "A2",
+};
+
+static uint8_t *boardPins(BoardOptions &options, int index)
+{
+	uint8_t *pins[PROFILE_PIN_COUNT] =
+	{
+		&options.pinDpadUp,   &options.pinDpadDown, &options.pinDpadLeft, &options.pinDpadRight,
+		&options.pinButtonB1, &options.pinButtonB2, &options.pinButtonB3, &options.pinButtonB4,
+		&options.pinButtonL1, &options.pinButtonR1, &options.pinButtonL2, &options.pinButtonR2,
+		&options.pinButtonS1, &options.pinButtonS2, &options.pinButtonL3, &options.pinButtonR3,
+		&options.pinButtonA1, &options.pinButtonA2,
+	};
+
+	return pins[index];
+}
+
+static int *ledIndexes(LEDOptions &options, int index)
+{
+	int *indexes[PROFILE_PIN_COUNT] =
+	{
+		&options.indexUp, &options.indexDown, &options.indexLeft, &options.indexRight,
+		&options.indexB1, &options.indexB2,   &options.indexB3,   &options.indexB4,
+		&options.indexL1, &options.indexR1,   &options.indexL2,   &options.indexR2,
+		&options.indexS1, &options.indexS2,   &options.indexL3,   &options.indexR3,
+		&options.indexA1, &options.indexA2,
+	};
+
+	return indexes[index];
+}
+
+static void writeDisplayOptions(JsonObject obj, const BoardOptions &options)
+{
+	obj["enabled"]       = options.hasI2CDisplay ? 1 : 0;
+	obj["sdaPin"]        = options.i2cSDAPin;
+	obj["sclPin"]        = options.i2cSCLPin;
+	obj["i2cAddress"]    = options.displayI2CAddress;
+	obj["i2cBlock"]      = options.i2cBlock;
+	obj["i2cSpeed"]      = options.i2cSpeed;
+	obj["flipDisplay"]   = options.displayFlip ? 1 : 0;
+	obj["invertDisplay"] = options.displayInvert ? 1 : 0;
+}
+
+static void readDisplayOptions(JsonObjectConst obj, BoardOptions &options)
+{
+	options.hasI2CDisplay     = obj["enabled"];
+	options.i2cSDAPin         = obj["sdaPin"];
+	options.i2cSCLPin         = obj["sclPin"];
+	options.displayI2CAddress = obj["i2cAddress"];
+	options.i2cBlock          = obj["i2cBlock"];
+	options.i2cSpeed          = obj["i2cSpeed"];
+	options.displayFlip       = obj["flipDisplay"];
+	options.displayInvert     = obj["invertDisplay"];
+}
+
+static void writeGamepadOptions(JsonObject obj, const GamepadOptions &options)
+{
+	obj["dpadMode"]  = options.dpadMode;
+	obj["inputMode"] = options.inputMode;
+	obj["socdMode"]  = options.socdMode;
+}
+
+static void readGamepadOptions(JsonObjectConst obj, GamepadOptions &options)
+{
+	options.dpadMode  = obj["dpadMode"];
+	options.inputMode = obj["inputMode"];
+	options.socdMode  = obj["socdMode"];
+}
+
+static void writeLedOptions(JsonObject obj, LEDOptions &options)
+{
+	obj["dataPin"]       = options.dataPin;
+	obj["ledFormat"]     = options.ledFormat;
+	obj["ledLayout"]     = options.ledLayout;
+	obj["ledsPerButton"] = options.ledsPerButton;
+	obj["ledCount"]      = options.ledCount;
+
+	auto chains = obj.createNestedArray("chains");
+	for (int i = 0; i < LED_CHAIN_MAX - 1; i++)
+	{
+		auto chain = chains.createNestedObject();
+		chain["pin"]    = options.chainPins[i];
+		chain["length"] = options.chainLengths[i];
+	}
+	obj["brightnessMaximum"] = options.brightnessMaximum;
+	obj["brightnessSteps"]   = options.brightnessSteps;
+
+	auto ledButtonMap = obj.createNestedObject("ledButtonMap");
+	for (int i = 0; i < PROFILE_PIN_COUNT; i++)
+	{
+		int index = *ledIndexes(options, i);
+		if (index == -1) ledButtonMap[pinNames[i]] = nullptr; else ledButtonMap[pinNames[i]] = index;
+	}
+}
+
+static void readLedOptions(JsonObjectConst obj, LEDOptions &options)
+{
+	options.useUserDefinedLEDs = true;
+	options.dataPin            = obj["dataPin"];
+	options.ledFormat          = obj["ledFormat"];
+	options.ledLayout          = obj["ledLayout"];
+	options.ledsPerButton      = obj["ledsPerButton"];
+	options.ledCount           = obj["ledCount"];
+	for (int i = 0; i < LED_CHAIN_MAX - 1; i++)
+	{
+		options.chainPins[i]    = obj["chains"][i]["pin"] | -1;
+		options.chainLengths[i] = obj["chains"][i]["length"] | 0;
+	}
+	options.brightnessMaximum  = obj["brightnessMaximum"];
+	options.brightnessSteps    = obj["brightnessSteps"];
+	for (int i = 0; i < PROFILE_PIN_COUNT; i++)
+	{
+		JsonVariantConst index = obj["ledButtonMap"][pinNames[i]];
+		*ledIndexes(options, i) = index.isNull() ? -1 : index.as<int>();
+	}
+}
+
+static void writePinMappings(JsonObject obj)
+{
+	for (int i = 0; i < PROFILE_PIN_COUNT; i++)
+		obj[pinNames[i]] = gamepad.gamepadMappings[i]->pin;
+}
+
+static void readPinMappings(JsonObjectConst obj, BoardOptions &options)
+{
+	options.hasBoardOptions = true;
+	for (int i = 0; i < PROFILE_PIN_COUNT; i++)
+		*boardPins(options, i) = obj[pinNames[i]];
+}
+
+static void applyPinMappings(BoardOptions &options)
+{
+	for (int i = 0; i < PROFILE_PIN_COUNT; i++)
+		gamepad.gamepadMappings[i]->setPin(*boardPins(options, i));
+}
+
+static void addUsedPins(JsonArray usedPins)
+{
+	for (int i = 0; i < PROFILE_PIN_COUNT; i++)
+		usedPins.add(gamepad.gamepadMappings[i]->pin);
+}
+
+static inline bool isValidPin(int pin, bool optional)
+{
+	return (optional && pin == -1) || (pin >= 0 && pin < NUM_BANK0_GPIOS);
+}
+
+// Claims a pin for one function, returns false when something else already has it
+static bool claimPin(uint32_t &claimedPins, int pin)
+{
+	if (pin == -1)
+		return true;
+	if (claimedPins & (1 << pin))
+		return false;
+
+	claimedPins |= (1 << pin);
+	return true;
+}
+
+/* Checks the configuration as a whole before anything is applied, including pins claimed by more than one
+section. Returns the reason it was rejected, or nullptr if it can be applied. */
+static const char *validateConfig(BoardOptions &boardOptions, const GamepadOptions &gamepadOptions, LEDOptions &ledOptions)
+{
+	uint32_t claimedPins = 0;
+
+	for (int i = 0; i < PROFILE_PIN_COUNT; i++)
+	{
+		int pin = *boardPins(boardOptions, i);
+		if (!isValidPin(pin, false))
+			return "Invalid pin mapping";
+		if (!claimPin(claimedPins, pin))
+			return "Pin mapped more than once";
+	}
+
+	if (gamepadOptions.dpadMode > DPAD_MODE_RIGHT_ANALOG || gamepadOptions.socdMode > SOCD_MODE_SECOND_INPUT_PRIORITY)
+		return "Invalid gamepad mode";
+	if (gamepadOptions.inputMode != INPUT_MODE_XINPUT && gamepadOptions.inputMode != INPUT_MODE_SWITCH && gamepadOptions.inputMode != INPUT_MODE_HID)
+		return "Invalid input mode";
+
+	if (boardOptions.i2cSpeed < CONFIG_I2C_SPEED_MIN || boardOptions.i2cSpeed > CONFIG_I2C_SPEED_MAX)
+		return "Invalid I2C speed";
+
+	if (boardOptions.hasI2CDisplay)
+	{
+		if (!isValidPin(boardOptions.i2cSDAPin, false) || !isValidPin(boardOptions.i2cSCLPin, false))
+			return "Invalid display pin";
+		if (boardOptions.i2cBlock < 0 || boardOptions.i2cBlock > 1 || boardOptions.displayI2CAddress < 0 || boardOptions.displayI2CAddress > 0x7F)
+			return "Invalid display I2C settings";
+		if (!claimPin(claimedPins, boardOptions.i2cSDAPin) || !claimPin(claimedPins, boardOptions.i2cSCLPin))
+			return "Display pin already in use";
+	}
+
+	if (!isValidPin(ledOptions.dataPin, true) || ledOptions.ledFormat > LED_FORMAT_RGBW || ledOptions.ledLayout > BUTTON_LAYOUT_WASD)
+		return "Invalid LED options";
+	if (!claimPin(claimedPins, ledOptions.dataPin))
+		return "LED pin already in use";
+	if (ledOptions.ledsPerButton == 0 || ledOptions.brightnessSteps == 0 || ledOptions.brightnessSteps > CONFIG_BRIGHTNESS_STEPS_MAX)
+		return "Invalid LED options";
+
+	// A primary chain sized from the layout is counted as if every input had a button, configureLEDs() checks the exact count
+	uint32_t ledCount = (ledOptions.ledCount > 0) ? ledOptions.ledCount : (uint32_t)PROFILE_PIN_COUNT * ledOptions.ledsPerButton;
+	for (int i = 0; i < LED_CHAIN_MAX - 1; i++)
+	{
+		if (!isValidPin(ledOptions.chainPins[i], true))
+			return "Invalid LED chain pin";
+		if (!claimPin(claimedPins, ledOptions.chainPins[i]))
+			return "LED chain pin already in use";
+		if (ledOptions.chainPins[i] >= 0)
+			ledCount += ledOptions.chainLengths[i];
+	}
+
+	if (!LEDModule::fitsArena(ledCount))
+		return "Too many LEDs";
+
+	for (int i = 0; i < PROFILE_PIN_COUNT; i++)
+	{
+		if (*ledIndexes(ledOptions, i) < -1)
+			return "Invalid LED button map";
+	}
+
+	return nullptr;
+}
+
 /*************************
  * API methods
  *************************/
 
-string resetSettings()
+size_t resetSettings()
 {
 	EEPROM.reset();
 	watchdog_reboot(0, SRAM_END, 2000);
-	DynamicJsonDocument doc(LWIP_HTTPD_POST_MAX_PAYLOAD_LEN);
+	JsonDocument &doc = get_json_document();
 	doc["success"] = true;
 	return serialize_json(doc);
 }
 
-string getDisplayOptions()
+size_t getDisplayOptions()
 {
-	DynamicJsonDocument doc(LWIP_HTTPD_POST_MAX_PAYLOAD_LEN);
+	JsonDocument &doc = get_json_document();
 
-	BoardOptions options = getBoardOptions();
-	doc["enabled"]       = options.hasI2CDisplay ? 1 : 0;
-	doc["sdaPin"]        = options.i2cSDAPin;
-	doc["sclPin"]        = options.i2cSCLPin;
-	doc["i2cAddress"]    = options.displayI2CAddress;
-	doc["i2cBlock"]      = options.i2cBlock;
-	doc["i2cSpeed"]      = options.i2cSpeed;
-	doc["flipDisplay"]   = options.displayFlip ? 1 : 0;
-	doc["invertDisplay"] = options.displayInvert ? 1 : 0;
-
-	auto usedPins = doc.createNestedArray("usedPins");
-	usedPins.add(gamepad.mapDpadUp->pin);
-	usedPins.add(gamepad.mapDpadDown->pin);
-	usedPins.add(gamepad.mapDpadLeft->pin);
-	usedPins.add(gamepad.mapDpadRight->pin);
-	usedPins.add(gamepad.mapButtonB1->pin);
-	usedPins.add(gamepad.mapButtonB2->pin);
-	usedPins.add(gamepad.mapButtonB3->pin);
-	usedPins.add(gamepad.mapButtonB4->pin);
-	usedPins.add(gamepad.mapButtonL1->pin);
-	usedPins.add(gamepad.mapButtonR1->pin);
-	usedPins.add(gamepad.mapButtonL2->pin);
-	usedPins.add(gamepad.mapButtonR2->pin);
-	usedPins.add(gamepad.mapButtonS1->pin);
-	usedPins.add(gamepad.mapButtonS2->pin);
-	usedPins.add(gamepad.mapButtonL3->pin);
-	usedPins.add(gamepad.mapButtonR3->pin);
-	usedPins.add(gamepad.mapButtonA1->pin);
-	usedPins.add(gamepad.mapButtonA2->pin);
+	writeDisplayOptions(doc.to<JsonObject>(), getBoardOptions());
+	addUsedPins(doc.createNestedArray("usedPins"));
 
 	return serialize_json(doc);
 }
 
-string setDisplayOptions()
+size_t setDisplayOptions()
 {
-	DynamicJsonDocument doc = get_post_data();
+	JsonDocument &doc = get_post_data();
 
 	BoardOptions options = getBoardOptions();
-	options.hasI2CDisplay     = doc["enabled"];
-	options.i2cSDAPin         = doc["sdaPin"];
-	options.i2cSCLPin         = doc["sclPin"];
-	options.displayI2CAddress = doc["i2cAddress"];
-	options.i2cBlock          = doc["i2cBlock"];
-	options.i2cSpeed          = doc["i2cSpeed"];
-	options.displayFlip       = doc["flipDisplay"];
-	options.displayInvert     = doc["invertDisplay"];
+	LEDOptions ledOptions = ledModule.ledOptions;
+	readDisplayOptions(doc.as<JsonObject>(), options);
+
+	const char *error = validateConfig(options, gamepad.options, ledOptions);
+	if (error != nullptr)
+		return serialize_error(doc, error);
 
 	setBoardOptions(options);
 	GamepadStore.save();
@@ -159,81 +418,33 @@ string setDisplayOptions()
 	return serialize_json(doc);
 }
 
-string getGamepadOptions()
+size_t getGamepadOptions()
 {
-	DynamicJsonDocument doc(LWIP_HTTPD_POST_MAX_PAYLOAD_LEN);
+	JsonDocument &doc = get_json_document();
 
-	GamepadOptions options = GamepadStore.getGamepadOptions();
-	doc["dpadMode"]  = options.dpadMode;
-	doc["inputMode"] = options.inputMode;
-	doc["socdMode"]  = options.socdMode;
+	writeGamepadOptions(doc.to<JsonObject>(), GamepadStore.getGamepadOptions());
 
 	return serialize_json(doc);
 }
 
-string setGamepadOptions()
+size_t setGamepadOptions()
 {
-	DynamicJsonDocument doc = get_post_data();
+	JsonDocument &doc = get_post_data();
 
-	gamepad.options.dpadMode  = doc["dpadMode"];
-	gamepad.options.inputMode = doc["inputMode"];
-	gamepad.options.socdMode  = doc["socdMode"];
+	readGamepadOptions(doc.as<JsonObject>(), gamepad.options);
 	gamepad.save();
 
 	return serialize_json(doc);
 }
 
-string getLedOptions()
-{
-	DynamicJsonDocument doc(LWIP_HTTPD_POST_MAX_PAYLOAD_LEN);
-
-	doc["dataPin"]           = ledModule.ledOptions.dataPin;
-	doc["ledFormat"]         = ledModule.ledOptions.ledFormat;
-	doc["ledLayout"]         = ledModule.ledOptions.ledLayout;
-	doc["ledsPerButton"]     = ledModule.ledOptions.ledsPerButton;
-	doc["brightnessMaximum"] = ledModule.ledOptions.brightnessMaximum;
-	doc["brightnessSteps"]   = ledModule.ledOptions.brightnessSteps;
-
-	auto ledButtonMap = doc.createNestedObject("ledButtonMap");
-
-	if (ledModule.ledOptions.indexUp == -1)    ledButtonMap["Up"]    = nullptr;  else ledButtonMap["Up"]    = ledModule.ledOptions.indexUp;
-	if (ledModule.ledOptions.indexDown == -1)  ledButtonMap["Down"]  = nullptr;  else ledButtonMap["Down"]  = ledModule.ledOptions.indexDown;
-	if (ledModule.ledOptions.indexLeft == -1)  ledButtonMap["Left"]  = nullptr;  else ledButtonMap["Left"]  = ledModule.ledOptions.indexLeft;
-	if (ledModule.ledOptions.indexRight == -1) ledButtonMap["Right"] = nullptr;  else ledButtonMap["Right"] = ledModule.ledOptions.indexRight;
-	if (ledModule.ledOptions.indexB1 == -1)    ledButtonMap["B1"]    = nullptr;  else ledButtonMap["B1"]    = ledModule.ledOptions.indexB1;
-	if (ledModule.ledOptions.indexB2 == -1)    ledButtonMap["B2"]    = nullptr;  else ledButtonMap["B2"]    = ledModule.ledOptions.indexB2;
-	if (ledModule.ledOptions.indexB3 == -1)    ledButtonMap["B3"]    = nullptr;  else ledButtonMap["B3"]    = ledModule.ledOptions.indexB3;
-	if (ledModule.ledOptions.indexB4 == -1)    ledButtonMap["B4"]    = nullptr;  else ledButtonMap["B4"]    = ledModule.ledOptions.indexB4;
-	if (ledModule.ledOptions.indexL1 == -1)    ledButtonMap["L1"]    = nullptr;  else ledButtonMap["L1"]    = ledModule.ledOptions.indexL1;
-	if (ledModule.ledOptions.indexR1 == -1)    ledButtonMap["R1"]    = nullptr;  else ledButtonMap["R1"]    = ledModule.ledOptions.indexR1;
-	if (ledModule.ledOptions.indexL2 == -1)    ledButtonMap["L2"]    = nullptr;  else ledButtonMap["L2"]    = ledModule.ledOptions.indexL2;
-	if (ledModule.ledOptions.indexR2 == -1)    ledButtonMap["R2"]    = nullptr;  else ledButtonMap["R2"]    = ledModule.ledOptions.indexR2;
-	if (ledModule.ledOptions.indexS1 == -1)    ledButtonMap["S1"]    = nullptr;  else ledButtonMap["S1"]    = ledModule.ledOptions.indexS1;
-	if (ledModule.ledOptions.indexS2 == -1)    ledButtonMap["S2"]    = nullptr;  else ledButtonMap["S2"]    = ledModule.ledOptions.indexS2;
-	if (ledModule.ledOptions.indexL3 == -1)    ledButtonMap["L3"]    = nullptr;  else ledButtonMap["L3"]    = ledModule.ledOptions.indexL3;
-	if (ledModule.ledOptions.indexR3 == -1)    ledButtonMap["R3"]    = nullptr;  else ledButtonMap["R3"]    = ledModule.ledOptions.indexR3;
-	if (ledModule.ledOptions.indexA1 == -1)    ledButtonMap["A1"]    = nullptr;  else ledButtonMap["A1"]    = ledModule.ledOptions.indexA1;
-	if (ledModule.ledOptions.indexA2 == -1)    ledButtonMap["A2"]    = nullptr;  else ledButtonMap["A2"]    = ledModule.ledOptions.indexA2;
+size_t getLedOptions()
+{
+	JsonDocument &doc = get_json_document();
+
+	writeLedOptions(doc.to<JsonObject>(), ledModule.ledOptions);
 
 	auto usedPins = doc.createNestedArray("usedPins");
-	usedPins.add(gamepad.mapDpadUp->pin);
-	usedPins.add(gamepad.mapDpadDown->pin);
-	usedPins.add(gamepad.mapDpadLeft->pin);
-	usedPins.add(gamepad.mapDpadRight->pin);
-	usedPins.add(gamepad.mapButtonB1->pin);
-	usedPins.add(gamepad.mapButtonB2->pin);
-	usedPins.add(gamepad.mapButtonB3->pin);
-	usedPins.add(gamepad.mapButtonB4->pin);
-	usedPins.add(gamepad.mapButtonL1->pin);
-	usedPins.add(gamepad.mapButtonR1->pin);
-	usedPins.add(gamepad.mapButtonL2->pin);
-	usedPins.add(gamepad.mapButtonR2->pin);
-	usedPins.add(gamepad.mapButtonS1->pin);
-	usedPins.add(gamepad.mapButtonS2->pin);
-	usedPins.add(gamepad.mapButtonL3->pin);
-	usedPins.add(gamepad.mapButtonR3->pin);
-	usedPins.add(gamepad.mapButtonA1->pin);
-	usedPins.add(gamepad.mapButtonA2->pin);
+	addUsedPins(usedPins);
 
 	BoardOptions boardOptions = getBoardOptions();
 	if (boardOptions.i2cSDAPin != -1)
@@ -244,36 +455,19 @@ string getLedOptions()
 	return serialize_json(doc);
 }
 
-string setLedOptions()
-{
-	DynamicJsonDocument doc = get_post_data();
-
-	ledModule.ledOptions.useUserDefinedLEDs = true;
-	ledModule.ledOptions.dataPin            = doc["dataPin"];
-	ledModule.ledOptions.ledFormat          = doc["ledFormat"];
-	ledModule.ledOptions.ledLayout          = doc["ledLayout"];
-	ledModule.ledOptions.ledsPerButton      = doc["ledsPerButton"];
-	ledModule.ledOptions.brightnessMaximum  = doc["brightnessMaximum"];
-	ledModule.ledOptions.brightnessSteps    = doc["brightnessSteps"];
-	ledModule.ledOptions.indexUp            = (doc["ledButtonMap"]["Up"]    == nullptr) ? -1 : doc["ledButtonMap"]["Up"];
-	ledModule.ledOptions.indexDown          = (doc["ledButtonMap"]["Down"]  == nullptr) ? -1 : doc["ledButtonMap"]["Down"];
-	ledModule.ledOptions.indexLeft          = (doc["ledButtonMap"]["Left"]  == nullptr) ? -1 : doc["ledButtonMap"]["Left"];
-	ledModule.ledOptions.indexRight         = (doc["ledButtonMap"]["Right"] == nullptr) ? -1 : doc["ledButtonMap"]["Right"];
-	ledModule.ledOptions.indexB1            = (doc["ledButtonMap"]["B1"]    == nullptr) ? -1 : doc["ledButtonMap"]["B1"];
-	ledModule.ledOptions.indexB2            = (doc["ledButtonMap"]["B2"]    == nullptr) ? -1 : doc["ledButtonMap"]["B2"];
-	ledModule.ledOptions.indexB3            = (doc["ledButtonMap"]["B3"]    == nullptr) ? -1 : doc["ledButtonMap"]["B3"];
-	ledModule.ledOptions.indexB4            = (doc["ledButtonMap"]["B4"]    == nullptr) ? -1 : doc["ledButtonMap"]["B4"];
-	ledModule.ledOptions.indexL1            = (doc["ledButtonMap"]["L1"]    == nullptr) ? -1 : doc["ledButtonMap"]["L1"];
-	ledModule.ledOptions.indexR1            = (doc["ledButtonMap"]["R1"]    == nullptr) ? -1 : doc["ledButtonMap"]["R1"];
-	ledModule.ledOptions.indexL2            = (doc["ledButtonMap"]["L2"]    == nullptr) ? -1 : doc["ledButtonMap"]["L2"];
-	ledModule.ledOptions.indexR2            = (doc["ledButtonMap"]["R2"]    == nullptr) ? -1 : doc["ledButtonMap"]["R2"];
-	ledModule.ledOptions.indexS1            = (doc["ledButtonMap"]["S1"]    == nullptr) ? -1 : doc["ledButtonMap"]["S1"];
-	ledModule.ledOptions.indexS2            = (doc["ledButtonMap"]["S2"]    == nullptr) ? -1 : doc["ledButtonMap"]["S2"];
-	ledModule.ledOptions.indexL3            = (doc["ledButtonMap"]["L3"]    == nullptr) ? -1 : doc["ledButtonMap"]["L3"];
-	ledModule.ledOptions.indexR3            = (doc["ledButtonMap"]["R3"]    == nullptr) ? -1 : doc["ledButtonMap"]["R3"];
-	ledModule.ledOptions.indexA1            = (doc["ledButtonMap"]["A1"]    == nullptr) ? -1 : doc["ledButtonMap"]["A1"];
-	ledModule.ledOptions.indexA2            = (doc["ledButtonMap"]["A2"]    == nullptr) ? -1 : doc["ledButtonMap"]["A2"];
+size_t setLedOptions()
+{
+	JsonDocument &doc = get_post_data();
 
+	BoardOptions boardOptions = getBoardOptions();
+	LEDOptions ledOptions = ledModule.ledOptions;
+	readLedOptions(doc.as<JsonObject>(), ledOptions);
+
+	const char *error = validateConfig(boardOptions, gamepad.options, ledOptions);
+	if (error != nullptr)
+		return serialize_error(doc, error);
+
+	ledModule.ledOptions = ledOptions;
 	setLEDOptions(ledModule.ledOptions);
 	GamepadStore.save();
 	ledModule.configureLEDs();
@@ -281,86 +475,264 @@ string setLedOptions()
 	return serialize_json(doc);
 }
 
-string getPinMappings()
-{
-	DynamicJsonDocument doc(LWIP_HTTPD_POST_MAX_PAYLOAD_LEN);
-
-	doc["Up"]    = gamepad.mapDpadUp->pin;
-	doc["Down"]  = gamepad.mapDpadDown->pin;
-	doc["Left"]  = gamepad.mapDpadLeft->pin;
-	doc["Right"] = gamepad.mapDpadRight->pin;
-	doc["B1"]    = gamepad.mapButtonB1->pin;
-	doc["B2"]    = gamepad.mapButtonB2->pin;
-	doc["B3"]    = gamepad.mapButtonB3->pin;
-	doc["B4"]    = gamepad.mapButtonB4->pin;
-	doc["L1"]    = gamepad.mapButtonL1->pin;
-	doc["R1"]    = gamepad.mapButtonR1->pin;
-	doc["L2"]    = gamepad.mapButtonL2->pin;
-	doc["R2"]    = gamepad.mapButtonR2->pin;
-	doc["S1"]    = gamepad.mapButtonS1->pin;
-	doc["S2"]    = gamepad.mapButtonS2->pin;
-	doc["L3"]    = gamepad.mapButtonL3->pin;
-	doc["R3"]    = gamepad.mapButtonR3->pin;
-	doc["A1"]    = gamepad.mapButtonA1->pin;
-	doc["A2"]    = gamepad.mapButtonA2->pin;
+size_t getPinMappings()
+{
+	JsonDocument &doc = get_json_document();
+
+	writePinMappings(doc.to<JsonObject>());
 
 	return serialize_json(doc);
 }
 
-string setPinMappings()
+size_t setPinMappings()
 {
-	DynamicJsonDocument doc = get_post_data();
+	JsonDocument &doc = get_post_data();
 
-	BoardOptions options;
-	options.hasBoardOptions = true;
-	options.pinDpadUp    = doc["Up"];
-	options.pinDpadDown  = doc["Down"];
-	options.pinDpadLeft  = doc["Left"];
-	options.pinDpadRight = doc["Right"];
-	options.pinButtonB1  = doc["B1"];
-	options.pinButtonB2  = doc["B2"];
-	options.pinButtonB3  = doc["B3"];
-	options.pinButtonB4  = doc["B4"];
-	options.pinButtonL1  = doc["L1"];
-	options.pinButtonR1  = doc["R1"];
-	options.pinButtonL2  = doc["L2"];
-	options.pinButtonR2  = doc["R2"];
-	options.pinButtonS1  = doc["S1"];
-	options.pinButtonS2  = doc["S2"];
-	options.pinButtonL3  = doc["L3"];
-	options.pinButtonR3  = doc["R3"];
-	options.pinButtonA1  = doc["A1"];
-	options.pinButtonA2  = doc["A2"];
+	BoardOptions options = getBoardOptions();
+	readPinMappings(doc.as<JsonObject>(), options);
 
 	setBoardOptions(options);
 	GamepadStore.save();
+	applyPinMappings(options);
+
+	return serialize_json(doc);
+}
 
-	gamepad.mapDpadUp->setPin(options.pinDpadUp);
-	gamepad.mapDpadDown->setPin(options.pinDpadDown);
-	gamepad.mapDpadLeft->setPin(options.pinDpadLeft);
-	gamepad.mapDpadRight->setPin(options.pinDpadRight);
-	gamepad.mapButtonB1->setPin(options.pinButtonB1);
-	gamepad.mapButtonB2->setPin(options.pinButtonB2);
-	gamepad.mapButtonB3->setPin(options.pinButtonB3);
-	gamepad.mapButtonB4->setPin(options.pinButtonB4);
-	gamepad.mapButtonL1->setPin(options.pinButtonL1);
-	gamepad.mapButtonR1->setPin(options.pinButtonR1);
-	gamepad.mapButtonL2->setPin(options.pinButtonL2);
-	gamepad.mapButtonR2->setPin(options.pinButtonR2);
-	gamepad.mapButtonS1->setPin(options.pinButtonS1);
-	gamepad.mapButtonS2->setPin(options.pinButtonS2);
-	gamepad.mapButtonL3->setPin(options.pinButtonL3);
-	gamepad.mapButtonR3->setPin(options.pinButtonR3);
-	gamepad.mapButtonA1->setPin(options.pinButtonA1);
-	gamepad.mapButtonA2->setPin(options.pinButtonA2);
+// The whole configuration in one document, in the same format as the per-page endpoints
+size_t getConfig()
+{
+	JsonDocument &doc = get_json_document();
+
+	BoardOptions boardOptions = getBoardOptions();
+	doc["version"] = WEB_CONFIG_VERSION;
+	writeDisplayOptions(doc.createNestedObject("display"), boardOptions);
+	writeGamepadOptions(doc.createNestedObject("gamepad"), gamepad.options);
+	writeLedOptions(doc.createNestedObject("led"), ledModule.ledOptions);
+	writePinMappings(doc.createNestedObject("pins"));
+
+	return serialize_json(doc);
+}
+
+/* Takes a document from getConfig. Every section has to be present and the result is validated as a whole,
+so nothing is changed unless everything can be. All sections go out in one flash commit, and the commit is
+only replayed at boot if it was written completely. */
+size_t setConfig()
+{
+	JsonDocument &doc = get_post_data();
+	const char *error = nullptr;
+
+	BoardOptions boardOptions = getBoardOptions();
+	GamepadOptions gamepadOptions = gamepad.options;
+	LEDOptions ledOptions = ledModule.ledOptions;
+
+	if (doc["version"] != WEB_CONFIG_VERSION)
+		error = "Unsupported config version";
+	else if (!doc["display"].is<JsonObject>() || !doc["gamepad"].is<JsonObject>() || !doc["led"].is<JsonObject>() || !doc["pins"].is<JsonObject>())
+		error = "Missing config section";
+
+	if (error == nullptr)
+	{
+		readDisplayOptions(doc["display"].as<JsonObject>(), boardOptions);
+		readGamepadOptions(doc["gamepad"].as<JsonObject>(), gamepadOptions);
+		readLedOptions(doc["led"].as<JsonObject>(), ledOptions);
+		readPinMappings(doc["pins"].as<JsonObject>(), boardOptions);
+		error = validateConfig(boardOptions, gamepadOptions, ledOptions);
+	}
+
+	if (error == nullptr)
+	{
+		gamepad.options.dpadMode  = gamepadOptions.dpadMode;
+		gamepad.options.inputMode = gamepadOptions.inputMode;
+		gamepad.options.socdMode  = gamepadOptions.socdMode;
+		ledModule.ledOptions = ledOptions;
+
+		setBoardOptions(boardOptions);
+		GamepadStore.setGamepadOptions(gamepad.options);
+		setLEDOptions(ledOptions);
+		GamepadStore.save();
+
+		applyPinMappings(boardOptions);
+		ledModule.configureLEDs();
+	}
+
+	if (error != nullptr)
+		return serialize_error(doc, error);
+
+	doc.clear();
+	doc["success"] = true;
+	return serialize_json(doc);
+}
+
+// Ends a firmware upload, the body has already been staged by httpd_post_receive_data
+size_t uploadFirmware()
+{
+	JsonDocument &doc = get_json_document();
+
+	bool success = firmwareUpdate.finish();
+	doc["success"] = success;
+	if (success)
+	{
+		doc["size"] = firmwareUpdate.size;
+		doc["crc"]  = firmwareUpdate.crc;
+	}
+	else
+	{
+		doc["error"] = firmwareUpdate.error ? firmwareUpdate.error : "No firmware uploaded";
+	}
+
+	return serialize_json(doc);
+}
+
+// Takes the CRC the client expects for the uploaded image, the device resets into it shortly after a match
+size_t applyFirmware()
+{
+	JsonDocument &doc = get_post_data();
+
+	uint32_t crc = doc["crc"] | 0u;
+	bool success = firmwareUpdate.apply(crc);
+
+	doc.clear();
+	doc["success"] = success;
+	if (!success)
+		doc["error"] = "CRC does not match the staged firmware";
+
+	return serialize_json(doc);
+}
+
+// Memory high-water marks, link and LED frame counters, for checking the webserver under load
+size_t getStats()
+{
+	JsonDocument &doc = get_json_document();
+
+	auto heap = doc.createNestedObject("heap");
+	heap["size"]   = MEM_SIZE;
+	heap["used"]   = lwip_stats.mem.used;
+	heap["peak"]   = lwip_stats.mem.max;
+	heap["errors"] = lwip_stats.mem.err;
+
+	auto pools = doc.createNestedObject("pools");
+	pools["tcpPcb"]   = lwip_stats.memp[MEMP_TCP_PCB]->max;
+	pools["tcpSeg"]   = lwip_stats.memp[MEMP_TCP_SEG]->max;
+	pools["pbuf"]     = lwip_stats.memp[MEMP_PBUF]->max;
+	pools["pbufPool"] = lwip_stats.memp[MEMP_PBUF_POOL]->max;
+
+	auto json = doc.createNestedObject("json");
+	json["size"] = LWIP_HTTPD_JSON_DOCUMENT_SIZE;
+	json["peak"] = json_document_peak;
+
+	const struct rndis_stats *rndisStats = rndis_get_stats();
+	auto link = doc.createNestedObject("link");
+	link["rxFrames"]    = rndisStats->rx_frames;
+	link["rxDropped"]   = rndisStats->rx_dropped;
+	link["txFrames"]    = rndisStats->tx_frames;
+	link["rxQueuePeak"] = rndisStats->rx_queue_peak;
+	link["txQueuePeak"] = rndisStats->tx_queue_peak;
+
+	auto leds = doc.createNestedObject("leds");
+	leds["framesShown"]   = ledModule.framesShown;
+	leds["framesSkipped"] = ledModule.framesSkipped;
+
+	doc["flashStallPeakUS"] = FlashPROM::maxStallUS;
 
 	return serialize_json(doc);
 }
 
+/*************************
+ * Routes
+ *************************/
+
+typedef enum
+{
+	ROUTE_GET,    // API call answered from a handler
+	ROUTE_POST,   // API call with a JSON body, answered from a handler
+	ROUTE_SPA,    // Page of the React app, served as index.html
+	ROUTE_STATIC, // Left to the files in fsdata
+} WebRouteType;
+
+struct WebRoute
+{
+	const char *path;
+	WebRouteType type;
+	size_t (*handler)();
+};
+
+/* Every path the server knows besides the files in fsdata, found with a binary search. Keep the table
+sorted by path, the static_assert below fails the build otherwise. */
+static constexpr WebRoute webRoutes[] =
+{
+	{ API_APPLY_FIRMWARE,      ROUTE_POST,   applyFirmware },
+	{ API_FIRMWARE,            ROUTE_POST,   uploadFirmware },
+	{ API_GET_CONFIG,          ROUTE_GET,    getConfig },
+	{ API_GET_DISPLAY_OPTIONS, ROUTE_GET,    getDisplayOptions },
+	{ API_GET_GAMEPAD_OPTIONS, ROUTE_GET,    getGamepadOptions },
+	{ API_GET_LED_OPTIONS,     ROUTE_GET,    getLedOptions },
+	{ API_GET_PIN_MAPPINGS,    ROUTE_GET,    getPinMappings },
+	{ API_GET_STATS,           ROUTE_GET,    getStats },
+	{ API_RESET_SETTINGS,      ROUTE_GET,    resetSettings },
+	{ API_SET_CONFIG,          ROUTE_POST,   setConfig },
+	{ API_SET_DISPLAY_OPTIONS, ROUTE_POST,   setDisplayOptions },
+	{ API_SET_GAMEPAD_OPTIONS, ROUTE_POST,   setGamepadOptions },
+	{ API_SET_LED_OPTIONS,     ROUTE_POST,   setLedOptions },
+	{ API_SET_PIN_MAPPINGS,    ROUTE_POST,   setPinMappings },
+	{ "/css",                  ROUTE_STATIC, nullptr },
+	{ "/display-config",       ROUTE_SPA,    nullptr },
+	{ "/images",               ROUTE_STATIC, nullptr },
+	{ "/js",                   ROUTE_STATIC, nullptr },
+	{ "/led-config",           ROUTE_SPA,    nullptr },
+	{ "/pin-mapping",          ROUTE_SPA,    nullptr },
+	{ "/reset-settings",       ROUTE_SPA,    nullptr },
+	{ "/settings",             ROUTE_SPA,    nullptr },
+	{ "/static",               ROUTE_STATIC, nullptr },
+};
+
+#define WEB_ROUTE_COUNT (sizeof(webRoutes) / sizeof(webRoutes[0]))
+
+static constexpr int comparePaths(const char *a, const char *b)
+{
+	return (*a != *b || *a == '\0') ? (*a - *b) : comparePaths(a + 1, b + 1);
+}
+
+static constexpr bool routesSorted(size_t index)
+{
+	return (index + 1 >= WEB_ROUTE_COUNT)
+		|| (comparePaths(webRoutes[index].path, webRoutes[index + 1].path) < 0 && routesSorted(index + 1));
+}
+
+static_assert(routesSorted(0), "webRoutes must be sorted by path");
+
+static const WebRoute *findRoute(const char *path)
+{
+	const WebRoute *end = webRoutes + WEB_ROUTE_COUNT;
+	const WebRoute *route = std::lower_bound(webRoutes, end, path,
+		[](const WebRoute &route, const char *path) { return strcmp(route.path, path) < 0; });
+
+	return (route != end && !strcmp(route->path, path)) ? route : nullptr;
+}
+
 /*************************
  * LWIP implementation
  *************************/
 
+// Answers a POST that arrived while another connection's POST still owns the buffers
+size_t postBusy()
+{
+	JsonDocument &doc = get_json_document();
+
+	doc["success"] = false;
+	doc["error"] = "Busy with another request, try again";
+
+	return serialize_json(doc);
+}
+
+// Releases the POST buffers, including for a connection that closed before its body was complete
+static void end_post()
+{
+	post_connection = nullptr;
+	post_route = nullptr;
+	post_response_pending = false;
+	is_firmware_upload = false;
+}
+
 // LWIP callback on HTTP POST to validate the URI
 err_t httpd_post_begin(void *connection, const char *uri, const char *http_request,
                        uint16_t http_request_len, int content_len, char *response_uri,
@@ -368,102 +740,133 @@ err_t httpd_post_begin(void *connection, const char *uri, const char *http_reque
 {
 	LWIP_UNUSED_ARG(http_request);
 	LWIP_UNUSED_ARG(http_request_len);
-	LWIP_UNUSED_ARG(content_len);
-	LWIP_UNUSED_ARG(response_uri);
-	LWIP_UNUSED_ARG(response_uri_len);
 	LWIP_UNUSED_ARG(post_auto_wnd);
 
-	if (!uri || (uri[0] == '\0') || memcmp(uri, "/api", 4))
+	const WebRoute *route = (uri != nullptr) ? findRoute(uri) : nullptr;
+	if (route == nullptr || route->type != ROUTE_POST)
 		return ERR_ARG;
 
-	http_post_uri = (char *)uri;
-	is_post = true;
+	// lwIP opens response_uri straight after an error, fs_open_custom answers it with the 503
+	if (post_connection != nullptr && post_connection != connection)
+	{
+		strncpy(response_uri, uri, response_uri_len - 1);
+		response_uri[response_uri_len - 1] = '\0';
+		post_busy_pending = true;
+		return ERR_USE;
+	}
+
+	post_connection = connection;
+	post_route = route;
+	post_response_pending = false;
+	post_content_left = content_len;
+	http_post_payload_len = 0;
+
+	is_firmware_upload = !strcmp(uri, API_FIRMWARE);
+	if (is_firmware_upload)
+		firmwareUpdate.begin(content_len);
+
 	return ERR_OK;
 }
 
 // LWIP callback on HTTP POST to for receiving payload
 err_t httpd_post_receive_data(void *connection, struct pbuf *p)
 {
-	LWIP_UNUSED_ARG(connection);
+	struct pbuf *q = p;
+	bool full = false;
 
-	int count;
-	uint32_t http_post_payload_full_flag = 0;
+	if (connection != post_connection)
+	{
+		pbuf_free(p);
+		return ERR_ARG;
+	}
 
-	// Cache the received data to http_post_payload
-	http_post_payload_len = 0;
-	memset(http_post_payload, 0, LWIP_HTTPD_POST_MAX_PAYLOAD_LEN);
-	while (p != NULL)
+	post_content_left -= p->tot_len;
+
+	// Each piece is programmed as it arrives, an image never fits in RAM. Errors are reported once the upload ends.
+	if (is_firmware_upload)
 	{
-		if (http_post_payload_len + p->len <= LWIP_HTTPD_POST_MAX_PAYLOAD_LEN)
-		{
-			MEMCPY(http_post_payload + http_post_payload_len, p->payload, p->len);
-			http_post_payload_len += p->len;
-		}
-		else // Buffer overflow Set overflow flag
+		for (; q != NULL; q = q->next)
+			firmwareUpdate.write((const uint8_t *)q->payload, q->len);
+
+		pbuf_free(p);
+		return ERR_OK;
+	}
+
+	// A body can arrive over several calls, each one appends its pbuf chain
+	while (q != NULL)
+	{
+		if (http_post_payload_len + q->len > LWIP_HTTPD_POST_MAX_PAYLOAD_LEN)
 		{
-			http_post_payload_full_flag = 1;
+			full = true;
 			break;
 		}
 
-		p = p->next;
+		MEMCPY(http_post_payload + http_post_payload_len, q->payload, q->len);
+		http_post_payload_len += q->len;
+		q = q->next;
 	}
 
 	// Need to release memory here or will leak
 	pbuf_free(p);
 
 	// If the buffer overflows, error out
-	if (http_post_payload_full_flag)
+	if (full)
+	{
+		post_content_left = 0;
+		http_post_payload_len = 0; // The handler sees an empty body and reports it
 		return ERR_BUF;
+	}
 
 	return ERR_OK;
 }
 
-// LWIP callback to set the HTTP POST response_uri, which can then be looked up via the fs_custom callbacks
+/* LWIP callback to set the HTTP POST response_uri, which can then be looked up via the fs_custom callbacks.
+lwIP also calls this when the connection closes with part of the body still missing, then no file is
+opened for it and the buffers are released here. */
 void httpd_post_finished(void *connection, char *response_uri, uint16_t response_uri_len)
 {
-	LWIP_UNUSED_ARG(connection);
-	LWIP_UNUSED_ARG(response_uri);
-	LWIP_UNUSED_ARG(response_uri_len);
+	response_uri[0] = '\0';
+	if (connection != post_connection)
+		return;
 
-	response_uri = http_post_uri;
+	if (post_content_left > 0)
+	{
+		end_post();
+		return;
+	}
+
+	strncpy(response_uri, post_route->path, response_uri_len - 1);
+	response_uri[response_uri_len - 1] = '\0';
+	post_response_pending = true;
 }
 
+/* lwIP opens the response of a POST right after httpd_post_begin turned it away or httpd_post_finished,
+on the same connection, so a pending flag can only belong to the call that follows it. */
 int fs_open_custom(struct fs_file *file, const char *name)
 {
-	if (is_post)
+	if (post_busy_pending)
 	{
-		if (!memcmp(http_post_uri, API_SET_DISPLAY_OPTIONS, sizeof(API_SET_DISPLAY_OPTIONS)))
-			return set_file_data(file, setDisplayOptions());
-		if (!memcmp(http_post_uri, API_SET_GAMEPAD_OPTIONS, sizeof(API_SET_GAMEPAD_OPTIONS)))
-			return set_file_data(file, setGamepadOptions());
-		if (!memcmp(http_post_uri, API_SET_LED_OPTIONS, sizeof(API_SET_LED_OPTIONS)))
-			return set_file_data(file, setLedOptions());
-		if (!memcmp(http_post_uri, API_SET_PIN_MAPPINGS, sizeof(API_SET_PIN_MAPPINGS)))
-			return set_file_data(file, setPinMappings());
+		post_busy_pending = false;
+		return set_file_data(file, postBusy(), "503 Service Unavailable");
 	}
-	else
+
+	if (post_response_pending)
 	{
-		if (!memcmp(name, API_GET_DISPLAY_OPTIONS, sizeof(API_GET_DISPLAY_OPTIONS)))
-			return set_file_data(file, getDisplayOptions());
-		if (!memcmp(name, API_GET_GAMEPAD_OPTIONS, sizeof(API_GET_GAMEPAD_OPTIONS)))
-			return set_file_data(file, getGamepadOptions());
-		if (!memcmp(name, API_GET_LED_OPTIONS, sizeof(API_GET_LED_OPTIONS)))
-			return set_file_data(file, getLedOptions());
-		if (!memcmp(name, API_GET_PIN_MAPPINGS, sizeof(API_GET_PIN_MAPPINGS)))
-			return set_file_data(file, getPinMappings());
-		if (!memcmp(name, API_RESET_SETTINGS, sizeof(API_RESET_SETTINGS)))
-			return set_file_data(file, resetSettings());
+		const WebRoute *route = post_route;
+		end_post();
+		return set_file_data(file, route->handler());
 	}
 
-	bool isExclude = false;
-	for (auto &excludePath : excludePaths)
-		if (!excludePath.compare(name))
-			return 0;
+	const WebRoute *route = findRoute(name);
+	if (route == nullptr)
+		return 0;
 
-	for (auto &spaPath : spaPaths)
+	switch (route->type)
 	{
-		if (!spaPath.compare(name))
-		{
+		case ROUTE_GET:
+			return set_file_data(file, route->handler());
+
+		case ROUTE_SPA:
 			file->data = (const char *)file__index_html[0].data;
 			file->len = file__index_html[0].len;
 			file->index = file__index_html[0].len;
@@ -471,10 +874,10 @@ int fs_open_custom(struct fs_file *file, const char *name)
 			file->pextension = NULL;
 			file->is_custom_file = 0;
 			return 1;
-		}
-	}
 
-	return 0;
+		default:
+			return 0;
+	}
 }
 
 void fs_close_custom(struct fs_file *file)
@@ -484,6 +887,4 @@ void fs_close_custom(struct fs_file *file)
 		mem_free(file->pextension);
 		file->pextension = NULL;
 	}
-
-	is_post = false;
 }
@@ -0,0 +1,195 @@
+import argparse
+import http.client
+import json
+import random
+import sys
+import time
+
+# Checks the web configurator API against one contract, on the controller or on the www/server mock,
+# then drives it with a mix of requests and reports latency and the controller's memory high-water marks
+
+parser = argparse.ArgumentParser(description="Check and load test the web configurator API")
+parser.add_argument("--host", default="192.168.7.1")
+parser.add_argument("--port", type=int, default=80)
+parser.add_argument("--requests", type=int, default=200, help="Number of requests in the load mix, 0 to skip it")
+parser.add_argument("--write", action="store_true", help="Also check setConfig, writes the current config back to flash")
+parser.add_argument("--seed", type=int, default=1)
+args = parser.parse_args()
+
+PINS = ["Up", "Down", "Left", "Right", "B1", "B2", "B3", "B4", "L1", "R1", "L2", "R2", "S1", "S2", "L3", "R3", "A1", "A2"]
+OPTIONAL_INT = (int, type(None))
+
+display_contract = {
+  "enabled": int, "sdaPin": int, "sclPin": int, "i2cAddress": int, "i2cBlock": int, "i2cSpeed": int,
+  "flipDisplay": int, "invertDisplay": int,
+}
+gamepad_contract = { "dpadMode": int, "inputMode": int, "socdMode": int }
+led_contract = {
+  "dataPin": int, "ledFormat": int, "ledLayout": int, "ledsPerButton": int, "ledCount": int,
+  "chains": [{ "pin": int, "length": int }], "brightnessMaximum": int, "brightnessSteps": int,
+  "ledButtonMap": { pin: OPTIONAL_INT for pin in PINS },
+}
+pins_contract = { pin: int for pin in PINS }
+
+contracts = {
+  "/api/getDisplayOptions": dict(display_contract, usedPins=[int]),
+  "/api/getGamepadOptions": gamepad_contract,
+  "/api/getLedOptions": dict(led_contract, usedPins=[int]),
+  "/api/getPinMappings": pins_contract,
+  "/api/getConfig": { "version": int, "display": display_contract, "gamepad": gamepad_contract, "led": led_contract, "pins": pins_contract },
+  "/api/getStats": {
+    "heap": { "size": int, "used": int, "peak": int, "errors": int },
+    "pools": { "tcpPcb": int, "tcpSeg": int, "pbuf": int, "pbufPool": int },
+    "json": { "size": int, "peak": int },
+    "link": { "rxFrames": int, "rxDropped": int, "txFrames": int, "rxQueuePeak": int, "txQueuePeak": int },
+    "leds": { "framesShown": int, "framesSkipped": int },
+    "flashStallPeakUS": int,
+  },
+}
+
+# Relative weights of the load mix, roughly what opening each page of the configurator does
+load_mix = [
+  ("/api/getPinMappings", 4),
+  ("/api/getGamepadOptions", 3),
+  ("/api/getLedOptions", 2),
+  ("/api/getDisplayOptions", 2),
+  ("/api/getConfig", 1),
+]
+
+failures = []
+conn = None
+
+def request(method, path, body=None):
+  global conn
+  if conn is None:
+    conn = http.client.HTTPConnection(args.host, args.port, timeout=10)
+
+  headers = { "Connection": "keep-alive" }
+  data = None
+  if body is not None:
+    data = json.dumps(body, separators=(",", ":")).encode("utf-8")
+    headers["Content-Type"] = "application/json"
+
+  start = time.perf_counter()
+  conn.request(method, path, body=data, headers=headers)
+  response = conn.getresponse()
+  raw = response.read()
+  elapsed = time.perf_counter() - start
+
+  if response.will_close:
+    conn.close()
+    conn = None
+  if response.status != 200:
+    raise RuntimeError("%s returned %d" % (path, response.status))
+
+  return json.loads(raw), elapsed
+
+def check(value, contract, where):
+  if isinstance(contract, dict):
+    if not isinstance(value, dict):
+      failures.append("%s: expected an object" % where)
+      return
+    for key, member in contract.items():
+      if key not in value:
+        failures.append("%s.%s: missing" % (where, key))
+      else:
+        check(value[key], member, "%s.%s" % (where, key))
+    for key in value:
+      if key not in contract:
+        failures.append("%s.%s: not in the contract" % (where, key))
+  elif isinstance(contract, list):
+    if not isinstance(value, list):
+      failures.append("%s: expected an array" % where)
+      return
+    for i, item in enumerate(value):
+      check(item, contract[0], "%s[%d]" % (where, i))
+  else:
+    types = contract if isinstance(contract, tuple) else (contract,)
+    if isinstance(value, bool) or not isinstance(value, types):
+      failures.append("%s: expected %s, got %r" % (where, " or ".join(t.__name__ for t in types), value))
+
+def check_contracts():
+  print("Contract")
+  for path, contract in contracts.items():
+    body, elapsed = request("GET", path)
+    before = len(failures)
+    check(body, contract, path)
+    print("  %-28s %6.1f ms  %s" % (path, elapsed * 1000, "ok" if len(failures) == before else "FAILED"))
+
+def check_set_config():
+  print("setConfig")
+  before = len(failures)
+  config, _ = request("GET", "/api/getConfig")
+
+  result, _ = request("POST", "/api/setConfig", config)
+  if result != { "success": True }:
+    failures.append("setConfig with the current config: %r" % result)
+
+  # Two buttons on one pin must be rejected without touching anything
+  invalid = json.loads(json.dumps(config))
+  invalid["pins"]["B2"] = invalid["pins"]["B1"]
+  result, _ = request("POST", "/api/setConfig", invalid)
+  if result.get("success") is not False or not isinstance(result.get("error"), str):
+    failures.append("setConfig with a pin mapped twice: %r" % result)
+
+  # Values out of range as well
+  invalid = json.loads(json.dumps(config))
+  invalid["led"]["brightnessSteps"] = 0
+  result, _ = request("POST", "/api/setConfig", invalid)
+  if result.get("success") is not False:
+    failures.append("setConfig with no brightness steps: %r" % result)
+
+  result, _ = request("POST", "/api/setConfig", dict(config, version=-1))
+  if result.get("success") is not False:
+    failures.append("setConfig with an unknown version: %r" % result)
+
+  after, _ = request("GET", "/api/getConfig")
+  if after != config:
+    failures.append("getConfig changed after setConfig calls that should have been no-ops")
+
+  print("  %s" % ("ok" if len(failures) == before else "FAILED"))
+
+def run_load_mix():
+  random.seed(args.seed)
+  paths = [path for path, weight in load_mix for _ in range(weight)]
+  times = {}
+
+  stats_before, _ = request("GET", "/api/getStats")
+  start = time.perf_counter()
+  for _ in range(args.requests):
+    path = random.choice(paths)
+    _, elapsed = request("GET", path)
+    times.setdefault(path, []).append(elapsed)
+  total = time.perf_counter() - start
+  stats_after, _ = request("GET", "/api/getStats")
+
+  print("Load mix: %d requests in %.1f s, %.0f requests/s" % (args.requests, total, args.requests / total))
+  for path, samples in sorted(times.items()):
+    samples.sort()
+    p50 = samples[len(samples) // 2]
+    p95 = samples[min(len(samples) - 1, len(samples) * 95 // 100)]
+    print("  %-28s %5d  p50 %6.1f ms  p95 %6.1f ms  max %6.1f ms" % (path, len(samples), p50 * 1000, p95 * 1000, samples[-1] * 1000))
+
+  heap = stats_after["heap"]
+  print("Memory")
+  print("  lwIP heap    peak %6d of %6d bytes, %d allocation errors" % (heap["peak"], heap["size"], heap["errors"]))
+  print("  JSON doc     peak %6d of %6d bytes" % (stats_after["json"]["peak"], stats_after["json"]["size"]))
+  print("  pools        tcpPcb %d  tcpSeg %d  pbuf %d  pbufPool %d" % tuple(stats_after["pools"][k] for k in ("tcpPcb", "tcpSeg", "pbuf", "pbufPool")))
+  print("  link         rx dropped %d during the mix" % (stats_after["link"]["rxDropped"] - stats_before["link"]["rxDropped"]))
+
+  if heap["errors"] > stats_before["heap"]["errors"]:
+    failures.append("lwIP heap allocations failed during the load mix")
+
+check_contracts()
+if args.write:
+  check_set_config()
+if args.requests > 0:
+  run_load_mix()
+
+if failures:
+  print("%d failures" % len(failures))
+  for failure in failures:
+    print("  " + failure)
+  sys.exit(1)
+
+print("All checks passed")
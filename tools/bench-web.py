@@ -0,0 +1,87 @@
+import argparse
+import gzip
+import http.client
+import json
+import re
+import time
+
+# Loads the configurator the way a browser does on a cold cache, then reports page-load time and throughput
+
+parser = argparse.ArgumentParser(description="Benchmark the web configurator over the USB network link")
+parser.add_argument("--host", default="192.168.7.1")
+parser.add_argument("--runs", type=int, default=5)
+parser.add_argument("--no-keepalive", action="store_true", help="Open a new connection for every request")
+args = parser.parse_args()
+
+headers = { "Accept-Encoding": "gzip" }
+if not args.no_keepalive:
+  headers["Connection"] = "keep-alive"
+
+def fetch(conn, path):
+  if conn is None:
+    conn = http.client.HTTPConnection(args.host, timeout=10)
+  conn.request("GET", path, headers=headers)
+  response = conn.getresponse()
+  body = response.read()
+  if response.status != 200:
+    raise RuntimeError("%s returned %d" % (path, response.status))
+  if args.no_keepalive or response.will_close:
+    conn.close()
+    conn = None
+  return conn, body
+
+def load_page():
+  conn = None
+  conn, index = fetch(conn, "/")
+  total = len(index)
+
+  # The index is gzipped on the device, so take the asset list from the uncompressed copy
+  try:
+    html = gzip.decompress(index).decode("utf-8", "replace")
+  except OSError:
+    html = index.decode("utf-8", "replace")
+
+  for path in re.findall(r'(?:src|href)="(/[^"]+)"', html):
+    conn, body = fetch(conn, path)
+    total += len(body)
+
+  for path in ["/api/getGamepadOptions", "/api/getLedOptions", "/api/getPinMappings", "/api/getDisplayOptions"]:
+    conn, body = fetch(conn, path)
+    total += len(body)
+
+  if conn is not None:
+    conn.close()
+  return total
+
+# The RNDIS driver's counters, read before and after so dropped frames and queue use show up next to the times
+def link_stats():
+  conn, body = fetch(None, "/api/getStats")
+  if conn is not None:
+    conn.close()
+  return json.loads(body).get("link", {})
+
+def print_link(label, link):
+  print("%-7s rx %d frames, %d dropped, tx %d frames, queue peaks rx %d tx %d" % (label,
+    link.get("rxFrames", 0), link.get("rxDropped", 0), link.get("txFrames", 0),
+    link.get("rxQueuePeak", 0), link.get("txQueuePeak", 0)))
+
+before = link_stats()
+print_link("before:", before)
+
+results = []
+for run in range(args.runs):
+  start = time.perf_counter()
+  size = load_page()
+  elapsed = time.perf_counter() - start
+  results.append(elapsed)
+  print("run %d: %6.0f ms  %7d bytes  %6.1f KB/s" % (run + 1, elapsed * 1000, size, size / elapsed / 1024))
+
+results.sort()
+print("median: %.0f ms" % (results[len(results) // 2] * 1000))
+
+after = link_stats()
+print_link("after:", after)
+print("during: rx %d frames, %d dropped, tx %d frames" % (
+  after.get("rxFrames", 0) - before.get("rxFrames", 0),
+  after.get("rxDropped", 0) - before.get("rxDropped", 0),
+  after.get("txFrames", 0) - before.get("txFrames", 0)))
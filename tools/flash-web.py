@@ -0,0 +1,101 @@
+import argparse
+import http.client
+import json
+import struct
+import sys
+import zlib
+
+# Updates controllers in web config mode over the network: uploads a UF2 file, checks the CRC the
+# controller staged against the file's, then tells it to apply the update. Pass --host once per controller.
+
+UF2_BLOCK_SIZE = 512
+UF2_MAGIC_START0 = 0x0A324655
+UF2_MAGIC_START1 = 0x9E5D5157
+UF2_MAGIC_END = 0x0AB16F30
+UF2_FLAG_NOT_MAIN_FLASH = 0x00000001
+UF2_FLAG_FAMILY_ID = 0x00002000
+UF2_FAMILY_RP2040 = 0xE48BFF56
+XIP_BASE = 0x10000000
+
+parser = argparse.ArgumentParser(description="Update GP2040 firmware through the web configurator")
+parser.add_argument("file", help="UF2 firmware file")
+parser.add_argument("--host", action="append", help="Controller address, can be given more than once (default 192.168.7.1)")
+parser.add_argument("--port", type=int, default=80)
+parser.add_argument("--dry-run", action="store_true", help="Upload and verify, but keep the current firmware")
+args = parser.parse_args()
+
+# Lays the file out the way the controller stages it, from the start of flash with gaps left erased
+def read_uf2(path):
+  with open(path, "rb") as f:
+    data = f.read()
+
+  if not data or len(data) % UF2_BLOCK_SIZE != 0:
+    raise ValueError("not a UF2 file")
+
+  blocks = []
+  for offset in range(0, len(data), UF2_BLOCK_SIZE):
+    start0, start1, flags, target, length, _, _, family = struct.unpack_from("<8I", data, offset)
+    end, = struct.unpack_from("<I", data, offset + UF2_BLOCK_SIZE - 4)
+    if start0 != UF2_MAGIC_START0 or start1 != UF2_MAGIC_START1 or end != UF2_MAGIC_END:
+      raise ValueError("not a UF2 file")
+    if flags & UF2_FLAG_NOT_MAIN_FLASH:
+      continue
+    if not flags & UF2_FLAG_FAMILY_ID or family != UF2_FAMILY_RP2040:
+      raise ValueError("not an RP2040 image")
+    blocks.append((target - XIP_BASE, data[offset + 32:offset + 32 + length]))
+
+  size = max(target + len(payload) for target, payload in blocks)
+  image = bytearray(b"\xff" * size)
+  for target, payload in blocks:
+    image[target:target + len(payload)] = payload
+
+  return data, size, zlib.crc32(image)
+
+def post(host, path, body, content_type):
+  conn = http.client.HTTPConnection(host, args.port, timeout=30)
+  try:
+    conn.request("POST", path, body=body, headers={ "Content-Type": content_type })
+    response = conn.getresponse()
+    raw = response.read()
+    if response.status != 200:
+      raise RuntimeError("%s returned %d" % (path, response.status))
+    return json.loads(raw)
+  finally:
+    conn.close()
+
+def update(host, data, size, crc):
+  staged = post(host, "/api/firmware", data, "application/octet-stream")
+  if not staged.get("success"):
+    return "upload failed: %s" % staged.get("error")
+  if staged.get("size") != size or staged.get("crc") != crc:
+    return "staged image does not match the file, CRC 0x%08x" % staged.get("crc", 0)
+  if args.dry_run:
+    return None
+
+  applied = post(host, "/api/applyFirmware", json.dumps({ "crc": crc }).encode("utf-8"), "application/json")
+  if not applied.get("success"):
+    return "apply failed: %s" % applied.get("error")
+  return None
+
+try:
+  data, size, crc = read_uf2(args.file)
+except (OSError, ValueError) as e:
+  print("%s: %s" % (args.file, e))
+  sys.exit(1)
+
+print("%s: %d bytes, CRC 0x%08x" % (args.file, size, crc))
+
+failed = 0
+for host in args.host or ["192.168.7.1"]:
+  try:
+    error = update(host, data, size, crc)
+  except (OSError, RuntimeError, ValueError) as e:
+    error = str(e)
+
+  if error:
+    failed += 1
+    print("  %-16s FAILED, %s" % (host, error))
+  else:
+    print("  %-16s %s" % (host, "verified" if args.dry_run else "updating, the controller restarts in a few seconds"))
+
+sys.exit(1 if failed else 0)
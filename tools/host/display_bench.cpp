@@ -0,0 +1,133 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+/* Checks the precomputed button sprites against obdPreciseEllipse(), which the display used to call for
+every button on every frame, then times both. Every radius the sprites support is drawn, pressed and
+released, at every position on a 128x64 screen and partly off the top and bottom. The released sprite is
+also drawn over a pressed one, the way the display erases a button without clearing the screen.
+
+Buttons crossing the left or right edge are only counted. obdSetPixel() bounds checks the buffer offset
+rather than x, so the ellipse wraps into the neighbouring page there while the sprite is clipped.
+
+	display_bench           check, then report ns/button for both paths
+	display_bench --check   check only
+*/
+
+#include <chrono>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "OneBitDisplay.h"
+#include "button_sprites.h"
+
+using namespace std;
+
+#define SCREEN_WIDTH  128
+#define SCREEN_HEIGHT 64
+#define SCREEN_BYTES  (SCREEN_WIDTH * SCREEN_HEIGHT / 8)
+
+static uint8_t reference[SCREEN_BYTES];
+static uint8_t sprite[SCREEN_BYTES];
+static OBDISP obd;
+static ButtonSprites sprites;
+
+static void drawEllipse(int x, int y, int radius, bool pressed)
+{
+	obdCreateVirtualDisplay(&obd, SCREEN_WIDTH, SCREEN_HEIGHT, reference);
+	obdFill(&obd, 0, 0);
+	obdPreciseEllipse(&obd, x, y, radius, radius, 1, pressed);
+}
+
+static int check()
+{
+	int failed = 0;
+	int checked = 0;
+	int wrapped = 0;
+	for (int radius = 1; radius <= BUTTON_SPRITE_MAX_RADIUS; radius++)
+	{
+		rasteriseButtonSprites(sprites, radius);
+		for (int y = -radius; y < SCREEN_HEIGHT + radius; y++)
+		{
+			for (int x = -radius; x < SCREEN_WIDTH + radius; x++)
+			{
+				for (int pressed = 0; pressed < 2; pressed++)
+				{
+					drawEllipse(x, y, radius, pressed);
+
+					memset(sprite, 0, sizeof(sprite));
+					if (!pressed)
+						blitButtonSprite(sprites, sprite, SCREEN_WIDTH, SCREEN_HEIGHT, x, y, true);
+					blitButtonSprite(sprites, sprite, SCREEN_WIDTH, SCREEN_HEIGHT, x, y, pressed);
+
+					bool differs = memcmp(reference, sprite, sizeof(sprite)) != 0;
+					if (x - radius < 0 || x + radius >= SCREEN_WIDTH)
+					{
+						wrapped += differs;
+						continue;
+					}
+
+					checked++;
+					if (differs)
+					{
+						if (failed++ < 10)
+							printf("radius %d at %d,%d %s: sprite differs from obdPreciseEllipse\n", radius, x, y, pressed ? "pressed" : "released");
+					}
+				}
+			}
+		}
+	}
+
+	printf("%d buttons checked, %d differ, %d wrapped at the sides\n", checked, failed, wrapped);
+	return failed;
+}
+
+// Same twelve buttons per frame as the display, spread over the screen so every phase is hit.
+// Both paths clear their buffer with the same memset each frame, so only the drawing differs.
+static void bench()
+{
+	const int frames = 20000;
+	const int buttons = 12;
+
+	printf("%-8s %14s %14s %8s\n", "radius", "ellipse ns", "sprite ns", "speedup");
+	for (int radius = 4; radius <= BUTTON_SPRITE_MAX_RADIUS; radius++)
+	{
+		rasteriseButtonSprites(sprites, radius);
+		obdCreateVirtualDisplay(&obd, SCREEN_WIDTH, SCREEN_HEIGHT, reference);
+
+		auto start = chrono::steady_clock::now();
+		for (int frame = 0; frame < frames; frame++)
+		{
+			memset(reference, 0, sizeof(reference));
+			for (int i = 0; i < buttons; i++)
+				obdPreciseEllipse(&obd, 8 + i * 10, 12 + ((i + frame) % 40), radius, radius, 1, (frame + i) & 1);
+		}
+		double ellipseNS = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / (frames * buttons);
+
+		start = chrono::steady_clock::now();
+		for (int frame = 0; frame < frames; frame++)
+		{
+			memset(sprite, 0, sizeof(sprite));
+			for (int i = 0; i < buttons; i++)
+				blitButtonSprite(sprites, sprite, SCREEN_WIDTH, SCREEN_HEIGHT, 8 + i * 10, 12 + ((i + frame) % 40), (frame + i) & 1);
+		}
+		double spriteNS = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / (frames * buttons);
+
+		printf("%-8d %14.1f %14.1f %7.1fx\n", radius, ellipseNS, spriteNS, ellipseNS / spriteNS);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	bool checkOnly = argc > 1 && !strcmp(argv[1], "--check");
+
+	if (check() != 0)
+		return 1;
+
+	if (!checkOnly)
+		bench();
+
+	return 0;
+}
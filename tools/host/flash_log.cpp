@@ -0,0 +1,408 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+/* Runs lib/FlashPROM's log on simulated flash, so appending, relocating, erasing and the replay at boot can be
+checked without a board.
+
+The flash behaves like NOR flash: programming only clears bits, and programming a byte that isn't erased counts
+as an overwrite. A power cut stops the simulation in the middle of a page program or sector erase, leaving part
+of it done, and the board boots again from whatever is in flash. After every commit and every boot the cache
+has to hold either the last commit that finished or the one that was cut, and nothing else.
+
+FlashPROM.cpp is built into this file, so the checks can see where the head and tail are, and the clock is the
+simulation's instead of the shim's.
+
+	flash_log           check, then report pages programmed and sectors erased per commit for each kind of change
+	flash_log --check   check only
+*/
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+// Stands in for shim/pico/time.h, EEPROM_WRITE_WAIT passes in simulated time
+#define HOST_PICO_TIME_H_
+
+typedef uint64_t absolute_time_t;
+
+static uint64_t clockUS = 0;
+
+static inline absolute_time_t get_absolute_time(void) { return clockUS; }
+static inline uint32_t time_us_32(void) { return (uint32_t)clockUS; }
+static inline uint32_t to_ms_since_boot(absolute_time_t t) { return (uint32_t)(t / 1000); }
+
+#include "FlashPROM.cpp"
+
+#define FLASH_START  EEPROM_LOG_START
+#define FLASH_SIZE   ((EEPROM_LOG_SECTORS + 1) * FLASH_SECTOR_SIZE) // The log and the old EEPROM sector above it
+#define POLL_US      1000                                           // One input frame
+#define MAX_POLLS    100000
+
+struct PowerCut { };
+
+enum Change
+{
+	CHANGE_BYTES,     // A few bytes, like a single option
+	CHANGE_SECTION,   // A contiguous span, like a whole storage section
+	CHANGE_ALL,       // Every byte, like a reset or a restored backup
+	CHANGE_SCATTERED, // One byte in every 16th block, so no two live blocks share a record
+	CHANGE_COUNT
+};
+
+static const char *changeNames[CHANGE_COUNT] = { "bytes", "section", "all", "scattered" };
+
+static uint8_t *flash = nullptr;
+static int cutAfter = -1;      // Flash operations left before the power is cut, -1 for never
+static uint32_t overwrites = 0;
+static uint32_t outsideLog = 0;
+static uint32_t rngState = 1;
+static uint8_t committed[EEPROM_SIZE_BYTES]; // The last commit that finished
+static uint8_t pending[EEPROM_SIZE_BYTES];   // What the cache was set to for the commit in flight
+static const char *scenario = "";
+static int failures = 0;
+
+static void fail(const char *format, ...)
+{
+	if (failures++ >= 10)
+		return;
+
+	va_list args;
+	va_start(args, format);
+	printf("%s: ", scenario);
+	vprintf(format, args);
+	printf("\n");
+	va_end(args);
+}
+
+static uint32_t nextRandom()
+{
+	rngState ^= rngState << 13;
+	rngState ^= rngState >> 17;
+	rngState ^= rngState << 5;
+	return rngState;
+}
+
+static uint8_t *flashAt(uint32_t flash_offs)
+{
+	if (flash_offs < FLASH_START - XIP_BASE || flash_offs >= EEPROM_ADDRESS_START - XIP_BASE)
+		outsideLog++;
+
+	return flash + (flash_offs - (FLASH_START - XIP_BASE));
+}
+
+// Runs out the power budget, a cut leaves the first part of the operation done
+static size_t powerLeft(size_t count)
+{
+	if (cutAfter < 0 || cutAfter-- > 0)
+		return count;
+
+	return nextRandom() % count;
+}
+
+void flash_range_erase(uint32_t flash_offs, size_t count)
+{
+	uint8_t *dst = flashAt(flash_offs);
+	size_t done = powerLeft(count);
+
+	memset(dst, 0xFF, done);
+	if (done < count)
+		throw PowerCut();
+}
+
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count)
+{
+	uint8_t *dst = flashAt(flash_offs);
+	size_t done = powerLeft(count);
+
+	for (size_t i = 0; i < done; i++)
+	{
+		if (dst[i] != 0xFF)
+			overwrites++;
+		dst[i] &= data[i];
+	}
+
+	if (done < count)
+		throw PowerCut();
+}
+
+static void eraseFlash()
+{
+	memset(flash, 0xFF, FLASH_SIZE);
+	memset(committed, 0, EEPROM_SIZE_BYTES);
+	overwrites = 0;
+	outsideLog = 0;
+}
+
+// Boots from what is in flash, a cut during the erases at boot boots again
+static void boot()
+{
+	for (;;)
+	{
+		try
+		{
+			EEPROM.start();
+			return;
+		}
+		catch (const PowerCut &)
+		{
+		}
+	}
+}
+
+static void change(Change kind)
+{
+	switch (kind)
+	{
+		case CHANGE_BYTES:
+		{
+			int offset = nextRandom() % (EEPROM_SIZE_BYTES - 8);
+			for (int i = 0, count = 1 + nextRandom() % 8; i < count; i++)
+				pending[offset + i] = nextRandom();
+			break;
+		}
+
+		case CHANGE_SECTION:
+		{
+			int length = 16 + nextRandom() % 600;
+			int offset = nextRandom() % (EEPROM_SIZE_BYTES - length);
+			for (int i = 0; i < length; i++)
+				pending[offset + i] = nextRandom();
+			break;
+		}
+
+		case CHANGE_ALL:
+			for (int i = 0; i < EEPROM_SIZE_BYTES; i++)
+				pending[i] = nextRandom();
+			break;
+
+		case CHANGE_SCATTERED:
+		{
+			int block = nextRandom() % 16;
+			for (; block < EEPROM_BLOCK_COUNT; block += 16)
+				pending[(block * EEPROM_BLOCK_SIZE) + (nextRandom() % EEPROM_BLOCK_SIZE)] ^= 1 + (nextRandom() % 255);
+			break;
+		}
+
+		default:
+			break;
+	}
+}
+
+// Commits the pending changes and polls until the log is done with them, including any compaction after
+static void commit()
+{
+	EEPROM.set(0, pending, EEPROM_SIZE_BYTES);
+	EEPROM.commit();
+
+	for (int polls = 0; EEPROM.isBusy(); polls++)
+	{
+		if (polls == MAX_POLLS)
+		{
+			fail("still busy after %d polls", MAX_POLLS);
+			return;
+		}
+
+		clockUS += POLL_US;
+		EEPROM.poll(true);
+	}
+
+	if (tailSector != headSector && freePages() < EEPROM_RESERVED_PAGES)
+		fail("only %d pages are free ahead of the head after compaction", freePages());
+}
+
+static void checkCache(const char *when)
+{
+	static uint8_t cache[EEPROM_SIZE_BYTES];
+
+	EEPROM.get(0, cache, EEPROM_SIZE_BYTES);
+	if (memcmp(cache, committed, EEPROM_SIZE_BYTES) != 0)
+		fail("%s the cache doesn't match the last commit", when);
+}
+
+static void checkLog(const char *when)
+{
+	if (overwrites)
+		fail("%s %u bytes were programmed without being erased", when, overwrites);
+	if (outsideLog)
+		fail("%s %u operations were outside the log", when, outsideLog);
+
+	overwrites = 0;
+	outsideLog = 0;
+}
+
+// Commits the given kinds of change in turn, rebooting after every commit
+static void checkCommits(const char *name, const Change *kinds, int kindCount, int commits)
+{
+	scenario = name;
+	eraseFlash();
+	boot();
+	memset(pending, 0, EEPROM_SIZE_BYTES);
+
+	for (int i = 0; i < commits && failures < 10; i++)
+	{
+		change(kinds[i % kindCount]);
+		commit();
+		memcpy(committed, pending, EEPROM_SIZE_BYTES);
+		checkLog("after a commit");
+		checkCache("after a commit");
+
+		boot();
+		checkLog("after a boot");
+		checkCache("after a boot");
+	}
+}
+
+/* Cuts the power at a random point of every commit or the compaction after it. After the boot the cache has to
+hold the commit that was cut or the one before it. */
+static void checkPowerCuts(const char *name, int commits)
+{
+	int cutsBefore = 0;
+	int cutsAfter = 0;
+
+	scenario = name;
+	eraseFlash();
+	boot();
+	memset(pending, 0, EEPROM_SIZE_BYTES);
+
+	for (int i = 0; i < commits && failures < 10; i++)
+	{
+		memcpy(pending, committed, EEPROM_SIZE_BYTES);
+		change((Change)(nextRandom() % CHANGE_COUNT));
+		cutAfter = nextRandom() % 48;
+
+		try
+		{
+			commit();
+			cutAfter = -1;
+			memcpy(committed, pending, EEPROM_SIZE_BYTES);
+			checkLog("after a commit");
+			checkCache("after a commit");
+			continue;
+		}
+		catch (const PowerCut &)
+		{
+		}
+
+		// Cut boots can be cut again
+		cutAfter = nextRandom() % 4;
+		boot();
+		cutAfter = -1;
+
+		static uint8_t cache[EEPROM_SIZE_BYTES];
+		EEPROM.get(0, cache, EEPROM_SIZE_BYTES);
+		if (memcmp(cache, pending, EEPROM_SIZE_BYTES) == 0)
+		{
+			memcpy(committed, pending, EEPROM_SIZE_BYTES);
+			cutsAfter++;
+		}
+		else
+		{
+			cutsBefore++;
+		}
+
+		checkLog("after a cut");
+		checkCache("after a cut");
+	}
+
+	printf("%-14s %6d commits, %d cut before the last record, %d after\n", name, commits, cutsBefore, cutsAfter);
+	if (!cutsBefore || !cutsAfter)
+		fail("the cuts never landed on both sides of the last record");
+}
+
+// A save from before the log is migrated at the first boot and stays after the next
+static void checkMigration()
+{
+	scenario = "migration";
+	eraseFlash();
+
+	uint8_t *old = flash + (EEPROM_ADDRESS_START - FLASH_START);
+	for (int i = 0; i < EEPROM_SIZE_BYTES; i++)
+		old[i] = committed[i] = nextRandom();
+
+	boot();
+	checkCache("at the first boot");
+	memcpy(pending, committed, EEPROM_SIZE_BYTES);
+	commit();
+
+	boot();
+	checkLog("after the migration");
+	checkCache("after the migration");
+	if (memcmp(old, committed, EEPROM_SIZE_BYTES) != 0)
+		fail("the old EEPROM sector was written");
+}
+
+static int check()
+{
+	static const Change mixed[] = { CHANGE_BYTES, CHANGE_SECTION, CHANGE_BYTES, CHANGE_ALL, CHANGE_SECTION };
+	static const Change small[] = { CHANGE_BYTES };
+	static const Change all[] = { CHANGE_ALL, CHANGE_BYTES };
+	static const Change scattered[] = { CHANGE_SCATTERED };
+
+	checkCommits("mixed", mixed, sizeof(mixed) / sizeof(*mixed), 2000);
+	checkCommits("small", small, 1, 2000);
+	checkCommits("all", all, sizeof(all) / sizeof(*all), 500);
+	checkCommits("scattered", scattered, 1, 500);
+	checkPowerCuts("power cuts", 3000);
+	checkMigration();
+
+	printf("%d failures\n", failures);
+	return failures;
+}
+
+// Pages programmed and sectors erased per commit once the log has wrapped a few times
+static void bench()
+{
+	printf("\n%-14s %14s %14s\n", "change", "pages/commit", "erases/commit");
+
+	for (int kind = 0; kind < CHANGE_COUNT; kind++)
+	{
+		eraseFlash();
+		boot();
+		memset(pending, 0, EEPROM_SIZE_BYTES);
+
+		for (int i = 0; i < 200; i++)
+		{
+			change((Change)kind);
+			commit();
+		}
+
+		const int commits = 2000;
+		uint32_t programs = FlashPROM::programCount;
+		uint32_t erases = FlashPROM::eraseCount;
+		for (int i = 0; i < commits; i++)
+		{
+			change((Change)kind);
+			commit();
+		}
+
+		printf("%-14s %14.2f %14.3f\n", changeNames[kind], (FlashPROM::programCount - programs) / (double)commits,
+			(FlashPROM::eraseCount - erases) / (double)commits);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	bool checkOnly = argc > 1 && !strcmp(argv[1], "--check");
+
+	// The log is read straight from its XIP address, so the simulated flash has to live there
+	void *at = reinterpret_cast<void *>((uintptr_t)FLASH_START);
+	flash = static_cast<uint8_t *>(mmap(at, FLASH_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0));
+	if (flash != at)
+	{
+		printf("can't map the simulated flash at 0x%08x\n", (unsigned)FLASH_START);
+		return 1;
+	}
+
+	if (check() != 0)
+		return 1;
+
+	if (!checkOnly)
+		bench();
+
+	return 0;
+}
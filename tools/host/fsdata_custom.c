@@ -0,0 +1,46 @@
+/*
+ * SPDX-License-Identifier: MIT
+ */
+
+/* Stands in for the fsdata.c that build-web.py generates, in the same layout, so web_bench runs the real
+fs.c without building the React app. FS_ROOT is index.html, which the SPA routes are served from. */
+
+#include "fsdata.h"
+
+#define INDEX_HTML_HEADER \
+	"HTTP/1.1 200 OK\r\n" \
+	"Server: GP2040 (lwIP)\r\n" \
+	"Content-Length: 13\r\n" \
+	"Content-Type: text/html\r\n" \
+	"Cache-Control: public, max-age=10\r\n" \
+	"\r\n"
+
+#define MAIN_JS_HEADER \
+	"HTTP/1.1 200 OK\r\n" \
+	"Server: GP2040 (lwIP)\r\n" \
+	"Content-Length: 9\r\n" \
+	"Content-Type: application/javascript\r\n" \
+	"Cache-Control: public, max-age=31536000, immutable\r\n" \
+	"\r\n"
+
+static const unsigned char data__index_html[] = "/index.html\0" INDEX_HTML_HEADER "<html></html>";
+static const unsigned char data__static_js_main_js[] = "/static/js/main.js\0" MAIN_JS_HEADER "main();\r\n";
+
+const struct fsdata_file file__static_js_main_js[] = {{
+	NULL,
+	data__static_js_main_js,
+	data__static_js_main_js + 19,
+	sizeof(data__static_js_main_js) - 19 - 1,
+	FS_FILE_FLAGS_HEADER_INCLUDED | FS_FILE_FLAGS_HEADER_PERSISTENT | FS_FILE_FLAGS_HEADER_HTTPVER_1_1,
+}};
+
+const struct fsdata_file file__index_html[] = {{
+	file__static_js_main_js,
+	data__index_html,
+	data__index_html + 12,
+	sizeof(data__index_html) - 12 - 1,
+	FS_FILE_FLAGS_HEADER_INCLUDED | FS_FILE_FLAGS_HEADER_PERSISTENT | FS_FILE_FLAGS_HEADER_HTTPVER_1_1,
+}};
+
+#define FS_ROOT file__index_html
+#define FS_NUMFILES 2
@@ -0,0 +1,506 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+/* Renders every AnimationStation effect, static theme and LED layout off-device. Time comes from a
+fake clock stepped at the LED module's 10ms interval, so every run produces the same frames.
+
+	led_render --check golden/leds.txt   compare each run against its golden hash
+	led_render --update golden/leds.txt  rewrite the golden hashes after an intended change
+	led_render --dump DIR [--ppm]        write a GIF per run, and every frame as PPM with --ppm
+	led_render --bench                   report ns/frame for each effect
+*/
+
+#include <chrono>
+#include <map>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "AnimationStation.hpp"
+#include "LEDArena.hpp"
+#include "led_layouts.h"
+#include "storage.h"
+#include "themes.h"
+
+using namespace std;
+
+#define FRAME_INTERVAL_MS 10 // Same as LEDModule::intervalMS
+#define FRAME_COUNT 300
+#define PRESS_START 100      // B1 and Up are held for these frames to exercise the pressed layer
+#define PRESS_END 160
+#define CELL_SIZE 16         // Pixels per LED in the dumps
+
+struct Run
+{
+	string name;
+	ButtonLayout layout;
+	uint8_t effect;
+	uint8_t colorIndex;
+	uint8_t themeIndex;
+};
+
+struct Render
+{
+	uint32_t hash;
+	vector<vector<RGB>> images;
+	int width;
+	int height;
+};
+
+static uint32_t mockNow = 0;
+static uint32_t mockClock() { return mockNow; }
+
+static AnimationStation as;
+static PixelMatrix matrix;
+static uint32_t frame[LED_ARENA_SIZE / sizeof(RGB)];
+
+static const char *layoutNames[] = { "arcade", "hitbox", "wasd" };
+
+struct ThemeList : StaticTheme
+{
+	static size_t Count() { return themes.size(); }
+};
+
+// The order the LED indexes are wired in, every button gets one so all of them are drawn
+static void setupButtonPositions()
+{
+	static const string labels[] = {
+		BUTTON_LABEL_R2, BUTTON_LABEL_B2, BUTTON_LABEL_B1, BUTTON_LABEL_L1, BUTTON_LABEL_R1, BUTTON_LABEL_B4,
+		BUTTON_LABEL_B3, BUTTON_LABEL_UP, BUTTON_LABEL_RIGHT, BUTTON_LABEL_DOWN, BUTTON_LABEL_LEFT, BUTTON_LABEL_L2,
+		BUTTON_LABEL_S1, BUTTON_LABEL_S2, BUTTON_LABEL_L3, BUTTON_LABEL_R3, BUTTON_LABEL_A1, BUTTON_LABEL_A2,
+	};
+
+	buttonPositions.clear();
+	for (int i = 0; i < 18; i++)
+		buttonPositions.emplace(labels[i], i);
+}
+
+static vector<Run> listRuns()
+{
+	vector<Run> runs;
+	for (int layout = BUTTON_LAYOUT_ARCADE; layout <= BUTTON_LAYOUT_WASD; layout++)
+	{
+		string prefix = string(layoutNames[layout]) + "-";
+		for (uint8_t color = 0; color < colors.size(); color++)
+			runs.push_back({ prefix + "static-" + to_string(color), (ButtonLayout)layout, EFFECT_STATIC_COLOR, color, 0 });
+
+		runs.push_back({ prefix + "rainbow", (ButtonLayout)layout, EFFECT_RAINBOW, 0, 0 });
+		runs.push_back({ prefix + "chase", (ButtonLayout)layout, EFFECT_CHASE, 0, 0 });
+
+		LEDOptions options = { };
+		options.ledLayout = (ButtonLayout)layout;
+		addStaticThemes(options);
+		for (uint8_t theme = 0; theme < ThemeList::Count(); theme++)
+			runs.push_back({ prefix + "theme-" + to_string(theme), (ButtonLayout)layout, EFFECT_STATIC_THEME, 0, theme });
+	}
+
+	return runs;
+}
+
+// Same sequence as LEDModule::configureLEDs()
+static bool configure(const Run &run)
+{
+	LEDOptions ledOptions = { };
+	ledOptions.ledLayout = run.layout;
+	ledOptions.ledsPerButton = 1;
+
+	setupButtonPositions();
+	matrix.setup(createLedButtonLayout(run.layout, 1, buttonPositions.size()), 1);
+
+	// Chains are checked against ArenaSize() before they are configured, so it must never undercount
+	uint16_t ledCount = matrix.getLedCount();
+	LEDArena::Reset();
+	if (!as.Configure(ledCount) || LEDArena::GetUsed() > AnimationStation::ArenaSize(ledCount))
+		return false;
+
+	AnimationOptions options = { };
+	options.baseAnimationIndex = run.effect;
+	options.brightness = 5;
+	options.staticColorIndex = run.colorIndex;
+	options.buttonColorIndex = 1;
+	options.chaseCycleTime = 85;
+	options.rainbowCycleTime = 40;
+	options.themeIndex = run.themeIndex;
+
+	mockNow = 0;
+	AnimationStation::SetClock(mockClock);
+	AnimationStation::ConfigureBrightness(128, 5);
+	AnimationStation::SetOptions(options);
+	addStaticThemes(ledOptions);
+	as.ClearPressed();
+	as.SetMode(run.effect);
+	as.SetMatrix(matrix);
+	as.Invalidate();
+	return true;
+}
+
+// Same as LEDModule::loop(), without the chains
+static void step(int index)
+{
+	uint32_t buttonState = (index >= PRESS_START && index < PRESS_END) ? (GAMEPAD_MASK_DU | GAMEPAD_MASK_B1) : 0;
+	vector<Pixel> pressed;
+	for (auto &row : matrix.pixels)
+		for (auto &pixel : row)
+			if (buttonState & pixel.mask)
+				pressed.push_back(pixel);
+
+	if (pressed.size() > 0)
+		as.HandlePressed(pressed);
+	else
+		as.ClearPressed();
+
+	if (as.Animate())
+		as.ApplyBrightness(frame);
+}
+
+// Each LED is a cell at its column and row in the matrix, split into stripes when a button has several
+static vector<RGB> drawImage(int width, int height)
+{
+	vector<RGB> image(width * height, ColorBlack);
+	for (size_t c = 0; c < matrix.pixels.size(); c++)
+	{
+		for (size_t r = 0; r < matrix.pixels[c].size(); r++)
+		{
+			const Pixel &pixel = matrix.pixels[c][r];
+			if (pixel.index == NO_PIXEL.index || pixel.positions.empty())
+				continue;
+
+			int stripe = (CELL_SIZE - 2) / pixel.positions.size();
+			for (size_t p = 0; p < pixel.positions.size(); p++)
+			{
+				RGB color = as.frame[pixel.positions[p]];
+				for (int y = 1; y < CELL_SIZE - 1; y++)
+					for (int x = 1 + p * stripe; x < 1 + (int)(p + 1) * stripe; x++)
+						image[(r * CELL_SIZE + y) * width + c * CELL_SIZE + x] = color;
+			}
+		}
+	}
+
+	return image;
+}
+
+// FNV-1a over the wire format of every frame, which is what the chains would be sent
+static Render render(const Run &run, bool keepImages)
+{
+	Render result = { 2166136261u, { }, 0, 0 };
+	if (!configure(run))
+		return result;
+
+	size_t rows = 0;
+	for (auto &column : matrix.pixels)
+		rows = max(rows, column.size());
+
+	result.width = matrix.pixels.size() * CELL_SIZE;
+	result.height = rows * CELL_SIZE;
+	memset(frame, 0, sizeof(frame));
+
+	for (int i = 0; i < FRAME_COUNT; i++)
+	{
+		mockNow = i * FRAME_INTERVAL_MS;
+		step(i);
+
+		const uint8_t *bytes = reinterpret_cast<const uint8_t *>(frame);
+		for (size_t b = 0; b < as.ledCount * sizeof(uint32_t); b++)
+			result.hash = (result.hash ^ bytes[b]) * 16777619u;
+
+		if (keepImages)
+			result.images.push_back(drawImage(result.width, result.height));
+	}
+
+	return result;
+}
+
+// Every effect on a layout without any LEDs, which has to draw nothing rather than fault
+static bool renderEmpty()
+{
+	for (uint8_t effect = 0; effect < TOTAL_EFFECTS; effect++)
+	{
+		matrix.setup({ }, 1);
+		LEDArena::Reset();
+		if (!as.Configure(0))
+			return false;
+
+		as.SetMode(effect);
+		as.SetMatrix(matrix);
+		as.Invalidate();
+		for (int i = 0; i < FRAME_COUNT; i++)
+		{
+			mockNow = i * FRAME_INTERVAL_MS;
+			step(i);
+		}
+	}
+
+	return true;
+}
+
+static void writePPM(const string &path, const vector<RGB> &image, int width, int height)
+{
+	FILE *file = fopen(path.c_str(), "wb");
+	if (file == nullptr)
+		return;
+
+	fprintf(file, "P6\n%d %d\n255\n", width, height);
+	for (auto &color : image)
+	{
+		uint8_t rgb[3] = { color.r, color.g, color.b };
+		fwrite(rgb, 1, 3, file);
+	}
+
+	fclose(file);
+}
+
+struct GIFWriter
+{
+	FILE *file;
+	uint8_t block[256];
+	int blockLength = 0;
+	uint32_t bits = 0;
+	int bitCount = 0;
+
+	void flushBlock()
+	{
+		if (blockLength == 0)
+			return;
+
+		fputc(blockLength, file);
+		fwrite(block, 1, blockLength, file);
+		blockLength = 0;
+	}
+
+	void writeCode(uint32_t code, int width)
+	{
+		bits |= code << bitCount;
+		bitCount += width;
+		while (bitCount >= 8)
+		{
+			block[blockLength++] = bits & 0xFF;
+			bits >>= 8;
+			bitCount -= 8;
+			if (blockLength == 255)
+				flushBlock();
+		}
+	}
+
+	void writeShort(uint16_t value)
+	{
+		fputc(value & 0xFF, file);
+		fputc(value >> 8, file);
+	}
+};
+
+/* Animated GIF with a local palette per frame. The LZW stream only ever holds literals, cleared often
+enough that the code width stays at 9 bits, which is larger than it needs to be but trivially correct. */
+static void writeGIF(const string &path, const vector<vector<RGB>> &images, int width, int height)
+{
+	GIFWriter gif;
+	gif.file = fopen(path.c_str(), "wb");
+	if (gif.file == nullptr)
+		return;
+
+	fwrite("GIF89a", 1, 6, gif.file);
+	gif.writeShort(width);
+	gif.writeShort(height);
+	fputc(0, gif.file); // No global palette
+	fputc(0, gif.file);
+	fputc(0, gif.file);
+
+	static const uint8_t loop[] = { 0x21, 0xFF, 0x0B, 'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E', '2', '.', '0', 0x03, 0x01, 0x00, 0x00, 0x00 };
+	fwrite(loop, 1, sizeof(loop), gif.file);
+
+	for (auto &image : images)
+	{
+		vector<RGB> palette;
+		vector<uint8_t> indexes(image.size());
+		for (size_t i = 0; i < image.size(); i++)
+		{
+			size_t p = 0;
+			while (p < palette.size() && palette[p] != image[i])
+				p++;
+
+			if (p == palette.size() && palette.size() < 256)
+				palette.push_back(image[i]);
+
+			indexes[i] = min<size_t>(p, 255);
+		}
+
+		palette.resize(256, ColorBlack);
+
+		static const uint8_t control[] = { 0x21, 0xF9, 0x04, 0x00, FRAME_INTERVAL_MS / 10, 0x00, 0x00, 0x00 };
+		fwrite(control, 1, sizeof(control), gif.file);
+
+		fputc(0x2C, gif.file);
+		gif.writeShort(0);
+		gif.writeShort(0);
+		gif.writeShort(width);
+		gif.writeShort(height);
+		fputc(0x87, gif.file); // Local palette of 256 colors
+		for (auto &color : palette)
+		{
+			fputc(color.r, gif.file);
+			fputc(color.g, gif.file);
+			fputc(color.b, gif.file);
+		}
+
+		fputc(8, gif.file);
+		for (size_t i = 0; i < indexes.size(); i++)
+		{
+			if (i % 250 == 0)
+				gif.writeCode(256, 9); // Clear before the table grows past 9 bit codes
+
+			gif.writeCode(indexes[i], 9);
+		}
+
+		gif.writeCode(257, 9);
+		if (gif.bitCount > 0)
+			gif.writeCode(0, 8 - gif.bitCount);
+
+		gif.flushBlock();
+		fputc(0, gif.file);
+	}
+
+	fputc(0x3B, gif.file);
+	fclose(gif.file);
+}
+
+static map<string, uint32_t> readGolden(const char *path)
+{
+	map<string, uint32_t> golden;
+	FILE *file = fopen(path, "r");
+	if (file == nullptr)
+		return golden;
+
+	char line[256];
+	while (fgets(line, sizeof(line), file))
+	{
+		char name[128];
+		uint32_t hash;
+		if (line[0] != '#' && sscanf(line, "%127s %x", name, &hash) == 2)
+			golden[name] = hash;
+	}
+
+	fclose(file);
+	return golden;
+}
+
+static int bench()
+{
+	static const struct { const char *name; uint8_t effect; } effects[] = {
+		{ "static", EFFECT_STATIC_COLOR },
+		{ "rainbow", EFFECT_RAINBOW },
+		{ "chase", EFFECT_CHASE },
+		{ "theme", EFFECT_STATIC_THEME },
+	};
+
+	const int frames = 200000;
+	printf("%-10s %10s\n", "effect", "ns/frame");
+	for (auto &effect : effects)
+	{
+		Run run = { effect.name, BUTTON_LAYOUT_HITBOX, effect.effect, 2, 0 };
+		if (!configure(run))
+			return 1;
+
+		auto start = chrono::steady_clock::now();
+		for (int i = 0; i < frames; i++)
+		{
+			mockNow = i * FRAME_INTERVAL_MS;
+			step(i % FRAME_COUNT);
+		}
+
+		double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+		printf("%-10s %10.1f\n", effect.name, ns / frames);
+	}
+
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	const char *checkPath = nullptr;
+	const char *updatePath = nullptr;
+	const char *dumpDir = nullptr;
+	bool ppm = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--check") && i + 1 < argc)
+			checkPath = argv[++i];
+		else if (!strcmp(argv[i], "--update") && i + 1 < argc)
+			updatePath = argv[++i];
+		else if (!strcmp(argv[i], "--dump") && i + 1 < argc)
+			dumpDir = argv[++i];
+		else if (!strcmp(argv[i], "--ppm"))
+			ppm = true;
+		else if (!strcmp(argv[i], "--bench"))
+			return bench();
+		else
+		{
+			fprintf(stderr, "usage: %s [--check FILE] [--update FILE] [--dump DIR [--ppm]] [--bench]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	map<string, uint32_t> golden;
+	if (checkPath != nullptr)
+		golden = readGolden(checkPath);
+
+	FILE *update = nullptr;
+	if (updatePath != nullptr)
+	{
+		update = fopen(updatePath, "w");
+		if (update == nullptr)
+		{
+			perror(updatePath);
+			return 1;
+		}
+
+		fprintf(update, "# Hash of every frame sent to the LEDs per run, regenerate with led_render --update\n");
+	}
+
+	int failed = 0;
+	vector<Run> runs = listRuns();
+	for (auto &run : runs)
+	{
+		Render result = render(run, dumpDir != nullptr);
+
+		if (update != nullptr)
+			fprintf(update, "%s %08x\n", run.name.c_str(), result.hash);
+
+		if (checkPath != nullptr)
+		{
+			auto expected = golden.find(run.name);
+			if (expected == golden.end() || expected->second != result.hash)
+			{
+				printf("%-24s FAILED, %08x expected %08x\n", run.name.c_str(), result.hash, expected == golden.end() ? 0 : expected->second);
+				failed++;
+			}
+		}
+
+		if (dumpDir != nullptr)
+		{
+			string base = string(dumpDir) + "/" + run.name;
+			writeGIF(base + ".gif", result.images, result.width, result.height);
+			for (size_t i = 0; ppm && i < result.images.size(); i++)
+			{
+				char suffix[32]; // Room for any frame number a size_t holds
+				snprintf(suffix, sizeof(suffix), "-%04zu.ppm", i);
+				writePPM(base + suffix, result.images[i], result.width, result.height);
+			}
+		}
+	}
+
+	if (update != nullptr)
+		fclose(update);
+
+	if (checkPath != nullptr && !renderEmpty())
+	{
+		printf("%-24s FAILED\n", "empty layout");
+		failed++;
+	}
+
+	printf("%zu runs of %d frames, %d failed\n", runs.size(), FRAME_COUNT, failed);
+	return failed > 0 ? 1 : 0;
+}
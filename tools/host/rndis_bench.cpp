@@ -0,0 +1,533 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+/* Runs lib/rndis/rndis.c between a stand-in for the PC's network adapter and a stand-in for lwIP, so the
+receive slots and the transmit queue can be checked and timed without a board.
+
+The adapter side plays the TAP device on the PC. Every tud_task() offers a number of numbered frames through
+tud_network_recv_cb(), and every frame sent with tud_network_xmit() keeps the endpoint busy for a number of
+tasks. The stack side checks every frame reaching ethernet_input() against the ones the driver accepted, in
+order and byte for byte. It can refuse frames, hold them for a few polls the way TCP keeps out of order
+segments, and answer each one with frames through linkoutput. Held frames are checked again when freed, so a
+slot reused too early shows up.
+
+	rndis_bench           check, then report frames/s and the drop rate against arrivals per poll
+	rndis_bench --check   check only
+*/
+
+#include <chrono>
+#include <deque>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tusb.h"
+#include "lwip/init.h"
+#include "lwip/timeouts.h"
+#include "netif/etharp.h"
+#include "httpd.h"
+#include "rndis.h"
+
+extern "C" {
+#include "server/dhserver.h"
+#include "server/dnserver.h"
+}
+
+using namespace std;
+
+// RNDIS_RX_QUEUE_DEPTH and RNDIS_TX_QUEUE_DEPTH come from CMakeLists.txt, so the driver and the checks agree
+
+#define MIN_FRAME    60
+#define SEQ_OFFSET   14 // Sequence number right after the Ethernet header
+#define PAYLOAD      18
+#define TX_HEAD      54 // Outgoing frames are a chain, headers in one pbuf and the payload in the next
+#define RX_SALT      0x00
+#define TX_SALT      0x5a
+
+struct Scenario
+{
+	const char *name;
+	int frames;          // Offered by the adapter
+	int arrivalsPerTask; // Frames offered in one tud_task()
+	int holdPolls;       // Polls the stack keeps each frame before freeing it
+	int refuseEvery;     // Every Nth frame is refused by ethernet_input(), 0 for none
+	int answers;         // Frames the stack sends back for every one received
+	int endpointBusy;    // Tasks the endpoint stays busy after each frame sent
+	uint16_t frameSize;  // 0 spreads the sizes from MIN_FRAME to the MTU
+	int expectDrops;     // -1 when any number is fine
+	int expectTxPeak;    // 0 when not checked
+};
+
+struct Held
+{
+	struct pbuf *p;
+	uint32_t seq;
+	uint64_t releaseAt;
+};
+
+static const Scenario *scenario;
+static bool checkPayload = true;
+static int failures;
+static struct netif *stackNetif;
+
+// Adapter side
+static int framesLeft;
+static uint32_t rxNextSeq;
+static deque<uint32_t> rxAccepted;
+static uint32_t rxDropped;
+static int busyLeft;
+static uint32_t txExpectedSeq;
+static uint32_t txReceived;
+static uint64_t txBytes;
+static uint8_t wire[CFG_TUD_NET_MTU];
+static uint8_t endpoint[CFG_TUD_NET_MTU];
+
+// Stack side
+static deque<Held> held;
+static uint64_t polls;
+static uint32_t rxHandled;
+static uint64_t rxBytes;
+static uint32_t txNextSeq;
+static int ramPbufsLive;
+static uint8_t gathered[CFG_TUD_NET_MTU];
+
+static void fail(const char *format, ...)
+{
+	if (failures++ >= 10)
+		return;
+
+	va_list args;
+	va_start(args, format);
+	printf("%s: ", scenario->name);
+	vprintf(format, args);
+	printf("\n");
+	va_end(args);
+}
+
+static uint16_t frameSize(uint32_t seq)
+{
+	if (scenario->frameSize)
+		return scenario->frameSize;
+	return MIN_FRAME + (seq * 97) % (CFG_TUD_NET_MTU - MIN_FRAME + 1);
+}
+
+static uint8_t payloadByte(uint32_t seq, int i, uint8_t salt)
+{
+	return (uint8_t)(seq * 31 + i * 7 + salt);
+}
+
+static void writeFrame(uint8_t *dst, uint32_t seq, uint16_t size, uint8_t salt)
+{
+	static const uint8_t adapterMac[6] = {0x02, 0x02, 0x84, 0x6A, 0x96, 0x02};
+	memcpy(dst, salt == RX_SALT ? stackNetif->hwaddr : adapterMac, 6);
+	memcpy(dst + 6, salt == RX_SALT ? adapterMac : stackNetif->hwaddr, 6);
+	dst[12] = 0x08;
+	dst[13] = 0x00;
+	memcpy(dst + SEQ_OFFSET, &seq, sizeof(seq));
+	if (checkPayload)
+	{
+		for (int i = PAYLOAD; i < size; i++)
+			dst[i] = payloadByte(seq, i, salt);
+	}
+}
+
+static bool frameIntact(const uint8_t *src, uint16_t size, uint32_t seq, uint8_t salt)
+{
+	uint32_t got;
+	memcpy(&got, src + SEQ_OFFSET, sizeof(got));
+	if (got != seq || size != frameSize(seq))
+		return false;
+
+	if (checkPayload)
+	{
+		for (int i = PAYLOAD; i < size; i++)
+		{
+			if (src[i] != payloadByte(seq, i, salt))
+				return false;
+		}
+	}
+	return true;
+}
+
+static bool pbufIntact(struct pbuf *p, uint32_t seq, uint8_t salt)
+{
+	uint16_t size = 0;
+	for (struct pbuf *q = p; q; q = q->next)
+	{
+		memcpy(gathered + size, q->payload, q->len);
+		size += q->len;
+	}
+	return size == p->tot_len && frameIntact(gathered, size, seq, salt);
+}
+
+/* TinyUSB, as the PC's adapter sees it */
+
+bool tusb_init(void)
+{
+	return true;
+}
+
+bool tud_ready(void)
+{
+	return true;
+}
+
+void tud_task(void)
+{
+	if (busyLeft)
+		busyLeft--;
+
+	for (int i = 0; i < scenario->arrivalsPerTask && framesLeft; i++, framesLeft--)
+	{
+		uint32_t seq = rxNextSeq++;
+		uint16_t size = frameSize(seq);
+		writeFrame(wire, seq, size, RX_SALT);
+		if (tud_network_recv_cb(wire, size))
+			rxAccepted.push_back(seq);
+		else
+			rxDropped++;
+	}
+}
+
+bool tud_network_can_xmit(void)
+{
+	return !busyLeft;
+}
+
+void tud_network_xmit(void *ref, uint16_t arg)
+{
+	if (busyLeft)
+		fail("tud_network_xmit() while the endpoint is busy");
+
+	uint16_t len = tud_network_xmit_cb(endpoint, ref, arg);
+	if (!frameIntact(endpoint, len, txExpectedSeq, TX_SALT))
+		fail("frame %u was sent damaged or out of order", txExpectedSeq);
+
+	txExpectedSeq++;
+	txReceived++;
+	txBytes += len;
+	busyLeft = scenario->endpointBusy;
+}
+
+void tud_network_recv_renew(void)
+{
+}
+
+/* lwIP, as the driver sees it */
+
+struct pbuf *pbuf_alloced_custom(pbuf_layer l, u16_t length, pbuf_type type, struct pbuf_custom *p, void *payload_mem, u16_t payload_mem_len)
+{
+	(void)l;
+	if (length > payload_mem_len)
+		return NULL;
+
+	p->pbuf.next = NULL;
+	p->pbuf.payload = payload_mem;
+	p->pbuf.tot_len = length;
+	p->pbuf.len = length;
+	p->pbuf.type_internal = type;
+	p->pbuf.flags = PBUF_FLAG_IS_CUSTOM;
+	p->pbuf.ref = 1;
+	return &p->pbuf;
+}
+
+void pbuf_ref(struct pbuf *p)
+{
+	p->ref++;
+}
+
+u8_t pbuf_free(struct pbuf *p)
+{
+	u8_t count = 0;
+	while (p)
+	{
+		if (!p->ref)
+		{
+			fail("pbuf freed twice");
+			break;
+		}
+		if (--p->ref)
+			break;
+
+		struct pbuf *next = p->next;
+		if (p->flags & PBUF_FLAG_IS_CUSTOM)
+		{
+			((struct pbuf_custom *)p)->custom_free_function(p);
+		}
+		else
+		{
+			free(p);
+			ramPbufsLive--;
+		}
+		count++;
+		p = next;
+	}
+	return count;
+}
+
+static struct pbuf *ramPbuf(u16_t len, u16_t totLen)
+{
+	struct pbuf *p = (struct pbuf *)malloc(sizeof(struct pbuf) + len);
+	p->next = NULL;
+	p->payload = p + 1;
+	p->tot_len = totLen;
+	p->len = len;
+	p->type_internal = PBUF_RAM;
+	p->flags = 0;
+	p->ref = 1;
+	ramPbufsLive++;
+	return p;
+}
+
+static void answer()
+{
+	uint32_t seq = txNextSeq++;
+	uint16_t size = frameSize(seq);
+	writeFrame(gathered, seq, size, TX_SALT);
+
+	struct pbuf *p = ramPbuf(TX_HEAD, size);
+	p->next = ramPbuf(size - TX_HEAD, size - TX_HEAD);
+	memcpy(p->payload, gathered, TX_HEAD);
+	memcpy(p->next->payload, gathered + TX_HEAD, size - TX_HEAD);
+
+	if (stackNetif->linkoutput(stackNetif, p) != ERR_OK)
+		fail("linkoutput refused frame %u", seq);
+	pbuf_free(p);
+}
+
+err_t ethernet_input(struct pbuf *p, struct netif *netif)
+{
+	(void)netif;
+	if (rxAccepted.empty())
+	{
+		fail("a frame reached the stack that was never accepted");
+		return ERR_VAL;
+	}
+
+	uint32_t seq = rxAccepted.front();
+	rxAccepted.pop_front();
+	if (!pbufIntact(p, seq, RX_SALT))
+		fail("frame %u reached the stack damaged or out of order", seq);
+	rxHandled++;
+	rxBytes += p->tot_len;
+
+	for (int i = 0; i < scenario->answers; i++)
+		answer();
+
+	// The driver frees what is refused
+	if (scenario->refuseEvery && rxHandled % scenario->refuseEvery == 0)
+		return ERR_MEM;
+
+	if (scenario->holdPolls)
+		held.push_back({p, seq, polls + scenario->holdPolls});
+	else
+		pbuf_free(p);
+	return ERR_OK;
+}
+
+void sys_check_timeouts(void)
+{
+	polls++;
+	while (!held.empty() && held.front().releaseAt <= polls)
+	{
+		if (!pbufIntact(held.front().p, held.front().seq, RX_SALT))
+			fail("frame %u was overwritten while the stack held it", held.front().seq);
+		pbuf_free(held.front().p);
+		held.pop_front();
+	}
+}
+
+void lwip_init(void)
+{
+}
+
+struct netif *netif_add(struct netif *netif, const ip_addr_t *ipaddr, const ip_addr_t *netmask, const ip_addr_t *gw,
+	void *state, netif_init_fn init, netif_input_fn input)
+{
+	(void)ipaddr;
+	(void)netmask;
+	(void)gw;
+	(void)input;
+
+	netif->state = state;
+	if (init(netif) != ERR_OK)
+		return NULL;
+	stackNetif = netif;
+	return netif;
+}
+
+void netif_set_default(struct netif *netif)
+{
+	(void)netif;
+}
+
+err_t ip_input(struct pbuf *p, struct netif *inp)
+{
+	(void)inp;
+	pbuf_free(p);
+	return ERR_OK;
+}
+
+err_t etharp_output(struct netif *netif, struct pbuf *q, const ip_addr_t *ipaddr)
+{
+	(void)ipaddr;
+	return netif->linkoutput(netif, q);
+}
+
+err_t dhserv_init(const dhcp_config_t *config)
+{
+	(void)config;
+	return ERR_OK;
+}
+
+err_t dnserv_init(const ip_addr_t *bind, uint16_t port, dns_query_proc_t query_proc)
+{
+	(void)bind;
+	(void)port;
+	(void)query_proc;
+	return ERR_OK;
+}
+
+void httpd_init(void)
+{
+}
+
+/* Runs one scenario until every frame was offered, then until the stack let go of what it held and the
+transmit queue emptied */
+static void run(const Scenario &s)
+{
+	scenario = &s;
+	framesLeft = s.frames;
+	rxNextSeq = 0;
+	rxDropped = 0;
+	rxHandled = 0;
+	rxBytes = 0;
+	txNextSeq = 0;
+	txExpectedSeq = 0;
+	txReceived = 0;
+	txBytes = 0;
+
+	while (framesLeft)
+		rndis_task();
+
+	for (int i = 0; i < 1000 && (!held.empty() || txReceived < txNextSeq || busyLeft); i++)
+		rndis_task();
+}
+
+static void checkScenario(const Scenario &s)
+{
+	struct rndis_stats before = *rndis_get_stats();
+	run(s);
+	const struct rndis_stats *after = rndis_get_stats();
+
+	uint32_t accepted = after->rx_frames - before.rx_frames;
+	uint32_t dropped = after->rx_dropped - before.rx_dropped;
+	uint32_t sent = after->tx_frames - before.tx_frames;
+
+	if (!rxAccepted.empty())
+		fail("%u accepted frames never reached the stack", (unsigned)rxAccepted.size());
+	if (!held.empty())
+		fail("%u frames still held by the stack", (unsigned)held.size());
+	if (accepted + dropped != (uint32_t)s.frames)
+		fail("%u frames offered, the driver counted %u accepted and %u dropped", s.frames, accepted, dropped);
+	if (dropped != rxDropped || accepted != rxHandled)
+		fail("the driver counted %u accepted and %u dropped, the stack saw %u and the adapter %u dropped", accepted, dropped, rxHandled, rxDropped);
+	if (sent != txNextSeq || txReceived != txNextSeq)
+		fail("the stack sent %u frames, the driver counted %u and the adapter received %u", txNextSeq, sent, txReceived);
+	if (ramPbufsLive)
+		fail("%d pbufs are still referenced", ramPbufsLive);
+	if (s.expectDrops >= 0 && dropped != (uint32_t)s.expectDrops)
+		fail("%u frames dropped, expected %d", dropped, s.expectDrops);
+	if (s.expectTxPeak && after->tx_queue_peak != s.expectTxPeak)
+		fail("transmit queue peaked at %u, expected %d", after->tx_queue_peak, s.expectTxPeak);
+
+	printf("%-14s %8d %8u %8u %8u %8u\n", s.name, s.frames, accepted, dropped, sent, after->tx_queue_peak);
+
+	// A full burst right after must find every receive slot free again
+	Scenario probe = { s.name, RNDIS_RX_QUEUE_DEPTH, RNDIS_RX_QUEUE_DEPTH, 0, 0, 0, 0, 0, -1, 0 };
+	run(probe);
+	if (rxDropped)
+		fail("%u receive slots were not returned", rxDropped);
+}
+
+static int check()
+{
+	// With six frames per poll and four slots, two of every six are dropped. Holding each frame for four
+	// polls keeps every slot in use without a drop, as long as a slot is back the moment its pbuf is freed.
+	static const Scenario scenarios[] = {
+		// name            frames  arrivals  hold  refuse  answers  busy  size  drops  tx peak
+		{ "steady",          2000,        1,    0,      0,       1,    0,    0,     0,  0 },
+		{ "burst",           3000,        6,    0,      0,       0,    0,    0,  1000,  0 },
+		{ "held",            2000,        1,    4,      0,       0,    0,    0,     0,  0 },
+		{ "refused",         2000,        2,    0,      3,       1,    0,    0,     0,  0 },
+		{ "slow endpoint",   2000,        1,    0,      0,       2,    3,    0,    -1,  RNDIS_TX_QUEUE_DEPTH },
+	};
+
+	checkPayload = true;
+	printf("%-14s %8s %8s %8s %8s %8s\n", "scenario", "offered", "accepted", "dropped", "sent", "tx peak");
+	for (const Scenario &s : scenarios)
+		checkScenario(s);
+
+	printf("%d failures\n", failures);
+	return failures;
+}
+
+static void printStats(const char *when, const struct rndis_stats *stats)
+{
+	printf("rndis_get_stats %-6s rx %u frames, %u dropped, tx %u frames, queue peaks rx %u tx %u\n", when,
+		stats->rx_frames, stats->rx_dropped, stats->tx_frames, stats->rx_queue_peak, stats->tx_queue_peak);
+}
+
+// Full size frames both ways as fast as the driver takes them, then the drop rate as frames arrive faster
+static void bench()
+{
+	checkPayload = false;
+
+	Scenario stream = { "stream", 200000, 1, 0, 0, 1, 0, CFG_TUD_NET_MTU, -1, 0 };
+	struct rndis_stats before = *rndis_get_stats();
+	auto start = chrono::steady_clock::now();
+	run(stream);
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	printStats("before", &before);
+	printStats("after", rndis_get_stats());
+	printf("%u frames in, %u out: %.0f frames/s, %.1f MB/s through the driver\n", rxHandled, txReceived,
+		(rxHandled + txReceived) / seconds, (rxBytes + txBytes) / seconds / 1e6);
+
+	static const int holds[] = { 0, 2, 4 };
+	printf("\n%-14s", "arrivals/poll");
+	for (int hold : holds)
+		printf("   hold %d", hold);
+	printf("   (dropped, %d receive slots)\n", RNDIS_RX_QUEUE_DEPTH);
+
+	for (int arrivals = 1; arrivals <= 8; arrivals++)
+	{
+		printf("%-14d", arrivals);
+		for (int hold : holds)
+		{
+			Scenario load = { "load", 20000, arrivals, hold, 0, 0, 0, 0, -1, 0 };
+			run(load);
+			printf(" %7.1f%%", rxDropped * 100.0 / load.frames);
+		}
+		printf("\n");
+	}
+}
+
+int main(int argc, char **argv)
+{
+	bool checkOnly = argc > 1 && !strcmp(argv[1], "--check");
+
+	rndis_init();
+
+	if (check() != 0)
+		return 1;
+
+	if (!checkOnly)
+		bench();
+
+	return 0;
+}
@@ -0,0 +1,9 @@
+#ifndef HOST_COMMON_H_
+#define HOST_COMMON_H_
+
+// Arduino style helpers that come from MPG on the device and are used by OneBitDisplay
+
+#define HIGH 1
+#define LOW  0
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef HOST_GAMEPAD_ENUMS_H_
+#define HOST_GAMEPAD_ENUMS_H_
+
+// The MPG enums, with the same values as the library
+
+typedef enum
+{
+	INPUT_MODE_XINPUT,
+	INPUT_MODE_SWITCH,
+	INPUT_MODE_HID,
+	INPUT_MODE_CONFIG = 255,
+} InputMode;
+
+typedef enum
+{
+	DPAD_MODE_DIGITAL,
+	DPAD_MODE_LEFT_ANALOG,
+	DPAD_MODE_RIGHT_ANALOG,
+} DpadMode;
+
+typedef enum
+{
+	SOCD_MODE_UP_PRIORITY,
+	SOCD_MODE_NEUTRAL,
+	SOCD_MODE_SECOND_INPUT_PRIORITY,
+} SOCDMode;
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef HOST_GAMEPAD_STORAGE_H_
+#define HOST_GAMEPAD_STORAGE_H_
+
+// Implemented by src/storage.cpp, as on the device
+
+#include <stdint.h>
+#include "GamepadEnums.h"
+
+struct GamepadOptions
+{
+	InputMode inputMode;
+	DpadMode dpadMode;
+	SOCDMode socdMode;
+	uint32_t checksum;
+};
+
+class GamepadStorage
+{
+	public:
+		void start();
+		void save();
+
+		GamepadOptions getGamepadOptions();
+		void setGamepadOptions(GamepadOptions options);
+};
+
+static GamepadStorage GamepadStore;
+
+#endif
@@ -0,0 +1,39 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: Copyright (c) 2021 Jason Skuby (mytechtoybox.com)
+ */
+
+#ifndef HOST_MPG_H_
+#define HOST_MPG_H_
+
+// The parts of MPG the host tools need, with the same values as the library
+
+#include <stdint.h>
+
+#define GAMEPAD_MASK_UP    (1U << 0)
+#define GAMEPAD_MASK_DOWN  (1U << 1)
+#define GAMEPAD_MASK_LEFT  (1U << 2)
+#define GAMEPAD_MASK_RIGHT (1U << 3)
+
+#define GAMEPAD_MASK_B1    (1U << 0)
+#define GAMEPAD_MASK_B2    (1U << 1)
+#define GAMEPAD_MASK_B3    (1U << 2)
+#define GAMEPAD_MASK_B4    (1U << 3)
+#define GAMEPAD_MASK_L1    (1U << 4)
+#define GAMEPAD_MASK_R1    (1U << 5)
+#define GAMEPAD_MASK_L2    (1U << 6)
+#define GAMEPAD_MASK_R2    (1U << 7)
+#define GAMEPAD_MASK_S1    (1U << 8)
+#define GAMEPAD_MASK_S2    (1U << 9)
+#define GAMEPAD_MASK_L3    (1U << 10)
+#define GAMEPAD_MASK_R3    (1U << 11)
+#define GAMEPAD_MASK_A1    (1U << 12)
+#define GAMEPAD_MASK_A2    (1U << 13)
+
+// The LEDs see the dpad shifted above the buttons
+#define GAMEPAD_MASK_DU    (1UL << 16)
+#define GAMEPAD_MASK_DD    (1UL << 17)
+#define GAMEPAD_MASK_DL    (1UL << 18)
+#define GAMEPAD_MASK_DR    (1UL << 19)
+
+#endif
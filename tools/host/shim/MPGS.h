@@ -0,0 +1,44 @@
+#ifndef HOST_MPGS_H_
+#define HOST_MPGS_H_
+
+// The parts of MPG's gamepad the firmware headers use, the input handling itself isn't built for the host
+
+#include <stdint.h>
+#include "MPG.h"
+#include "GamepadEnums.h"
+#include "GamepadStorage.h"
+
+#define GAMEPAD_JOYSTICK_MID 0x7FFF
+
+struct GamepadState
+{
+	uint8_t dpad;
+	uint16_t buttons;
+	uint16_t aux;
+	uint16_t lx;
+	uint16_t ly;
+	uint16_t rx;
+	uint16_t ry;
+	uint8_t lt;
+	uint8_t rt;
+};
+
+class MPGS
+{
+	public:
+		MPGS(int debounceMS, GamepadStorage *storage) : debounceMS(debounceMS), storage(storage) { }
+
+		GamepadState state = { };
+		GamepadOptions options = { };
+		const int debounceMS;
+
+		void load() { options = storage->getGamepadOptions(); }
+		void save() { storage->setGamepadOptions(options); storage->save(); }
+		void process() { }
+		bool pressedF1() { return false; }
+
+	protected:
+		GamepadStorage *storage;
+};
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef HOST_HARDWARE_FLASH_H_
+#define HOST_HARDWARE_FLASH_H_
+
+// Addresses and sizes, the tools that simulate flash define the functions
+
+#ifndef _u
+#define _u(x) x ## u
+#endif
+
+#define XIP_BASE _u(0x10000000)
+
+#define FLASH_PAGE_SIZE   (1u << 8)
+#define FLASH_SECTOR_SIZE (1u << 12)
+#define FLASH_BLOCK_SIZE  (1u << 16)
+
+#include <stddef.h>
+#include <stdint.h>
+
+void flash_range_erase(uint32_t flash_offs, size_t count);
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count);
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef HOST_HARDWARE_GPIO_H_
+#define HOST_HARDWARE_GPIO_H_
+
+// There are no pins on the host, writes are dropped and reads are high like an idle pull-up
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define NUM_BANK0_GPIOS 30
+
+#define GPIO_OUT 1
+#define GPIO_IN  0
+
+enum gpio_function
+{
+	GPIO_FUNC_SPI = 1,
+	GPIO_FUNC_UART = 2,
+	GPIO_FUNC_I2C = 3,
+	GPIO_FUNC_SIO = 5,
+	GPIO_FUNC_NULL = 0x1F,
+};
+
+static inline void gpio_init(unsigned pin) { (void)pin; }
+static inline void gpio_set_dir(unsigned pin, bool out) { (void)pin; (void)out; }
+static inline void gpio_put(unsigned pin, bool value) { (void)pin; (void)value; }
+static inline bool gpio_get(unsigned pin) { (void)pin; return true; }
+static inline void gpio_pull_up(unsigned pin) { (void)pin; }
+static inline void gpio_set_function(unsigned pin, enum gpio_function fn) { (void)pin; (void)fn; }
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef HOST_HARDWARE_I2C_H_
+#define HOST_HARDWARE_I2C_H_
+
+// I2C blocks that accept every transfer and read back zeros
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef struct i2c_inst { int index; } i2c_inst_t;
+
+static i2c_inst_t i2c0_inst = { 0 };
+static i2c_inst_t i2c1_inst = { 1 };
+#define i2c0 (&i2c0_inst)
+#define i2c1 (&i2c1_inst)
+
+static inline unsigned i2c_hw_index(i2c_inst_t *i2c) { return i2c->index; }
+static inline unsigned i2c_init(i2c_inst_t *i2c, unsigned baudrate) { (void)i2c; return baudrate; }
+
+static inline int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop)
+{
+	(void)i2c; (void)addr; (void)src; (void)nostop;
+	return (int)len;
+}
+
+static inline int i2c_read_blocking(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop)
+{
+	(void)i2c; (void)addr; (void)nostop;
+	memset(dst, 0, len);
+	return (int)len;
+}
+
+#endif
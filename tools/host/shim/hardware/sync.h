@@ -0,0 +1,18 @@
+#ifndef HOST_HARDWARE_SYNC_H_
+#define HOST_HARDWARE_SYNC_H_
+
+// Single threaded on the host, there is nothing to mask
+
+#include <stdint.h>
+
+static inline uint32_t save_and_disable_interrupts() { return 0; }
+static inline void restore_interrupts(uint32_t status) { (void)status; }
+
+typedef volatile uint32_t spin_lock_t;
+
+static inline spin_lock_t *spin_lock_instance(unsigned int lock_num) { static spin_lock_t locks[32]; return &locks[lock_num]; }
+static inline int spin_lock_claim_unused(bool required) { (void)required; return 0; }
+static inline uint32_t spin_lock_blocking(spin_lock_t *lock) { (void)lock; return 0; }
+static inline void spin_unlock(spin_lock_t *lock, uint32_t saved_irq) { (void)lock; (void)saved_irq; }
+
+#endif
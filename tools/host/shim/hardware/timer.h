@@ -0,0 +1,6 @@
+#ifndef HOST_HARDWARE_TIMER_H_
+#define HOST_HARDWARE_TIMER_H_
+
+#include "pico/time.h"
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef HOST_HARDWARE_WATCHDOG_H_
+#define HOST_HARDWARE_WATCHDOG_H_
+
+// Nothing to reboot on the host
+
+#include <stdint.h>
+
+#define SRAM_END 0x20042000
+
+static inline void watchdog_reboot(uint32_t pc, uint32_t sp, uint32_t delayMS) { (void)pc; (void)sp; (void)delayMS; }
+
+#endif
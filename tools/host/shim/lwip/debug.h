@@ -0,0 +1,9 @@
+#ifndef HOST_LWIP_DEBUG_H_
+#define HOST_LWIP_DEBUG_H_
+
+#include <stdlib.h>
+
+#define LWIP_ASSERT(message, assertion) do { if (!(assertion)) abort(); } while (0)
+#define LWIP_DEBUGF(debug, message) do { } while (0)
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef HOST_LWIP_DEF_H_
+#define HOST_LWIP_DEF_H_
+
+#include <string.h>
+#include "lwip/opt.h"
+
+#define LWIP_UNUSED_ARG(x) (void)x
+#define LWIP_MIN(x, y)     (((x) < (y)) ? (x) : (y))
+#define LWIP_MAX(x, y)     (((x) > (y)) ? (x) : (y))
+#define MEMCPY(dst, src, len) memcpy(dst, src, len)
+
+#endif
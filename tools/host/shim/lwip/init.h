@@ -0,0 +1,14 @@
+#ifndef HOST_LWIP_INIT_H_
+#define HOST_LWIP_INIT_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void lwip_init(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef HOST_LWIP_IP_ADDR_H_
+#define HOST_LWIP_IP_ADDR_H_
+
+// IPv4 only, as the firmware is built
+
+#include "lwip/opt.h"
+
+typedef struct ip_addr
+{
+	u32_t addr;
+} ip_addr_t;
+
+#define IPADDR4_INIT_BYTES(a, b, c, d) \
+	{ ((u32_t)((d) & 0xff) << 24) | ((u32_t)((c) & 0xff) << 16) | ((u32_t)((b) & 0xff) << 8) | (u32_t)((a) & 0xff) }
+
+#endif
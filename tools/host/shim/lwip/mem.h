@@ -0,0 +1,12 @@
+#ifndef HOST_LWIP_MEM_H_
+#define HOST_LWIP_MEM_H_
+
+#include <stdlib.h>
+#include "lwip/opt.h"
+
+typedef u16_t mem_size_t;
+
+static inline void *mem_malloc(mem_size_t size) { return malloc(size); }
+static inline void mem_free(void *mem) { free(mem); }
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef HOST_LWIP_MEMP_H_
+#define HOST_LWIP_MEMP_H_
+
+// The pools /api/getStats reports, in no particular order
+
+typedef enum
+{
+	MEMP_TCP_PCB,
+	MEMP_TCP_SEG,
+	MEMP_PBUF,
+	MEMP_PBUF_POOL,
+	MEMP_MAX,
+} memp_t;
+
+#endif
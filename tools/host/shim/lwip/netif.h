@@ -0,0 +1,49 @@
+#ifndef HOST_LWIP_NETIF_H_
+#define HOST_LWIP_NETIF_H_
+
+// The fields and calls a network driver uses, the host tools play the stack
+
+#include "lwip/err.h"
+#include "lwip/ip_addr.h"
+#include "lwip/pbuf.h"
+
+#define NETIF_FLAG_UP        0x01U
+#define NETIF_FLAG_BROADCAST 0x02U
+#define NETIF_FLAG_LINK_UP   0x04U
+#define NETIF_FLAG_ETHARP    0x08U
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct netif;
+
+typedef err_t (*netif_init_fn)(struct netif *netif);
+typedef err_t (*netif_input_fn)(struct pbuf *p, struct netif *inp);
+typedef err_t (*netif_output_fn)(struct netif *netif, struct pbuf *p, const ip_addr_t *ipaddr);
+typedef err_t (*netif_linkoutput_fn)(struct netif *netif, struct pbuf *p);
+
+struct netif
+{
+	netif_output_fn output;
+	netif_linkoutput_fn linkoutput;
+	void *state;
+	u16_t mtu;
+	u8_t hwaddr[6];
+	u8_t hwaddr_len;
+	u8_t flags;
+	char name[2];
+};
+
+struct netif *netif_add(struct netif *netif, const ip_addr_t *ipaddr, const ip_addr_t *netmask, const ip_addr_t *gw,
+	void *state, netif_init_fn init, netif_input_fn input);
+void netif_set_default(struct netif *netif);
+err_t ip_input(struct pbuf *p, struct netif *inp);
+
+#define netif_is_up(netif) (((netif)->flags & NETIF_FLAG_UP) ? (u8_t)1 : (u8_t)0)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
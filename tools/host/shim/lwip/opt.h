@@ -0,0 +1,17 @@
+#ifndef HOST_LWIP_OPT_H_
+#define HOST_LWIP_OPT_H_
+
+// The firmware's lwIP options, so the httpd headers see the same configuration as on the device
+
+#include <stdint.h>
+#include "lwipopts.h"
+#include "lwip/debug.h"
+
+typedef uint8_t  u8_t;
+typedef int8_t   s8_t;
+typedef uint16_t u16_t;
+typedef int16_t  s16_t;
+typedef uint32_t u32_t;
+typedef int32_t  s32_t;
+
+#endif
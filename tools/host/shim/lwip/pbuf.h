@@ -0,0 +1,58 @@
+#ifndef HOST_LWIP_PBUF_H_
+#define HOST_LWIP_PBUF_H_
+
+// Only what the httpd callbacks and the RNDIS driver touch. The host tools allocate pbufs themselves and count what is freed.
+
+#include "lwip/opt.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum
+{
+	PBUF_TRANSPORT,
+	PBUF_IP,
+	PBUF_LINK,
+	PBUF_RAW_TX,
+	PBUF_RAW,
+} pbuf_layer;
+
+typedef enum
+{
+	PBUF_RAM,
+	PBUF_ROM,
+	PBUF_REF,
+	PBUF_POOL,
+} pbuf_type;
+
+#define PBUF_FLAG_IS_CUSTOM 0x02U
+
+struct pbuf
+{
+	struct pbuf *next;
+	void *payload;
+	u16_t tot_len;
+	u16_t len;
+	u8_t type_internal;
+	u8_t flags;
+	u16_t ref;
+};
+
+typedef void (*pbuf_free_custom_fn)(struct pbuf *p);
+
+struct pbuf_custom
+{
+	struct pbuf pbuf;
+	pbuf_free_custom_fn custom_free_function;
+};
+
+u8_t pbuf_free(struct pbuf *p);
+void pbuf_ref(struct pbuf *p);
+struct pbuf *pbuf_alloced_custom(pbuf_layer l, u16_t length, pbuf_type type, struct pbuf_custom *p, void *payload_mem, u16_t payload_mem_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef HOST_LWIP_STATS_H_
+#define HOST_LWIP_STATS_H_
+
+#include "lwip/mem.h"
+#include "lwip/memp.h"
+
+struct stats_mem
+{
+	const char *name;
+	u16_t err;
+	mem_size_t avail;
+	mem_size_t used;
+	mem_size_t max;
+	u16_t illegal;
+};
+
+struct stats_
+{
+	struct stats_mem mem;
+	struct stats_mem *memp[MEMP_MAX];
+};
+
+extern struct stats_ lwip_stats;
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef HOST_LWIP_SYS_H_
+#define HOST_LWIP_SYS_H_
+
+#include "lwip/opt.h"
+#include "arch/cc.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+sys_prot_t sys_arch_protect(void);
+void sys_arch_unprotect(sys_prot_t pval);
+u32_t sys_now(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
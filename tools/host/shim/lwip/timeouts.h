@@ -0,0 +1,16 @@
+#ifndef HOST_LWIP_TIMEOUTS_H_
+#define HOST_LWIP_TIMEOUTS_H_
+
+#include "lwip/sys.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void sys_check_timeouts(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef HOST_LWIP_UDP_H_
+#define HOST_LWIP_UDP_H_
+
+// Nothing of UDP is used, the DHCP and DNS servers aren't built for the host
+
+#include "lwip/ip_addr.h"
+#include "lwip/pbuf.h"
+
+#endif
@@ -0,0 +1,7 @@
+#ifndef HOST_PICO_BINARY_INFO_H_
+#define HOST_PICO_BINARY_INFO_H_
+
+#define bi_decl(...)
+#define bi_2pins_with_func(...)
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef HOST_PICO_LOCK_CORE_H_
+#define HOST_PICO_LOCK_CORE_H_
+
+// Nothing to lock between cores on the host, the spin locks and RAM function markers come along like in the SDK
+
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+
+#endif
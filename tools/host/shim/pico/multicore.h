@@ -0,0 +1,9 @@
+#ifndef HOST_PICO_MULTICORE_H_
+#define HOST_PICO_MULTICORE_H_
+
+// There is no second core on the host, lockouts return straight away
+
+static inline void multicore_lockout_start_blocking() { }
+static inline void multicore_lockout_end_blocking() { }
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef HOST_PICO_STDLIB_H_
+#define HOST_PICO_STDLIB_H_
+
+// The subset of the Pico SDK the firmware sources use, enough to build them for the host
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "pico/time.h"
+#include "hardware/gpio.h"
+
+#define __not_in_flash_func(name) name
+#define __time_critical_func(name) name
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef HOST_PICO_TIME_H_
+#define HOST_PICO_TIME_H_
+
+// Pico SDK timer functions on the host's monotonic clock
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+typedef uint64_t absolute_time_t;
+
+static inline absolute_time_t get_absolute_time(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static inline uint64_t time_us_64(void) { return get_absolute_time(); }
+static inline uint32_t time_us_32(void) { return (uint32_t)get_absolute_time(); }
+static inline uint32_t to_ms_since_boot(absolute_time_t t) { return (uint32_t)(t / 1000); }
+static inline absolute_time_t make_timeout_time_ms(uint32_t ms) { return get_absolute_time() + (uint64_t)ms * 1000; }
+static inline absolute_time_t make_timeout_time_us(uint64_t us) { return get_absolute_time() + us; }
+static inline bool time_reached(absolute_time_t t) { return get_absolute_time() >= t; }
+
+static inline void sleep_us(uint64_t us) { (void)us; }
+static inline void sleep_ms(uint32_t ms) { (void)ms; }
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef HOST_TUSB_H_
+#define HOST_TUSB_H_
+
+// TinyUSB's device and network class calls as lib/rndis uses them, the host tools play the USB side
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "pico/time.h"
+
+#define CFG_TUD_NET_MTU 1514 // A full Ethernet frame, as in the firmware
+#define TU_ARRAY_SIZE(_arr) (sizeof(_arr) / sizeof(_arr[0]))
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+bool tusb_init(void);
+bool tud_ready(void);
+void tud_task(void);
+
+bool tud_network_can_xmit(void);
+void tud_network_xmit(void *ref, uint16_t arg);
+void tud_network_recv_renew(void);
+
+// Implemented by the network driver
+bool tud_network_recv_cb(const uint8_t *src, uint16_t size);
+uint16_t tud_network_xmit_cb(uint8_t *dst, void *ref, uint16_t arg);
+void tud_network_init_cb(void);
+extern const uint8_t tud_network_mac_address[6];
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
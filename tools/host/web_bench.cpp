@@ -0,0 +1,767 @@
+/*
+ * SPDX-License-Identifier: MIT
+ */
+
+/* Runs the webserver's handlers off-device, behind the real fs.c, making the calls lwIP's httpd makes for
+each request: fs_open() for a GET, and httpd_post_begin(), httpd_post_receive_data() with pbuf chains and
+httpd_post_finished() followed by fs_open() for a POST. Settings go through the real storage.cpp into a RAM
+copy of FlashPROM's cache. The firmware upload is only checksummed, nothing is staged.
+
+The check replays scripted requests and compares the answers: every route, set/get round trips, bodies
+split over many pbufs, an oversized body, a second POST while one is open, a connection that closes
+halfway through its body, and a firmware upload. Every response has to carry a Content-Length that
+matches its body, every pbuf handed over has to be freed, and no request may allocate from the heap.
+
+The benchmark replays a weighted mix of the requests the configurator makes and reports the time and the
+heap high-water mark of each route, requests per second overall and the peak use of the JSON document.
+
+	web_bench                  check, then benchmark
+	web_bench --check          check only
+	web_bench --requests N     benchmark with N requests (default 20000)
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <new>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include <ArduinoJson.h>
+#include "CRC32.h"
+#include "FlashPROM.h"
+#include "httpd/httpd.h"
+
+// fs.c is built as C and its header has no linkage block
+extern "C" {
+#include "httpd/fs.h"
+}
+#include "lwip/pbuf.h"
+#include "lwip/stats.h"
+#include "rndis/rndis.h"
+
+#include "gamepad.h"
+#include "storage.h"
+#include "leds.h"
+#include "firmware_update.h"
+
+using namespace std;
+
+#define RESPONSE_URI_LEN 63 // LWIP_HTTPD_POST_MAX_RESPONSE_URI_LEN
+#define TCP_SEGMENT      1460
+#define PBUF_SIZE        512
+
+/*************************
+ * Heap tracking
+ *************************/
+
+// Every allocation carries its size, so the bytes live at any point are known
+static size_t heapLive = 0;
+static size_t heapPeak = 0;
+static size_t serverHeapPeak = 0;
+
+void *operator new(size_t size)
+{
+	size_t *block = (size_t *)malloc(size + sizeof(max_align_t));
+	if (block == nullptr)
+		throw bad_alloc();
+
+	*block = size;
+	heapLive += size;
+	heapPeak = max(heapPeak, heapLive);
+	return (uint8_t *)block + sizeof(max_align_t);
+}
+
+void operator delete(void *ptr) noexcept
+{
+	if (ptr == nullptr)
+		return;
+
+	size_t *block = (size_t *)((uint8_t *)ptr - sizeof(max_align_t));
+	heapLive -= *block;
+	free(block);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+	operator delete(ptr);
+}
+
+// Wraps each call into the webserver, so only what it allocates counts and not the copies kept here
+struct ServerCall
+{
+	size_t base;
+
+	ServerCall() : base(heapLive) { heapPeak = heapLive; }
+	~ServerCall() { serverHeapPeak = max(serverHeapPeak, heapPeak - base); }
+};
+
+/*************************
+ * Firmware stand-ins
+ *************************/
+
+// The cache is all there is, commits are only counted
+uint8_t FlashPROM::cache[EEPROM_SIZE_BYTES] = { };
+uint32_t FlashPROM::eraseCount = 0;
+uint32_t FlashPROM::programCount = 0;
+uint32_t FlashPROM::lastStallUS = 0;
+uint32_t FlashPROM::maxStallUS = 0;
+static int commits = 0;
+
+void FlashPROM::start() { }
+void FlashPROM::commit() { commits++; }
+void FlashPROM::reset() { memset(cache, 0, EEPROM_SIZE_BYTES); commit(); }
+void FlashPROM::poll(bool idle) { (void)idle; }
+bool FlashPROM::isBusy() { return false; }
+
+// The upload is checksummed as it arrives, the CRC stands in for the one of the staged image
+FirmwareUpdate firmwareUpdate;
+
+void FirmwareUpdate::begin(uint32_t contentLength)
+{
+	(void)contentLength;
+	state = FIRMWARE_RECEIVING;
+	error = nullptr;
+	size = 0;
+	crc = 0;
+	applyPending = false;
+}
+
+void FirmwareUpdate::write(const uint8_t *data, size_t length)
+{
+	crc = CRC32::checksum(data, length, crc);
+	size += length;
+}
+
+bool FirmwareUpdate::finish()
+{
+	if (state != FIRMWARE_RECEIVING)
+		return false;
+
+	state = FIRMWARE_STAGED;
+	return true;
+}
+
+bool FirmwareUpdate::apply(uint32_t expectedCRC)
+{
+	applyPending = (state == FIRMWARE_STAGED && expectedCRC == crc);
+	return applyPending;
+}
+
+void FirmwareUpdate::poll() { }
+
+Gamepad gamepad;
+LEDModule ledModule;
+static int ledConfigures = 0;
+
+void LEDModule::setup() { }
+void LEDModule::loop() { }
+void LEDModule::process(Gamepad *gamepad) { (void)gamepad; }
+void LEDModule::configureLEDs() { ledConfigures++; }
+
+static struct rndis_stats rndisStats = { };
+
+const struct rndis_stats *rndis_get_stats(void)
+{
+	return &rndisStats;
+}
+
+static struct stats_mem poolStats[MEMP_MAX] = { };
+struct stats_ lwip_stats = { { "mem", 0, MEM_SIZE, 0, 0, 0 }, { &poolStats[0], &poolStats[1], &poolStats[2], &poolStats[3] } };
+
+/*************************
+ * lwIP stand-ins
+ *************************/
+
+static int pbufsLive = 0;
+
+// One allocation per pbuf, the payload follows the header the way PBUF_RAM lays it out
+static struct pbuf *pbufChain(const char *data, size_t length, size_t pbufSize)
+{
+	struct pbuf *head = nullptr;
+	struct pbuf **next = &head;
+	size_t remaining = length;
+
+	while (remaining > 0)
+	{
+		size_t len = min(remaining, pbufSize);
+		struct pbuf *p = (struct pbuf *)malloc(sizeof(struct pbuf) + len);
+		memset(p, 0, sizeof(struct pbuf));
+		p->payload = (uint8_t *)p + sizeof(struct pbuf);
+		p->len = len;
+		p->tot_len = remaining;
+		p->ref = 1;
+		memcpy(p->payload, data, len);
+
+		lwip_stats.mem.used += sizeof(struct pbuf) + len;
+		lwip_stats.mem.max = max(lwip_stats.mem.max, lwip_stats.mem.used);
+		pbufsLive++;
+
+		*next = p;
+		next = &p->next;
+		data += len;
+		remaining -= len;
+	}
+
+	return head;
+}
+
+u8_t pbuf_free(struct pbuf *p)
+{
+	u8_t count = 0;
+	while (p != nullptr && --p->ref == 0)
+	{
+		struct pbuf *next = p->next;
+		lwip_stats.mem.used -= sizeof(struct pbuf) + p->len;
+		pbufsLive--;
+		free(p);
+		p = next;
+		count++;
+	}
+
+	return count;
+}
+
+/*************************
+ * httpd
+ *************************/
+
+struct Response
+{
+	int status = 0;
+	string contentType;
+	string body;
+};
+
+// What httpd keeps per connection for a POST
+struct Connection
+{
+	uint32_t contentLeft = 0;
+};
+
+// http_find_file(): the response is copied out, HTTP_IS_DATA_VOLATILE makes lwIP copy RAM files too
+static Response findFile(const char *uri)
+{
+	Response response;
+	struct fs_file file = { };
+	err_t err;
+
+	{
+		ServerCall call;
+		err = fs_open(&file, uri);
+	}
+	if (err != ERR_OK)
+	{
+		response.status = 404;
+		return response;
+	}
+
+	string raw(file.data, file.len);
+	{
+		ServerCall call;
+		fs_close(&file);
+	}
+
+	size_t headerEnd = raw.find("\r\n\r\n");
+	if (!(file.http_header_included & FS_FILE_FLAGS_HEADER_INCLUDED) || raw.compare(0, 9, "HTTP/1.1 ") || headerEnd == string::npos)
+		return response;
+
+	string header = raw.substr(0, headerEnd + 2);
+	response.status = atoi(raw.c_str() + 9);
+	response.body = raw.substr(headerEnd + 4);
+
+	size_t type = header.find("Content-Type: ");
+	if (type != string::npos)
+		response.contentType = header.substr(type + 14, header.find("\r\n", type) - type - 14);
+
+	// Keep-alive depends on it, a wrong length stalls the next request on the connection
+	size_t length = header.find("Content-Length: ");
+	if (length == string::npos || (size_t)atoi(header.c_str() + length + 16) != response.body.size())
+		response.status = -1;
+
+	return response;
+}
+
+static Response get(const char *uri)
+{
+	return findFile(uri);
+}
+
+// http_post_request(): returns true when the response is already known
+static bool postBegin(Connection &conn, const char *uri, size_t contentLength, Response &response)
+{
+	char responseUri[RESPONSE_URI_LEN + 1] = "";
+	u8_t autoWindow = 1;
+
+	if (contentLength == 0)
+	{
+		response.status = 400;
+		return true;
+	}
+
+	err_t err;
+	{
+		ServerCall call;
+		err = httpd_post_begin(&conn, uri, "", 0, contentLength, responseUri, sizeof(responseUri), &autoWindow);
+	}
+	if (err != ERR_OK)
+	{
+		response = findFile(responseUri);
+		return true;
+	}
+
+	conn.contentLeft = contentLength;
+	return false;
+}
+
+// http_post_rxpbuf() with http_handle_post_finished()
+static bool postData(Connection &conn, const char *data, size_t length, size_t pbufSize, Response &response)
+{
+	char responseUri[RESPONSE_URI_LEN + 1];
+
+	struct pbuf *p = pbufChain(data, length, pbufSize);
+	err_t err;
+
+	conn.contentLeft -= min<size_t>(conn.contentLeft, length);
+	{
+		ServerCall call;
+		err = httpd_post_receive_data(&conn, p);
+	}
+	if (err == ERR_OK && conn.contentLeft > 0)
+		return false;
+
+	responseUri[0] = '\0';
+	{
+		ServerCall call;
+		httpd_post_finished(&conn, responseUri, sizeof(responseUri));
+	}
+	response = findFile(responseUri);
+	return true;
+}
+
+// http_close_or_abort_conn()
+static void closeConnection(Connection &conn)
+{
+	char responseUri[RESPONSE_URI_LEN + 1];
+
+	if (conn.contentLeft != 0)
+	{
+		ServerCall call;
+		responseUri[0] = '\0';
+		httpd_post_finished(&conn, responseUri, sizeof(responseUri));
+	}
+}
+
+// A whole POST on its own connection, the body arrives in TCP segments of pbuf chains
+static Response post(const char *uri, const string &body, size_t segment = TCP_SEGMENT, size_t pbufSize = PBUF_SIZE)
+{
+	Connection conn;
+	Response response;
+
+	if (!postBegin(conn, uri, body.size(), response))
+	{
+		for (size_t offset = 0; offset < body.size(); offset += segment)
+		{
+			if (postData(conn, body.data() + offset, min(segment, body.size() - offset), pbufSize, response))
+				break;
+		}
+	}
+
+	closeConnection(conn);
+	return response;
+}
+
+/*************************
+ * Setup
+ *************************/
+
+static GamepadButtonMapping *mappings[PROFILE_PIN_COUNT];
+
+// What Gamepad::setup() and LEDModule::setup() load from storage at boot
+static void boot()
+{
+	BoardOptions options = getBoardOptions();
+	uint8_t pins[PROFILE_PIN_COUNT] =
+	{
+		options.pinDpadUp,   options.pinDpadDown, options.pinDpadLeft, options.pinDpadRight,
+		options.pinButtonB1, options.pinButtonB2, options.pinButtonB3, options.pinButtonB4,
+		options.pinButtonL1, options.pinButtonR1, options.pinButtonL2, options.pinButtonR2,
+		options.pinButtonS1, options.pinButtonS2, options.pinButtonL3, options.pinButtonR3,
+		options.pinButtonA1, options.pinButtonA2,
+	};
+
+	for (int i = 0; i < PROFILE_PIN_COUNT; i++)
+		mappings[i] = new GamepadButtonMapping(pins[i], 1 << i);
+
+	gamepad.gamepadMappings = mappings;
+	gamepad.load();
+
+	LEDOptions &ledOptions = ledModule.ledOptions;
+	ledOptions = getLEDOptions();
+	if (!ledOptions.useUserDefinedLEDs)
+	{
+		ledOptions.dataPin = BOARD_LEDS_PIN;
+		ledOptions.ledFormat = LED_FORMAT;
+		ledOptions.ledLayout = BUTTON_LAYOUT;
+		ledOptions.ledsPerButton = LEDS_PER_PIXEL;
+		ledOptions.ledCount = LED_COUNT;
+		ledOptions.brightnessMaximum = LED_BRIGHTNESS_MAXIMUM;
+		ledOptions.brightnessSteps = LED_BRIGHTNESS_STEPS;
+		ledOptions.chainPins[0] = LED_CHAIN1_PIN;
+		ledOptions.chainPins[1] = LED_CHAIN2_PIN;
+		ledOptions.chainPins[2] = LED_CHAIN3_PIN;
+		for (int *index = &ledOptions.indexUp; index <= &ledOptions.indexA2; index++)
+			*index = -1;
+	}
+}
+
+/*************************
+ * Check
+ *************************/
+
+static int failed = 0;
+
+#define EXPECT(condition, ...) \
+	do { \
+		if (!(condition)) \
+		{ \
+			failed++; \
+			printf("FAILED: "); \
+			printf(__VA_ARGS__); \
+			printf("\n"); \
+		} \
+	} while (0)
+
+static DynamicJsonDocument parse(const Response &response)
+{
+	DynamicJsonDocument doc(8192);
+	deserializeJson(doc, response.body.c_str(), response.body.size());
+	return doc;
+}
+
+static string serialize(const JsonDocument &doc)
+{
+	char buffer[4096];
+	size_t length = serializeJson(doc, buffer, sizeof(buffer));
+	return string(buffer, length);
+}
+
+// The body of a GET, checked for status and type on the way
+static string getJson(const char *uri)
+{
+	Response response = get(uri);
+	EXPECT(response.status == 200 && response.contentType == "application/json", "GET %s returned %d %s", uri, response.status, response.contentType.c_str());
+	return response.body;
+}
+
+static void checkRoutes()
+{
+	const char *apiRoutes[] =
+	{
+		"/api/getConfig", "/api/getDisplayOptions", "/api/getGamepadOptions", "/api/getLedOptions",
+		"/api/getPinMappings", "/api/getStats",
+	};
+
+	for (const char *uri : apiRoutes)
+	{
+		DynamicJsonDocument doc(8192);
+		string body = getJson(uri);
+		EXPECT(!deserializeJson(doc, body.c_str(), body.size()) && doc.is<JsonObject>(), "GET %s is not a JSON object: %s", uri, body.c_str());
+	}
+
+	Response page = get("/pin-mapping");
+	EXPECT(page.status == 200 && page.contentType == "text/html" && page.body == "<html></html>", "SPA route did not serve index.html");
+
+	Response asset = get("/static/js/main.js");
+	EXPECT(asset.status == 200 && asset.contentType == "application/javascript", "static file returned %d", asset.status);
+
+	EXPECT(get("/api/unknown").status == 404, "unknown API route was served");
+	EXPECT(get("/css").status == 404, "static prefix was served as a file");
+	EXPECT(post("/api/getConfig", "{}").status == 404, "POST to a GET route was accepted");
+	EXPECT(post("/api/unknown", "{}").status == 404, "POST to an unknown route was accepted");
+
+	ledModule.framesShown = 120;
+	ledModule.framesSkipped = 3;
+	DynamicJsonDocument stats = parse(get("/api/getStats"));
+	EXPECT(stats["leds"]["framesShown"].as<int>() == 120 && stats["leds"]["framesSkipped"].as<int>() == 3,
+		"getStats did not report the LED frame counters");
+}
+
+// Each set endpoint has to answer 200, commit, and be read back by its get endpoint
+static void checkRoundTrip(const char *setUri, const char *getUri, const char *body, const char *field, long long expected)
+{
+	int before = commits;
+	Response response = post(setUri, body);
+	EXPECT(response.status == 200, "POST %s returned %d", setUri, response.status);
+	EXPECT(commits > before, "POST %s did not save", setUri);
+
+	DynamicJsonDocument doc(8192);
+	string read = getJson(getUri);
+	deserializeJson(doc, read.c_str(), read.size());
+	EXPECT(doc[field].as<long long>() == expected, "%s did not read back %s = %lld: %s", getUri, field, expected, read.c_str());
+}
+
+static void checkRoundTrips()
+{
+	checkRoundTrip("/api/setGamepadOptions", "/api/getGamepadOptions", "{\"dpadMode\":1,\"inputMode\":1,\"socdMode\":2}", "socdMode", 2);
+	checkRoundTrip("/api/setDisplayOptions", "/api/getDisplayOptions",
+		"{\"enabled\":1,\"sdaPin\":0,\"sclPin\":1,\"i2cAddress\":60,\"i2cBlock\":0,\"i2cSpeed\":400000,\"flipDisplay\":1,\"invertDisplay\":0}",
+		"flipDisplay", 1);
+
+	// Swaps Up and Down
+	string pins = getJson("/api/getPinMappings");
+	DynamicJsonDocument doc(8192);
+	deserializeJson(doc, pins.c_str(), pins.size());
+	int up = doc["Up"], down = doc["Down"];
+	doc["Up"] = down;
+	doc["Down"] = up;
+	checkRoundTrip("/api/setPinMappings", "/api/getPinMappings", serialize(doc).c_str(), "Up", down);
+	EXPECT(gamepad.gamepadMappings[0]->pin == down, "setPinMappings was not applied to the gamepad");
+
+	string leds = getJson("/api/getLedOptions");
+	deserializeJson(doc, leds.c_str(), leds.size());
+	doc["dataPin"] = 22;
+	doc["brightnessMaximum"] = 100;
+	int configures = ledConfigures;
+	checkRoundTrip("/api/setLedOptions", "/api/getLedOptions", serialize(doc).c_str(), "brightnessMaximum", 100);
+	EXPECT(ledConfigures > configures, "setLedOptions did not reconfigure the LEDs");
+}
+
+static void checkConfig()
+{
+	string config = getJson("/api/getConfig");
+
+	// Written back as read, then again split over 7 byte pbufs in 100 byte segments
+	Response whole = post("/api/setConfig", config);
+	Response split = post("/api/setConfig", config, 100, 7);
+	EXPECT(whole.status == 200 && parse(whole)["success"] == true, "setConfig rejected getConfig: %s", whole.body.c_str());
+	EXPECT(split.status == 200 && split.body == whole.body, "setConfig split over pbufs answered %s", split.body.c_str());
+	EXPECT(getJson("/api/getConfig") == config, "setConfig changed the config it was given");
+
+	// Rejected as a whole, nothing is changed
+	DynamicJsonDocument doc(8192);
+	deserializeJson(doc, config.c_str(), config.size());
+	doc["pins"]["B1"] = doc["pins"]["B2"].as<int>();
+	doc["gamepad"]["socdMode"] = 0;
+	Response rejected = post("/api/setConfig", serialize(doc));
+	EXPECT(rejected.status == 200 && parse(rejected)["success"] == false && parse(rejected)["error"].as<const char *>() != nullptr,
+		"setConfig accepted a pin mapped twice: %s", rejected.body.c_str());
+	EXPECT(getJson("/api/getConfig") == config, "a rejected setConfig changed the config");
+
+	// Out of range values are rejected the same way
+	static const struct { const char *section; const char *field; long value; } outOfRange[] = {
+		{ "display", "i2cSpeed",        0 },
+		{ "led",     "brightnessSteps", 0 },
+		{ "led",     "ledsPerButton",   0 },
+		{ "led",     "ledCount",        65535 },
+	};
+	for (const auto &field : outOfRange)
+	{
+		deserializeJson(doc, config.c_str(), config.size());
+		doc[field.section][field.field] = field.value;
+		rejected = post("/api/setConfig", serialize(doc));
+		EXPECT(parse(rejected)["success"] == false, "setConfig accepted %s = %ld: %s", field.field, field.value, rejected.body.c_str());
+	}
+
+	// Chain lengths that only overflow once summed, through setLedOptions
+	string leds = getJson("/api/getLedOptions");
+	deserializeJson(doc, leds.c_str(), leds.size());
+	doc["ledCount"] = 65535;
+	doc["chains"][0]["pin"] = 28;
+	doc["chains"][0]["length"] = 2;
+	rejected = post("/api/setLedOptions", serialize(doc));
+	EXPECT(parse(rejected)["success"] == false, "setLedOptions accepted 65537 LEDs: %s", rejected.body.c_str());
+	EXPECT(getJson("/api/getConfig") == config, "a rejected setLedOptions changed the config");
+
+	// More than the POST buffer holds, the handler sees an empty body
+	string oversized = config;
+	oversized.insert(oversized.size() - 1, ",\"padding\":\"" + string(3000, 'x') + "\"");
+	Response overflow = post("/api/setConfig", oversized);
+	EXPECT(overflow.status == 200 && parse(overflow)["success"] == false, "oversized setConfig answered %d %s", overflow.status, overflow.body.c_str());
+	EXPECT(getJson("/api/getConfig") == config, "an oversized setConfig changed the config");
+}
+
+// A second POST while one is open is turned away, GETs are still served
+static void checkConcurrentPosts()
+{
+	const string body = "{\"dpadMode\":2,\"inputMode\":0,\"socdMode\":1}";
+	const size_t half = body.size() / 2;
+	Connection first, second;
+	Response response;
+
+	EXPECT(!postBegin(first, "/api/setGamepadOptions", body.size(), response), "first POST was answered at once");
+	EXPECT(!postData(first, body.data(), half, PBUF_SIZE, response), "first POST was answered before its body was complete");
+
+	EXPECT(postBegin(second, "/api/setLedOptions", 2, response), "second POST was accepted while the first was open");
+	EXPECT(response.status == 503 && parse(response)["success"] == false, "second POST answered %d %s", response.status, response.body.c_str());
+	closeConnection(second);
+
+	getJson("/api/getPinMappings");
+
+	EXPECT(postData(first, body.data() + half, body.size() - half, PBUF_SIZE, response), "first POST was not answered");
+	EXPECT(response.status == 200 && response.body == body, "first POST answered %d %s", response.status, response.body.c_str());
+	closeConnection(first);
+	EXPECT(gamepad.options.dpadMode == DPAD_MODE_RIGHT_ANALOG, "first POST was not applied");
+}
+
+// A connection that closes halfway through its body releases the POST, and nothing is applied
+static void checkAbortedPost()
+{
+	const string body = "{\"dpadMode\":0,\"inputMode\":0,\"socdMode\":0}";
+	Connection conn;
+	Response response;
+
+	EXPECT(!postBegin(conn, "/api/setGamepadOptions", body.size(), response), "POST was answered at once");
+	EXPECT(!postData(conn, body.data(), body.size() / 2, PBUF_SIZE, response), "POST was answered before its body was complete");
+	closeConnection(conn);
+	EXPECT(gamepad.options.dpadMode == DPAD_MODE_RIGHT_ANALOG, "an aborted POST was applied");
+
+	response = post("/api/setGamepadOptions", "{\"dpadMode\":0,\"inputMode\":0,\"socdMode\":1}");
+	EXPECT(response.status == 200, "POST after an aborted one answered %d", response.status);
+	EXPECT(gamepad.options.dpadMode == DPAD_MODE_DIGITAL, "POST after an aborted one was not applied");
+}
+
+static void checkFirmwareUpload()
+{
+	string image(96 * 1024, '\0');
+	uint32_t seed = 1;
+	for (char &c : image)
+	{
+		seed = seed * 1103515245 + 12345;
+		c = seed >> 16;
+	}
+	uint32_t crc = CRC32::checksum(image.data(), image.size());
+
+	Response staged = post("/api/firmware", image);
+	DynamicJsonDocument doc = parse(staged);
+	EXPECT(staged.status == 200 && doc["success"] == true, "firmware upload answered %d %s", staged.status, staged.body.c_str());
+	EXPECT(doc["size"].as<size_t>() == image.size() && doc["crc"].as<uint32_t>() == crc, "firmware upload staged the wrong data: %s", staged.body.c_str());
+
+	char body[64];
+	snprintf(body, sizeof(body), "{\"crc\":%u}", crc ^ 1);
+	EXPECT(parse(post("/api/applyFirmware", body))["success"] == false, "applyFirmware accepted the wrong CRC");
+	snprintf(body, sizeof(body), "{\"crc\":%u}", crc);
+	EXPECT(parse(post("/api/applyFirmware", body))["success"] == true, "applyFirmware rejected the staged CRC");
+}
+
+static int check()
+{
+	serverHeapPeak = 0;
+
+	checkRoutes();
+	checkRoundTrips();
+	checkConfig();
+	checkConcurrentPosts();
+	checkAbortedPost();
+	checkFirmwareUpload();
+
+	EXPECT(pbufsLive == 0, "%d pbufs were not freed", pbufsLive);
+	EXPECT(serverHeapPeak == 0, "requests allocated up to %zu bytes from the heap", serverHeapPeak);
+
+	printf("web handlers: %d failed\n", failed);
+	return failed;
+}
+
+/*************************
+ * Benchmark
+ *************************/
+
+struct BenchRoute
+{
+	const char *uri;
+	int weight;
+	bool isPost;
+	string body = { };
+	vector<double> times = { };
+	size_t heapUsed = 0;
+};
+
+// Roughly what opening each page of the configurator does, plus a save now and then
+static void bench(int requests)
+{
+	vector<BenchRoute> routes =
+	{
+		{ "/api/getPinMappings",    8, false },
+		{ "/api/getGamepadOptions", 6, false },
+		{ "/api/getLedOptions",     4, false },
+		{ "/api/getDisplayOptions", 4, false },
+		{ "/api/getConfig",         2, false },
+		{ "/api/getStats",          2, false },
+		{ "/pin-mapping",           2, false },
+		{ "/static/js/main.js",     2, false },
+		{ "/api/setGamepadOptions", 1, true, getJson("/api/getGamepadOptions") },
+		{ "/api/setConfig",         1, true, getJson("/api/getConfig") },
+	};
+
+	vector<BenchRoute *> mix;
+	for (BenchRoute &route : routes)
+	{
+		mix.insert(mix.end(), route.weight, &route);
+		route.times.reserve(requests);
+	}
+
+	uint32_t seed = 1;
+	auto start = chrono::steady_clock::now();
+	for (int i = 0; i < requests; i++)
+	{
+		seed = seed * 1103515245 + 12345;
+		BenchRoute *route = mix[(seed >> 16) % mix.size()];
+
+		serverHeapPeak = 0;
+		auto requestStart = chrono::steady_clock::now();
+		Response response = route->isPost ? post(route->uri, route->body) : get(route->uri);
+		route->times.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - requestStart).count());
+		route->heapUsed = max(route->heapUsed, serverHeapPeak);
+
+		if (response.status != 200)
+		{
+			printf("%s returned %d\n", route->uri, response.status);
+			return;
+		}
+	}
+
+	double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	printf("%-26s %8s %10s %10s %10s %10s\n", "route", "requests", "p50 us", "p99 us", "max us", "heap peak");
+	for (BenchRoute &route : routes)
+	{
+		if (route.times.empty())
+			continue;
+
+		sort(route.times.begin(), route.times.end());
+		printf("%-26s %8zu %10.2f %10.2f %10.2f %10zu\n", route.uri, route.times.size(),
+			route.times[route.times.size() / 2], route.times[route.times.size() * 99 / 100], route.times.back(), route.heapUsed);
+	}
+
+	DynamicJsonDocument stats = parse(get("/api/getStats"));
+	printf("\n%d requests in %.3f s, %.0f requests/s\n", requests, elapsed, requests / elapsed);
+	printf("pbuf peak %d bytes, JSON document peak %d of %d bytes\n",
+		stats["heap"]["peak"].as<int>(), stats["json"]["peak"].as<int>(), stats["json"]["size"].as<int>());
+}
+
+int main(int argc, char **argv)
+{
+	bool checkOnly = false;
+	int requests = 20000;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--check"))
+			checkOnly = true;
+		else if (!strcmp(argv[i], "--requests") && i + 1 < argc)
+			requests = atoi(argv[++i]);
+	}
+
+	boot();
+
+	if (check() != 0)
+		return 1;
+
+	if (!checkOnly)
+		bench(requests);
+
+	return 0;
+}
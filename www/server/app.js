@@ -38,76 +38,184 @@ app.get('/api/resetSettings', (req, res) => {
 	return res.send({ success: true });
 });
 
+const displayOptions = {
+	enabled: 1,
+	sdaPin: 0,
+	sclPin: 1,
+	i2cAddress: 0x3D,
+	i2cBlock: 0,
+	i2cSpeed: 400000,
+	flipDisplay: 0,
+	invertDisplay: 1,
+};
+
+const gamepadOptions = {
+	dpadMode: 0,
+	inputMode: 1,
+	socdMode: 2,
+};
+
+const ledOptions = {
+	brightnessMaximum: 255,
+	brightnessSteps: 5,
+	dataPin: 15,
+	ledFormat: 0,
+	ledLayout: 1,
+	ledsPerButton: 2,
+	ledCount: 0,
+	chains: [
+		{ pin: -1, length: 0 },
+		{ pin: -1, length: 0 },
+		{ pin: -1, length: 0 },
+	],
+	ledButtonMap: {
+		Up: 3,
+		Down: 1,
+		Left: 0,
+		Right: 2,
+		B1: 8,
+		B2: 9,
+		B3: 4,
+		B4: 5,
+		L1: 7,
+		R1: 6,
+		L2: 11,
+		R2: 10,
+		S1: null,
+		S2: null,
+		L3: null,
+		R3: null,
+		A1: null,
+		A2: null,
+	},
+};
+
+function getUsedPins() {
+	let usedPins = [];
+	for (let prop of Object.keys(controllers['pico']))
+		if (!isNaN(parseInt(controllers['pico'][prop])))
+			usedPins.push(parseInt(controllers['pico'][prop]));
+
+	return usedPins;
+}
+
+function getPinMappings() {
+	let mappings = { ...baseButtonMappings };
+	for (let prop of Object.keys(controllers['pico'])) {
+		if (mappings[prop])
+			mappings[prop] = parseInt(controllers['pico'][prop]);
+	}
+
+	return mappings;
+}
+
 app.get('/api/getDisplayOptions', (req, res) => {
 	console.log('/api/getDisplayOptions');
-	return res.send({
-		enabled: 1,
-		sdaPin: 0,
-		sclPin: 1,
-		i2cAddress: '0x3D',
-		i2cBlock: 0,
-		i2cSpeed: 400000,
-		flipDisplay: 0,
-		invertDisplay: 1,
-	});
+	return res.send({ ...displayOptions, usedPins: getUsedPins() });
 });
 
 app.get('/api/getGamepadOptions', (req, res) => {
 	console.log('/api/getGamepadOptions');
-	return res.send({
-		dpadMode: 0,
-		inputMode: 1,
-		socdMode: 2,
-	});
+	return res.send(gamepadOptions);
 });
 
 app.get('/api/getLedOptions', (req, res) => {
 	console.log('/api/getLedOptions');
-	let usedPins = [];
-	for (let prop of Object.keys(controllers['pico']))
-		if (!isNaN(parseInt(controllers['pico'][prop])))
-			usedPins.push(parseInt(controllers['pico'][prop]));
+	return res.send({ ...ledOptions, usedPins: getUsedPins() });
+});
 
+app.get('/api/getPinMappings', (req, res) => {
+	console.log('/api/getPinMappings');
+	return res.send(getPinMappings());
+});
+
+app.get('/api/getConfig', (req, res) => {
+	console.log('/api/getConfig');
 	return res.send({
-		brightnessMaximum: 255,
-		brightnessSteps: 5,
-		dataPin: 15,
-		ledFormat: 0,
-		ledLayout: 1,
-		ledsPerButton: 2,
-		ledButtonMap: {
-			Up: 3,
-			Down: 1,
-			Left: 0,
-			Right: 2,
-			B1: 8,
-			B2: 9,
-			B3: 4,
-			B4: 5,
-			L1: 7,
-			R1: 6,
-			L2: 11,
-			R2: 10,
-			S1: null,
-			S2: null,
-			L3: null,
-			R3: null,
-			A1: null,
-			A2: null,
-		},
-		usedPins,
+		version: 1,
+		display: displayOptions,
+		gamepad: gamepadOptions,
+		led: ledOptions,
+		pins: getPinMappings(),
 	});
 });
 
-app.get('/api/getPinMappings', (req, res) => {
-	console.log('/api/getPinMappings');
-	let mappings = { ...baseButtonMappings };
-	for (let prop of Object.keys(controllers['pico'])) {
-		if (mappings[prop])
-			mappings[prop] = parseInt(controllers['pico'][prop]);
+app.post('/api/setConfig', (req, res) => {
+	console.log('/api/setConfig');
+	if (req.body.version !== 1)
+		return res.send({ success: false, error: 'Unsupported config version' });
+
+	const pins = Object.values(req.body.pins || {});
+	if (new Set(pins).size !== pins.length)
+		return res.send({ success: false, error: 'Pin mapped more than once' });
+
+	const { display = {}, led = {} } = req.body;
+	if (!(display.i2cSpeed >= 10000 && display.i2cSpeed <= 1000000))
+		return res.send({ success: false, error: 'Invalid I2C speed' });
+	if (!(led.ledsPerButton >= 1) || !(led.brightnessSteps >= 1 && led.brightnessSteps <= 10))
+		return res.send({ success: false, error: 'Invalid LED options' });
+
+	return res.send({ success: true });
+});
+
+app.get('/api/getStats', (req, res) => {
+	console.log('/api/getStats');
+	return res.send({
+		heap: { size: 16384, used: 0, peak: 0, errors: 0 },
+		pools: { tcpPcb: 0, tcpSeg: 0, pbuf: 0, pbufPool: 0 },
+		json: { size: 3072, peak: 0 },
+		link: { rxFrames: 0, rxDropped: 0, txFrames: 0, rxQueuePeak: 0, txQueuePeak: 0 },
+		leds: { framesShown: 0, framesSkipped: 0 },
+		flashStallPeakUS: 0,
+	});
+});
+
+function crc32(bytes) {
+	let crc = 0xFFFFFFFF;
+	for (const byte of bytes) {
+		crc ^= byte;
+		for (let k = 0; k < 8; k++)
+			crc = (crc & 1) ? (0xEDB88320 ^ (crc >>> 1)) : (crc >>> 1);
+	}
+	return (crc ^ 0xFFFFFFFF) >>> 0;
+}
+
+// Stages nothing, but answers with the size and CRC the controller would report for the same UF2 file
+let stagedFirmware = null;
+app.post('/api/firmware', express.raw({ type: '*/*', limit: '4mb' }), (req, res) => {
+	console.log('/api/firmware');
+	const body = req.body;
+	stagedFirmware = null;
+	if (!Buffer.isBuffer(body) || body.length === 0 || body.length % 512 !== 0)
+		return res.send({ success: false, error: 'Not a UF2 file' });
+
+	const blocks = [];
+	for (let offset = 0; offset < body.length; offset += 512) {
+		if (body.readUInt32LE(offset) !== 0x0A324655 || body.readUInt32LE(offset + 508) !== 0x0AB16F30)
+			return res.send({ success: false, error: 'Not a UF2 file' });
+		if (body.readUInt32LE(offset + 8) & 1)
+			continue;
+		if (body.readUInt32LE(offset + 28) !== 0xE48BFF56)
+			return res.send({ success: false, error: 'Not an RP2040 image' });
+		blocks.push({ target: body.readUInt32LE(offset + 12) - 0x10000000, data: body.subarray(offset + 32, offset + 32 + 256) });
 	}
 
-	return res.send(mappings);
+	if (!blocks.some((block) => block.target === 0))
+		return res.send({ success: false, error: 'Image does not start at the beginning of flash' });
+
+	const size = Math.max(...blocks.map((block) => block.target + 256));
+	const image = Buffer.alloc(size, 0xFF);
+	blocks.forEach((block) => block.data.copy(image, block.target));
+	stagedFirmware = { size, crc: crc32(image) };
+	return res.send({ success: true, ...stagedFirmware });
+});
+
+app.post('/api/applyFirmware', (req, res) => {
+	console.log('/api/applyFirmware');
+	if (!stagedFirmware || req.body.crc !== stagedFirmware.crc)
+		return res.send({ success: false, error: 'CRC does not match the staged firmware' });
+
+	return res.send({ success: true });
 });
 
 app.post('/api/*', (req, res) => {
@@ -115,6 +223,26 @@ app.post('/api/*', (req, res) => {
 	return res.send(req.body);
 })
 
+app.get('/api/inputStream', (req, res) => {
+	console.log('/api/inputStream');
+	res.set({
+		'Content-Type': 'text/event-stream',
+		'Cache-Control': 'no-cache',
+	});
+	res.flushHeaders();
+
+	// Walks a press through the buttons and a finger along the touch bar
+	let step = 0;
+	const timer = setInterval(() => {
+		const button = step % 14;
+		const touch = step % 24;
+		res.write(`data:${(1 << button).toString(16)},0,0,${(1 << touch).toString(16)},${touch},-1,8000,8000,8000,8000,0,0\n\n`);
+		step++;
+	}, 100);
+
+	req.on('close', () => clearInterval(timer));
+});
+
 app.listen(port, () => {
   console.log(`Example app listening at http://localhost:${port}`)
 });
@@ -0,0 +1,65 @@
+import React, { useState } from 'react';
+import { Button, Form, ProgressBar } from 'react-bootstrap';
+import WebApi from '../Services/WebApi';
+import { readUf2 } from '../Services/Uf2';
+
+const toHex = (crc) => '0x' + crc.toString(16).padStart(8, '0');
+
+// Stages a UF2 file on the controller, then applies it once the controller's CRC matches the file's
+export default function FirmwareUpload() {
+	const [file, setFile] = useState(null);
+	const [progress, setProgress] = useState(null);
+	const [message, setMessage] = useState('');
+	const [busy, setBusy] = useState(false);
+
+	const upload = async (e) => {
+		e.preventDefault();
+		e.stopPropagation();
+
+		let image;
+		try {
+			image = readUf2(await file.arrayBuffer());
+		}
+		catch (err) {
+			setMessage(err.message);
+			return;
+		}
+
+		setBusy(true);
+		setMessage('Uploading...');
+		setProgress(0);
+
+		const staged = await WebApi.uploadFirmware(file, setProgress);
+		if (!staged.success) {
+			setMessage(`Upload failed: ${staged.error}`);
+			setBusy(false);
+			return;
+		}
+		if (staged.size !== image.size || staged.crc !== image.crc) {
+			setMessage(`Upload corrupted, the controller staged ${toHex(staged.crc)} but the file is ${toHex(image.crc)}. Try again.`);
+			setBusy(false);
+			return;
+		}
+
+		const applied = await WebApi.applyFirmware(image.crc);
+		if (!applied.success) {
+			setMessage(`Update failed: ${applied.error}`);
+			setBusy(false);
+			return;
+		}
+
+		setMessage('Firmware verified, the controller is updating and will restart. Do not unplug it for a few seconds.');
+	};
+
+	return (
+		<Form onSubmit={upload}>
+			<Form.Group className="mb-3">
+				<Form.Label>Update Firmware (.uf2)</Form.Label>
+				<Form.Control type="file" accept=".uf2" disabled={busy} onChange={(e) => setFile(e.target.files[0])} />
+			</Form.Group>
+			{progress !== null ? <ProgressBar className="mb-3" now={Math.round(progress * 100)} label={`${Math.round(progress * 100)}%`} /> : null}
+			<Button type="submit" disabled={!file || busy}>Update</Button>
+			{message ? <span className="alert">{message}</span> : null}
+		</Form>
+	);
+}
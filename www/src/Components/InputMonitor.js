@@ -0,0 +1,72 @@
+import React, { useEffect, useState } from 'react';
+import WebApi from '../Services/WebApi';
+import './InputMonitor.scss';
+
+// Masks from the MPG GamepadState
+const dpadMasks = { Up: 0x01, Down: 0x02, Left: 0x04, Right: 0x08 };
+const buttonMasks = {
+	B1: 0x0001, B2: 0x0002, B3: 0x0004, B4: 0x0008,
+	L1: 0x0010, R1: 0x0020, L2: 0x0040, R2: 0x0080,
+	S1: 0x0100, S2: 0x0200, L3: 0x0400, R3: 0x0800,
+	A1: 0x1000, A2: 0x2000,
+};
+
+const TOUCH_COUNT = 32;
+
+export function isPressed(state, button) {
+	if (!state)
+		return false;
+	if (dpadMasks[button])
+		return (state.dpad & dpadMasks[button]) !== 0;
+	return (state.buttons & buttonMasks[button]) !== 0;
+}
+
+// Subscribes to the device's input stream while the component is mounted
+export function useInputState() {
+	const [inputState, setInputState] = useState(null);
+
+	useEffect(() => {
+		const source = WebApi.openInputStream(setInputState);
+		return () => source.close();
+	}, [setInputState]);
+
+	return inputState;
+}
+
+const stickPercent = (value) => Math.round(value * 100 / 0xFFFF);
+
+export default function InputMonitor({ buttonLabels }) {
+	const inputState = useInputState();
+
+	if (!inputState)
+		return <p>Waiting for the controller...</p>;
+
+	return (
+		<div className="input-monitor">
+			<div className="input-monitor-buttons">
+				{Object.keys(buttonLabels).filter(p => p !== 'label' && p !== 'value').map((button) =>
+					<span key={`input-${button}`} className={`badge ${isPressed(inputState, button) ? 'bg-success' : 'bg-secondary'}`}>
+						{buttonLabels[button]}
+					</span>
+				)}
+			</div>
+			<div className="input-monitor-touch">
+				{[...Array(TOUCH_COUNT).keys()].map((i) =>
+					<span
+						key={`touch-${i}`}
+						className={(inputState.touched >>> i) & 1 ? 'touched' : ''}
+						title={`Electrode ${i}`}
+					></span>
+				)}
+			</div>
+			<div className="input-monitor-values">
+				<span>Finger L: {inputState.touchL}</span>
+				<span>Finger R: {inputState.touchR}</span>
+				<span>LX: {stickPercent(inputState.lx)}%</span>
+				<span>LY: {stickPercent(inputState.ly)}%</span>
+				<span>RX: {stickPercent(inputState.rx)}%</span>
+				<span>RY: {stickPercent(inputState.ry)}%</span>
+			</div>
+		</div>
+	);
+}
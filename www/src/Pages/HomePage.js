@@ -1,12 +1,17 @@
-import React, { useEffect, useState } from 'react';
+import React, { useContext, useEffect, useState } from 'react';
 import axios from 'axios';
 import { orderBy } from 'lodash';
 
+import { AppContext } from '../Contexts/AppContext';
 import Section from '../Components/Section';
+import InputMonitor from '../Components/InputMonitor';
+import FirmwareUpload from '../Components/FirmwareUpload';
+import BUTTONS from '../Data/Buttons.json';
 
 const currentVersion = process.env.REACT_APP_CURRENT_VERSION;
 
 export default function HomePage() {
+	const { buttonLabels } = useContext(AppContext);
 	const [latestVersion, setLatestVersion] = useState('');
 
 	useEffect(() => {
@@ -38,8 +43,14 @@ export default function HomePage() {
 							</a>
 						</div>
 					: null}
+					<div className="mt-3">
+						<FirmwareUpload />
+					</div>
 				</div>
 			</Section>
+			<Section title="Input Monitor">
+				<InputMonitor buttonLabels={BUTTONS[buttonLabels]} />
+			</Section>
 		</div>
 	);
 }
@@ -31,6 +31,12 @@ const defaultValue = {
 	ledFormat: 0,
 	ledLayout: 0,
 	ledsPerButton: 2,
+	ledCount: 0,
+	chains: [
+		{ pin: -1, length: 0 },
+		{ pin: -1, length: 0 },
+		{ pin: -1, length: 0 },
+	],
 };
 
 let usedPins = [];
@@ -43,6 +49,11 @@ const schema = yup.object().shape({
 	ledFormat         : yup.number().required().positive().integer().min(0).max(3).label('LED Format'),
 	ledLayout         : yup.number().required().positive().integer().min(0).max(2).label('LED Layout'),
 	ledsPerButton      : yup.number().required().positive().integer().min(1).label('LEDs Per Pixel'),
+	ledCount          : yup.number().required().integer().min(0).label('Primary Chain LED Count'),
+	chains            : yup.array().of(yup.object().shape({
+		pin    : yup.number().required().integer().min(-1).max(29).label('Chain Data Pin'),
+		length : yup.number().required().integer().min(0).label('Chain LED Count'),
+	})),
 });
 
 const getLedButtons = (buttonLabels, map, excludeNulls) => {
@@ -215,6 +226,52 @@ export default function LEDConfigPage() {
 								max={10}
 							/>
 						</Row>
+						<Row>
+							<FormControl type="number"
+								label="Primary Chain LED Count (0 for automatic)"
+								name="ledCount"
+								className="form-control-sm"
+								groupClassName="col-sm-4 mb-3"
+								value={values.ledCount}
+								error={errors.ledCount}
+								isInvalid={errors.ledCount}
+								onChange={handleChange}
+								min={0}
+							/>
+						</Row>
+					</Section>
+					<Section title="Additional LED Chains">
+						<p className="card-text">
+							Extra chains, such as a slider strip or case lighting, are driven in parallel on their own pins.
+							Their LEDs are numbered after the primary chain, in order.
+						</p>
+						{values.chains.map((chain, i) =>
+							<Row key={`chain-${i}`}>
+								<FormControl type="number"
+									label={`Chain ${i + 2} Data Pin (-1 for disabled)`}
+									name={`chains[${i}].pin`}
+									className="form-control-sm"
+									groupClassName="col-sm-4 mb-3"
+									value={chain.pin}
+									error={errors.chains && errors.chains[i] && errors.chains[i].pin}
+									isInvalid={errors.chains && errors.chains[i] && errors.chains[i].pin}
+									onChange={handleChange}
+									min={-1}
+									max={29}
+								/>
+								<FormControl type="number"
+									label={`Chain ${i + 2} LED Count`}
+									name={`chains[${i}].length`}
+									className="form-control-sm"
+									groupClassName="col-sm-4 mb-3"
+									value={chain.length}
+									error={errors.chains && errors.chains[i] && errors.chains[i].length}
+									isInvalid={errors.chains && errors.chains[i] && errors.chains[i].length}
+									onChange={handleChange}
+									min={0}
+								/>
+							</Row>
+						)}
 					</Section>
 					<Section title="LED Button Order">
 						<p className="card-text">
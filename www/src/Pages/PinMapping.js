@@ -3,6 +3,7 @@ import { NavLink } from "react-router-dom";
 import { Button, Form } from 'react-bootstrap';
 import { AppContext } from '../Contexts/AppContext';
 import Section from '../Components/Section';
+import { isPressed, useInputState } from '../Components/InputMonitor';
 import WebApi, { baseButtonMappings } from '../Services/WebApi';
 import boards from '../Data/Boards.json';
 import BUTTONS from '../Data/Buttons.json';
@@ -17,6 +18,7 @@ export default function PinMappingPage() {
 	const [buttonMappings, setButtonMappings] = useState(baseButtonMappings);
 	const [selectedController] = useState(process.env.REACT_APP_GP2040_CONTROLLER);
 	const [selectedBoard] = useState(process.env.REACT_APP_GP2040_BOARD);
+	const inputState = useInputState();
 
 	useEffect(() => {
 		async function fetchData() {
@@ -79,7 +81,7 @@ export default function PinMappingPage() {
 	return (
 		<Section title="Pin Mapping">
 			<Form noValidate validated={validated} onSubmit={handleSubmit}>
-				<p>Use the form below to reconfigure your button-to-pin mapping.</p>
+				<p>Use the form below to reconfigure your button-to-pin mapping. Rows light up while their button is held.</p>
 				<div className="alert alert-warning">
 					Mapping buttons to pins that aren't connected or available can leave the device in non-functional state. To clear the
 					the invalid configuration go to the <NavLink exact={true} to="/reset-settings">Reset Settings</NavLink> page.
@@ -93,7 +95,7 @@ export default function PinMappingPage() {
 					</thead>
 					<tbody>
 						{Object.keys(BUTTONS[buttonLabels])?.filter(p => p !== 'label' && p !== 'value').map((button, i) =>
-							<tr key={`button-map-${i}`} className={validated && !!buttonMappings[button].error ? "table-danger" : ""}>
+							<tr key={`button-map-${i}`} className={validated && !!buttonMappings[button].error ? "table-danger" : (isPressed(inputState, button) ? "table-success" : "")}>
 								<td>{BUTTONS[buttonLabels][button]}</td>
 								<td>
 									<Form.Control
@@ -0,0 +1,63 @@
+const UF2_BLOCK_SIZE = 512;
+const UF2_MAGIC_START0 = 0x0A324655;
+const UF2_MAGIC_START1 = 0x9E5D5157;
+const UF2_MAGIC_END = 0x0AB16F30;
+const UF2_FLAG_NOT_MAIN_FLASH = 0x00000001;
+const UF2_FLAG_FAMILY_ID = 0x00002000;
+const UF2_FAMILY_RP2040 = 0xE48BFF56;
+const XIP_BASE = 0x10000000;
+
+let crcTable = null;
+
+function crc32(bytes) {
+	if (!crcTable) {
+		crcTable = new Uint32Array(256);
+		for (let i = 0; i < 256; i++) {
+			let c = i;
+			for (let k = 0; k < 8; k++)
+				c = (c & 1) ? (0xEDB88320 ^ (c >>> 1)) : (c >>> 1);
+			crcTable[i] = c >>> 0;
+		}
+	}
+
+	let crc = 0xFFFFFFFF;
+	for (let i = 0; i < bytes.length; i++)
+		crc = crcTable[(crc ^ bytes[i]) & 0xFF] ^ (crc >>> 8);
+
+	return (crc ^ 0xFFFFFFFF) >>> 0;
+}
+
+/* Lays a UF2 file out the way the controller stages it, from the start of flash to the end of the last
+block with gaps left erased, and returns its size and CRC. The CRC is what applyFirmware confirms. */
+export function readUf2(buffer) {
+	if (buffer.byteLength === 0 || buffer.byteLength % UF2_BLOCK_SIZE !== 0)
+		throw new Error('Not a UF2 file');
+
+	const view = new DataView(buffer);
+	const blocks = [];
+	let size = 0;
+
+	for (let offset = 0; offset < buffer.byteLength; offset += UF2_BLOCK_SIZE) {
+		if (view.getUint32(offset, true) !== UF2_MAGIC_START0
+			|| view.getUint32(offset + 4, true) !== UF2_MAGIC_START1
+			|| view.getUint32(offset + UF2_BLOCK_SIZE - 4, true) !== UF2_MAGIC_END)
+			throw new Error('Not a UF2 file');
+
+		const flags = view.getUint32(offset + 8, true);
+		if (flags & UF2_FLAG_NOT_MAIN_FLASH)
+			continue;
+		if (!(flags & UF2_FLAG_FAMILY_ID) || view.getUint32(offset + 28, true) !== UF2_FAMILY_RP2040)
+			throw new Error('Not an RP2040 image');
+
+		const target = view.getUint32(offset + 12, true) - XIP_BASE;
+		const length = view.getUint32(offset + 16, true);
+		blocks.push({ target, data: new Uint8Array(buffer, offset + 32, length) });
+		size = Math.max(size, target + length);
+	}
+
+	const image = new Uint8Array(size).fill(0xFF);
+	for (const block of blocks)
+		image.set(block.data, block.target);
+
+	return { size, crc: crc32(image) };
+}
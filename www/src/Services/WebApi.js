@@ -1,6 +1,7 @@
 import axios from 'axios';
 
 const baseUrl = process.env.NODE_ENV === 'production' ? '' : 'http://localhost:8080';
+const inputStreamUrl = process.env.NODE_ENV === 'production' ? `http://${window.location.hostname}:8081/` : `${baseUrl}/api/inputStream`;
 
 export const baseButtonMappings = {
 	Up:    { pin: -1, error: null },
@@ -117,6 +118,71 @@ async function setPinMappings(mappings) {
 		});
 }
 
+// The whole configuration in one document, for backups and provisioning several controllers
+async function getConfig() {
+	return axios.get(`${baseUrl}/api/getConfig`)
+		.then((response) => response.data)
+		.catch(console.error);
+}
+
+// Applied all at once or not at all, resolves to { success, error }
+async function setConfig(config) {
+	return axios.post(`${baseUrl}/api/setConfig`, config)
+		.then((response) => response.data)
+		.catch((err) => {
+			console.error(err);
+			return { success: false, error: err.message };
+		});
+}
+
+// Sends a UF2 file to be staged, resolves to { success, size, crc, error }. The controller keeps running the current firmware.
+async function uploadFirmware(file, onProgress) {
+	return axios.post(`${baseUrl}/api/firmware`, file, {
+			headers: { 'Content-Type': 'application/octet-stream' },
+			onUploadProgress: (e) => onProgress && onProgress(e.loaded / e.total),
+		})
+		.then((response) => response.data)
+		.catch((err) => {
+			console.error(err);
+			return { success: false, error: err.message };
+		});
+}
+
+// Copies the staged image over the running one if the CRC matches, the controller resets shortly after
+async function applyFirmware(crc) {
+	return axios.post(`${baseUrl}/api/applyFirmware`, { crc })
+		.then((response) => response.data)
+		.catch((err) => {
+			console.error(err);
+			return { success: false, error: err.message };
+		});
+}
+
+function parseInputState(data) {
+	const fields = data.split(',');
+	return {
+		buttons: parseInt(fields[0], 16),
+		dpad:    parseInt(fields[1], 16),
+		aux:     parseInt(fields[2], 16),
+		touched: parseInt(fields[3], 16),
+		touchL:  parseInt(fields[4]),
+		touchR:  parseInt(fields[5]),
+		lx:      parseInt(fields[6], 16),
+		ly:      parseInt(fields[7], 16),
+		rx:      parseInt(fields[8], 16),
+		ry:      parseInt(fields[9], 16),
+		lt:      parseInt(fields[10], 16),
+		rt:      parseInt(fields[11], 16),
+	};
+}
+
+// Live input state, the caller must close() the returned EventSource
+function openInputStream(onState) {
+	const source = new EventSource(inputStreamUrl);
+	source.onmessage = (e) => onState(parseInputState(e.data));
+	return source;
+}
+
 const WebApi = {
 	resetSettings,
 	getDisplayOptions,
@@ -127,6 +193,11 @@ const WebApi = {
 	setLedOptions,
 	getPinMappings,
 	setPinMappings,
+	getConfig,
+	setConfig,
+	uploadFirmware,
+	applyFirmware,
+	openInputStream,
 };
 
 export default WebApi;